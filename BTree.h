@@ -0,0 +1,785 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//==============================================================
+//	B-tree ordered map
+//==============================================================
+//	std::map and std::set (C++11LibraryFeatures.cpp) allocate one red-black
+//	tree node per element, so every step of a lookup or scan is a dependent
+//	load from a different cache line. btree_map<K, V, Compare, NodeBytes> is
+//	a B+ tree: nodes of NodeBytes bytes (eight cache lines by default, a page
+//	with 4096) hold dozens to hundreds of keys, values live only in the leaves, and the
+//	leaves are linked so that iteration and range scans stream through
+//	arrays.
+//
+//	The interface follows std::map: iterators yield a pair-like reference
+//	with first and second, lower_bound / upper_bound / find / erase, and
+//	operator[]. Unlike std::map, keys and values are stored in plain arrays,
+//	so K and V must be default constructible and move assignable, and any
+//	insert or erase invalidates all iterators.
+//
+//	For arithmetic keys ordered by std::less the search inside a node of up
+//	to 64 keys compares a whole vector of keys at a time and counts the
+//	smaller ones, with no branches (GCC and Clang vector extensions); other
+//	keys, and larger nodes, use a binary search. Define BTREE_SCALAR_SEARCH to always use the binary
+//	search.
+//
+//	Floating-point keys ordered by std::less may be infinite but not NaN,
+//	which has no place in the order: insert throws std::invalid_argument,
+//	and find and lower_bound of a NaN return end().
+
+namespace BTree {
+
+	namespace detail {
+
+//  Vector types for the node search; other keys use the binary search.
+		template <typename K>
+		struct BTreeVec
+		{
+			static constexpr bool supported = false;
+		};
+
+//  the widest registers the build targets: wider generic vectors would go
+//  through memory
+#if defined(__AVX2__)
+		constexpr size_t btreeVecBytes = 32;
+#else
+		constexpr size_t btreeVecBytes = 16;
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BTREE_VEC(T, M) \
+		template <> \
+		struct BTreeVec<T> \
+		{ \
+			static constexpr bool supported = true; \
+			typedef T Key __attribute__((vector_size(btreeVecBytes))); \
+			typedef M Mask __attribute__((vector_size(btreeVecBytes))); \
+		};
+		BTREE_VEC(int, int)
+		BTREE_VEC(unsigned, int)
+		BTREE_VEC(long, long)
+		BTREE_VEC(unsigned long, long)
+		BTREE_VEC(long long, long long)
+		BTREE_VEC(unsigned long long, long long)
+		BTREE_VEC(float, int)
+		BTREE_VEC(double, long long)
+#undef BTREE_VEC
+#endif
+
+		template <typename K, typename Compare>
+		constexpr bool orderedByLess = std::is_same<Compare, std::less<K>>::value || std::is_same<Compare, std::less<>>::value;
+
+		template <typename K, typename Compare>
+		constexpr bool btreeVectorSearch =
+#if defined(BTREE_SCALAR_SEARCH)
+			false &&
+#endif
+			BTreeVec<K>::supported && orderedByLess<K, Compare>;
+
+//  Keys per vector compare; capacities are rounded to a multiple of it.
+		template <typename K>
+		constexpr size_t btreeLanes = btreeVecBytes / sizeof(K);
+
+//  Number of keys[i] < key (Inclusive: <= key) over all Cap slots. Unused
+//  slots hold the largest key (infinity for floating point), so clamping
+//  the count to the used slots makes it exact.
+		template <bool Inclusive, size_t Cap, typename K>
+		inline size_t countBelow(const K* keys, size_t n, K key)
+		{
+			using Vec = typename BTreeVec<K>::Key;
+			using Mask = typename BTreeVec<K>::Mask;
+			Vec probe;
+			for (size_t j = 0; j < btreeLanes<K>; ++j)
+				probe[j] = key;
+			Mask acc = {};
+			for (size_t i = 0; i < Cap; i += btreeLanes<K>) {
+				Vec v;
+				std::memcpy(&v, keys + i, sizeof v);
+				if constexpr (Inclusive)
+					acc += (v <= probe);
+				else
+					acc += (v < probe);
+			}
+			size_t count = 0;
+			for (size_t j = 0; j < btreeLanes<K>; ++j)
+				count -= static_cast<size_t>(acc[j]);
+			return count < n ? count : n;
+		}
+	}
+}
+
+template <typename K, typename V, typename Compare = std::less<K>, size_t NodeBytes = 512>
+class btree_map
+{
+	static constexpr bool vectorSearch = BTree::detail::btreeVectorSearch<K, Compare>;
+	static constexpr bool nanKeys = std::is_floating_point<K>::value && BTree::detail::orderedByLess<K, Compare>;
+	static constexpr size_t lanes = vectorSearch ? BTree::detail::btreeLanes<K> : 1;
+
+	static constexpr size_t roundCap(size_t cap) { return std::max<size_t>((4 + lanes - 1) / lanes * lanes, cap / lanes * lanes); }
+
+public:
+//  Entries per leaf and keys per inner node.
+	static constexpr size_t leafCapacity = roundCap((NodeBytes - 2 * sizeof(void*) - 4) / (sizeof(K) + sizeof(V)));
+	static constexpr size_t innerCapacity = roundCap((NodeBytes - sizeof(void*) - 4) / (sizeof(K) + sizeof(void*)));
+
+private:
+	static constexpr bool leafVectorSearch = vectorSearch && leafCapacity <= 64;
+	static constexpr bool innerVectorSearch = vectorSearch && innerCapacity <= 64;
+	static constexpr size_t minLeaf = leafCapacity / 2;
+	static constexpr size_t minInner = innerCapacity / 2;
+
+	struct Node
+	{
+		uint16_t count = 0;
+		bool leaf;
+
+		explicit Node(bool isLeaf) : leaf(isLeaf) {}
+	};
+
+	struct alignas(64) Leaf : Node
+	{
+		Leaf* prev = nullptr;
+		Leaf* next = nullptr;
+		K keys[leafCapacity];
+		V values[leafCapacity];
+
+		Leaf() : Node(true) { pad(keys, 0, leafCapacity); }
+	};
+
+	struct alignas(64) Inner : Node
+	{
+		K keys[innerCapacity];
+		Node* children[innerCapacity + 1];
+
+		Inner() : Node(false) { pad(keys, 0, innerCapacity); }
+	};
+
+	Node* _root = nullptr;
+	Leaf* _first = nullptr;
+	Leaf* _last = nullptr;
+	size_t _size = 0;
+	size_t _leaves = 0;
+	size_t _inners = 0;
+	int _height = 0;
+	Compare _less;
+
+//  keeps unused key slots at the largest key for the vector search; an
+//  infinite key must not count below the padding
+	static void pad(K* keys, size_t from, size_t to)
+	{
+		if constexpr (vectorSearch && std::numeric_limits<K>::has_infinity)
+			std::fill(keys + from, keys + to, std::numeric_limits<K>::infinity());
+		else if constexpr (vectorSearch)
+			std::fill(keys + from, keys + to, std::numeric_limits<K>::max());
+		else {
+			(void)keys;
+			(void)from;
+			(void)to;
+		}
+	}
+
+//  NaN compares false with every key, so a search for it lands anywhere
+	static bool isNaN(const K& key)
+	{
+		if constexpr (nanKeys)
+			return key != key;
+		else {
+			(void)key;
+			return false;
+		}
+	}
+
+//  first slot whose key is not less than key
+	size_t lowerIn(const Leaf* leaf, const K& key) const
+	{
+		if constexpr (leafVectorSearch)
+			return BTree::detail::countBelow<false, leafCapacity>(leaf->keys, leaf->count, key);
+		else
+			return static_cast<size_t>(std::lower_bound(leaf->keys, leaf->keys + leaf->count, key, _less) - leaf->keys);
+	}
+
+//  child that holds key: the number of separators not greater than key
+	size_t childIn(const Inner* inner, const K& key) const
+	{
+		if constexpr (innerVectorSearch)
+			return BTree::detail::countBelow<true, innerCapacity>(inner->keys, inner->count, key);
+		else
+			return static_cast<size_t>(std::upper_bound(inner->keys, inner->keys + inner->count, key, _less) - inner->keys);
+	}
+
+	Leaf* newLeaf()
+	{
+		++_leaves;
+		return new Leaf();
+	}
+
+	Inner* newInner()
+	{
+		++_inners;
+		return new Inner();
+	}
+
+	void freeNode(Node* node)
+	{
+		if (node->leaf) {
+			--_leaves;
+			delete static_cast<Leaf*>(node);
+		}
+		else {
+			--_inners;
+			delete static_cast<Inner*>(node);
+		}
+	}
+
+	void destroy(Node* node)
+	{
+		if (!node->leaf) {
+			Inner* inner = static_cast<Inner*>(node);
+			for (size_t i = 0; i <= inner->count; ++i)
+				destroy(inner->children[i]);
+		}
+		freeNode(node);
+	}
+
+	struct Step
+	{
+		Inner* inner;
+		size_t child;
+	};
+
+	Leaf* descend(const K& key, Step* path) const
+	{
+		Node* node = _root;
+		for (int depth = 0; !node->leaf; ++depth) {
+			Inner* inner = static_cast<Inner*>(node);
+			const size_t child = childIn(inner, key);
+			if (path)
+				path[depth] = { inner, child };
+			node = inner->children[child];
+		}
+		return static_cast<Leaf*>(node);
+	}
+
+	void linkAfter(Leaf* left, Leaf* right)
+	{
+		right->prev = left;
+		right->next = left->next;
+		if (left->next)
+			left->next->prev = right;
+		else
+			_last = right;
+		left->next = right;
+	}
+
+	void unlink(Leaf* leaf)
+	{
+		(leaf->prev ? leaf->prev->next : _first) = leaf->next;
+		(leaf->next ? leaf->next->prev : _last) = leaf->prev;
+	}
+
+//  Inserts separator / right child after child index at into the inner
+//  nodes on path, splitting upwards as needed.
+	void insertSeparator(Step* path, int depth, K separator, Node* right)
+	{
+		while (depth >= 0) {
+			Inner* inner = path[depth].inner;
+			const size_t at = path[depth].child;
+			if (inner->count < innerCapacity) {
+				std::move_backward(inner->keys + at, inner->keys + inner->count, inner->keys + inner->count + 1);
+				std::move_backward(inner->children + at + 1, inner->children + inner->count + 1, inner->children + inner->count + 2);
+				inner->keys[at] = std::move(separator);
+				inner->children[at + 1] = right;
+				++inner->count;
+				return;
+			}
+
+			// Split a full inner node around its middle key, which moves up.
+			K keys[innerCapacity + 1];
+			Node* children[innerCapacity + 2];
+			std::move(inner->keys, inner->keys + at, keys);
+			keys[at] = std::move(separator);
+			std::move(inner->keys + at, inner->keys + innerCapacity, keys + at + 1);
+			std::copy(inner->children, inner->children + at + 1, children);
+			children[at + 1] = right;
+			std::copy(inner->children + at + 1, inner->children + innerCapacity + 1, children + at + 2);
+
+			const size_t leftCount = (innerCapacity + 1) / 2;
+			Inner* sibling = newInner();
+			std::move(keys, keys + leftCount, inner->keys);
+			std::copy(children, children + leftCount + 1, inner->children);
+			pad(inner->keys, leftCount, innerCapacity);
+			inner->count = static_cast<uint16_t>(leftCount);
+
+			const size_t rightCount = innerCapacity - leftCount;
+			std::move(keys + leftCount + 1, keys + innerCapacity + 1, sibling->keys);
+			std::copy(children + leftCount + 1, children + innerCapacity + 2, sibling->children);
+			sibling->count = static_cast<uint16_t>(rightCount);
+
+			separator = std::move(keys[leftCount]);
+			right = sibling;
+			--depth;
+		}
+
+		Inner* root = newInner();
+		root->keys[0] = std::move(separator);
+		root->children[0] = _root;
+		root->children[1] = right;
+		root->count = 1;
+		_root = root;
+		++_height;
+	}
+
+//  Places key at pos in leaf, splitting it if full; returns where it went.
+	std::pair<Leaf*, size_t> insertAt(Leaf* leaf, size_t pos, Step* path, const K& key, V&& value)
+	{
+		if (leaf->count == leafCapacity) {
+			Leaf* right = newLeaf();
+			const size_t leftCount = (leafCapacity + 1) / 2;
+			const size_t moved = leafCapacity - leftCount;
+			std::move(leaf->keys + leftCount, leaf->keys + leafCapacity, right->keys);
+			std::move(leaf->values + leftCount, leaf->values + leafCapacity, right->values);
+			pad(leaf->keys, leftCount, leafCapacity);
+			leaf->count = static_cast<uint16_t>(leftCount);
+			right->count = static_cast<uint16_t>(moved);
+			linkAfter(leaf, right);
+			insertSeparator(path, _height - 1, right->keys[0], right);
+
+			if (pos > leftCount) {
+				leaf = right;
+				pos -= leftCount;
+			}
+		}
+
+		std::move_backward(leaf->keys + pos, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+		std::move_backward(leaf->values + pos, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+		leaf->keys[pos] = key;
+		leaf->values[pos] = std::move(value);
+		++leaf->count;
+		++_size;
+		return { leaf, pos };
+	}
+
+	void rebalanceLeaf(Leaf* leaf, Step* path, int depth)
+	{
+		Inner* parent = path[depth].inner;
+		const size_t at = path[depth].child;
+		Leaf* left = at > 0 ? static_cast<Leaf*>(parent->children[at - 1]) : nullptr;
+		Leaf* right = at < parent->count ? static_cast<Leaf*>(parent->children[at + 1]) : nullptr;
+
+		if (left && left->count > minLeaf) {
+			std::move_backward(leaf->keys, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+			std::move_backward(leaf->values, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+			leaf->keys[0] = std::move(left->keys[left->count - 1]);
+			leaf->values[0] = std::move(left->values[left->count - 1]);
+			++leaf->count;
+			--left->count;
+			pad(left->keys, left->count, left->count + 1);
+			parent->keys[at - 1] = leaf->keys[0];
+		}
+		else if (right && right->count > minLeaf) {
+			leaf->keys[leaf->count] = std::move(right->keys[0]);
+			leaf->values[leaf->count] = std::move(right->values[0]);
+			++leaf->count;
+			std::move(right->keys + 1, right->keys + right->count, right->keys);
+			std::move(right->values + 1, right->values + right->count, right->values);
+			--right->count;
+			pad(right->keys, right->count, right->count + 1);
+			parent->keys[at] = right->keys[0];
+		}
+		else {
+			// Merge with a sibling: the right one of the pair goes away.
+			if (!left) {
+				left = leaf;
+				leaf = right;
+			}
+			else
+				--path[depth].child;
+			std::move(leaf->keys, leaf->keys + leaf->count, left->keys + left->count);
+			std::move(leaf->values, leaf->values + leaf->count, left->values + left->count);
+			left->count = static_cast<uint16_t>(left->count + leaf->count);
+			unlink(leaf);
+			freeNode(leaf);
+			removeSeparator(path, depth);
+		}
+	}
+
+//  Removes separator path[depth].child and the child to its right.
+	void removeSeparator(Step* path, int depth)
+	{
+		Inner* inner = path[depth].inner;
+		const size_t at = path[depth].child;
+		std::move(inner->keys + at + 1, inner->keys + inner->count, inner->keys + at);
+		std::copy(inner->children + at + 2, inner->children + inner->count + 1, inner->children + at + 1);
+		--inner->count;
+		pad(inner->keys, inner->count, inner->count + 1);
+
+		if (depth == 0) {
+			if (inner->count == 0) {
+				_root = inner->children[0];
+				freeNode(inner);
+				--_height;
+			}
+			return;
+		}
+		if (inner->count >= minInner)
+			return;
+
+		Inner* parent = path[depth - 1].inner;
+		const size_t pos = path[depth - 1].child;
+		Inner* left = pos > 0 ? static_cast<Inner*>(parent->children[pos - 1]) : nullptr;
+		Inner* right = pos < parent->count ? static_cast<Inner*>(parent->children[pos + 1]) : nullptr;
+
+		if (left && left->count > minInner) {
+			std::move_backward(inner->keys, inner->keys + inner->count, inner->keys + inner->count + 1);
+			std::copy_backward(inner->children, inner->children + inner->count + 1, inner->children + inner->count + 2);
+			inner->keys[0] = std::move(parent->keys[pos - 1]);
+			inner->children[0] = left->children[left->count];
+			++inner->count;
+			parent->keys[pos - 1] = std::move(left->keys[left->count - 1]);
+			--left->count;
+			pad(left->keys, left->count, left->count + 1);
+		}
+		else if (right && right->count > minInner) {
+			inner->keys[inner->count] = std::move(parent->keys[pos]);
+			inner->children[inner->count + 1] = right->children[0];
+			++inner->count;
+			parent->keys[pos] = std::move(right->keys[0]);
+			std::move(right->keys + 1, right->keys + right->count, right->keys);
+			std::copy(right->children + 1, right->children + right->count + 1, right->children);
+			--right->count;
+			pad(right->keys, right->count, right->count + 1);
+		}
+		else {
+			if (!left) {
+				left = inner;
+				inner = right;
+			}
+			else
+				--path[depth - 1].child;
+			const size_t sep = path[depth - 1].child;
+			left->keys[left->count] = std::move(parent->keys[sep]);
+			std::move(inner->keys, inner->keys + inner->count, left->keys + left->count + 1);
+			std::copy(inner->children, inner->children + inner->count + 1, left->children + left->count + 1);
+			left->count = static_cast<uint16_t>(left->count + inner->count + 1);
+			freeNode(inner);
+			removeSeparator(path, depth - 1);
+		}
+	}
+
+	template <bool Const>
+	class Iterator
+	{
+		friend class btree_map;
+		using Map = std::conditional_t<Const, const btree_map, btree_map>;
+		using LeafPtr = std::conditional_t<Const, const Leaf*, Leaf*>;
+
+		Map* _map = nullptr;
+		LeafPtr _leaf = nullptr;
+		size_t _i = 0;
+
+	public:
+		struct reference
+		{
+			const K& first;
+			std::conditional_t<Const, const V&, V&> second;
+		};
+
+		struct pointer
+		{
+			reference ref;
+			const reference* operator->() const { return &ref; }
+		};
+
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = std::pair<K, V>;
+		using difference_type = std::ptrdiff_t;
+
+		Iterator() = default;
+		Iterator(Map* map, LeafPtr leaf, size_t i) : _map(map), _leaf(leaf), _i(i) {}
+		operator Iterator<true>() const { return { _map, _leaf, _i }; }
+
+		reference operator*() const { return { _leaf->keys[_i], _leaf->values[_i] }; }
+		pointer operator->() const { return { **this }; }
+
+		Iterator& operator++()
+		{
+			if (++_i == _leaf->count) {
+				_leaf = _leaf->next;
+				_i = 0;
+			}
+			return *this;
+		}
+
+		Iterator& operator--()
+		{
+			if (_leaf == nullptr) {
+				_leaf = _map->_last;
+				_i = _leaf->count;
+			}
+			else if (_i == 0) {
+				_leaf = _leaf->prev;
+				_i = _leaf->count;
+			}
+			--_i;
+			return *this;
+		}
+
+		Iterator operator++(int) { Iterator t = *this; ++*this; return t; }
+		Iterator operator--(int) { Iterator t = *this; --*this; return t; }
+
+		friend bool operator==(const Iterator& a, const Iterator& b) { return a._leaf == b._leaf && a._i == b._i; }
+		friend bool operator!=(const Iterator& a, const Iterator& b) { return !(a == b); }
+	};
+
+	template <typename It, typename Self>
+	static It makeIterator(Self* self, decltype(std::declval<It>()._leaf) leaf, size_t i)
+	{
+		if (leaf != nullptr && i == leaf->count) {
+			leaf = leaf->next;
+			i = 0;
+		}
+		return It(self, leaf, i);
+	}
+
+public:
+	using key_type = K;
+	using mapped_type = V;
+	using value_type = std::pair<K, V>;
+	using size_type = size_t;
+	using key_compare = Compare;
+	using iterator = Iterator<false>;
+	using const_iterator = Iterator<true>;
+
+	btree_map() = default;
+	explicit btree_map(const Compare& less) : _less(less) {}
+
+//  Bulk load from strictly increasing keys: every node is filled, no search
+//  and no splits.
+	template <typename It>
+	btree_map(It first, It last, const Compare& less = Compare()) : _less(less) { assign_sorted(first, last); }
+
+	btree_map(const btree_map& o) : _less(o._less) { assign_sorted(o.begin(), o.end()); }
+
+	btree_map(btree_map&& o) noexcept { swap(o); }
+
+	btree_map& operator=(btree_map o) noexcept
+	{
+		swap(o);
+		return *this;
+	}
+
+	~btree_map() { clear(); }
+
+	void swap(btree_map& o) noexcept
+	{
+		std::swap(_root, o._root);
+		std::swap(_first, o._first);
+		std::swap(_last, o._last);
+		std::swap(_size, o._size);
+		std::swap(_leaves, o._leaves);
+		std::swap(_inners, o._inners);
+		std::swap(_height, o._height);
+		std::swap(_less, o._less);
+	}
+
+	void clear()
+	{
+		if (_root)
+			destroy(_root);
+		_root = nullptr;
+		_first = _last = nullptr;
+		_size = 0;
+		_height = 0;
+	}
+
+//  Replaces the contents with [first, last), whose keys must be strictly
+//  increasing. Elements are pair-like (first, second).
+	template <typename It>
+	void assign_sorted(It first, It last)
+	{
+		clear();
+		std::vector<std::pair<Node*, K>> level;
+		for (Leaf* leaf = nullptr; first != last; ++first) {
+			if (isNaN((*first).first)) {
+				clear();
+				throw std::invalid_argument("btree_map: NaN key");
+			}
+			if (leaf == nullptr || leaf->count == leafCapacity) {
+				Leaf* next = newLeaf();
+				if (leaf)
+					linkAfter(leaf, next);
+				else
+					_first = _last = next;
+				leaf = next;
+				level.emplace_back(leaf, (*first).first);
+			}
+			leaf->keys[leaf->count] = (*first).first;
+			leaf->values[leaf->count] = (*first).second;
+			++leaf->count;
+			++_size;
+		}
+		if (level.empty())
+			return;
+
+		// The last leaf takes entries from its neighbour up to the minimum.
+		if (level.size() > 1 && _last->count < minLeaf) {
+			Leaf* left = _last->prev;
+			const size_t shift = minLeaf - _last->count;
+			std::move_backward(_last->keys, _last->keys + _last->count, _last->keys + _last->count + shift);
+			std::move_backward(_last->values, _last->values + _last->count, _last->values + _last->count + shift);
+			std::move(left->keys + left->count - shift, left->keys + left->count, _last->keys);
+			std::move(left->values + left->count - shift, left->values + left->count, _last->values);
+			left->count = static_cast<uint16_t>(left->count - shift);
+			_last->count = static_cast<uint16_t>(minLeaf);
+			pad(left->keys, left->count, leafCapacity);
+			level.back().second = _last->keys[0];
+		}
+
+		while (level.size() > 1) {
+			std::vector<std::pair<Node*, K>> upper;
+			const size_t fanout = innerCapacity + 1;
+			for (size_t i = 0; i < level.size();) {
+				size_t take = std::min(fanout, level.size() - i);
+				const size_t remaining = level.size() - i - take;
+				if (remaining > 0 && remaining < minInner + 1)
+					take -= minInner + 1 - remaining; // leave the last node its minimum
+
+				Inner* inner = newInner();
+				inner->children[0] = level[i].first;
+				for (size_t k = 1; k < take; ++k) {
+					inner->keys[k - 1] = level[i + k].second;
+					inner->children[k] = level[i + k].first;
+				}
+				inner->count = static_cast<uint16_t>(take - 1);
+				upper.emplace_back(inner, level[i].second);
+				i += take;
+			}
+			level.swap(upper);
+			++_height;
+		}
+		_root = level[0].first;
+	}
+
+	size_type size() const { return _size; }
+	bool empty() const { return _size == 0; }
+
+//  bytes held by the tree's nodes
+	size_t memory() const { return _leaves * sizeof(Leaf) + _inners * sizeof(Inner); }
+	int height() const { return _height; }
+
+	iterator       begin()       { return makeIterator<iterator>(this, _first, 0); }
+	iterator       end()         { return iterator(this, nullptr, 0); }
+	const_iterator begin() const { return makeIterator<const_iterator>(this, static_cast<const Leaf*>(_first), 0); }
+	const_iterator end()   const { return const_iterator(this, nullptr, 0); }
+
+	iterator lower_bound(const K& key)
+	{
+		if (_root == nullptr || isNaN(key))
+			return end();
+		Leaf* leaf = descend(key, nullptr);
+		return makeIterator<iterator>(this, leaf, lowerIn(leaf, key));
+	}
+
+	iterator upper_bound(const K& key)
+	{
+		iterator it = lower_bound(key);
+		if (it != end() && !_less(key, it->first))
+			++it;
+		return it;
+	}
+
+	iterator find(const K& key)
+	{
+		const iterator it = lower_bound(key);
+		return it != end() && !_less(key, it->first) ? it : end();
+	}
+
+	const_iterator lower_bound(const K& key) const { return const_cast<btree_map&>(*this).lower_bound(key); }
+	const_iterator upper_bound(const K& key) const { return const_cast<btree_map&>(*this).upper_bound(key); }
+	const_iterator find(const K& key) const { return const_cast<btree_map&>(*this).find(key); }
+
+	bool contains(const K& key) const { return find(key) != end(); }
+	size_type count(const K& key) const { return contains(key) ? 1 : 0; }
+
+	V& at(const K& key)
+	{
+		const iterator it = find(key);
+		if (it == end())
+			throw std::out_of_range("btree_map: key not found");
+		return it->second;
+	}
+
+	const V& at(const K& key) const { return const_cast<btree_map&>(*this).at(key); }
+
+	std::pair<iterator, bool> insert(const K& key, V value)
+	{
+		if (isNaN(key))
+			throw std::invalid_argument("btree_map: NaN key");
+		if (_root == nullptr) {
+			_root = _first = _last = newLeaf();
+		}
+		Step path[64];
+		Leaf* leaf = descend(key, path);
+		const size_t pos = lowerIn(leaf, key);
+		if (pos < leaf->count && !_less(key, leaf->keys[pos]))
+			return { iterator(this, leaf, pos), false };
+
+		const auto [where, at] = insertAt(leaf, pos, path, key, std::move(value));
+		return { iterator(this, where, at), true };
+	}
+
+	std::pair<iterator, bool> insert(const value_type& kv) { return insert(kv.first, kv.second); }
+
+	std::pair<iterator, bool> insert_or_assign(const K& key, V value)
+	{
+		auto result = insert(key, V());
+		result.first->second = std::move(value);
+		return result;
+	}
+
+	V& operator[](const K& key) { return insert(key, V()).first->second; }
+
+	size_type erase(const K& key)
+	{
+		if (_root == nullptr)
+			return 0;
+		Step path[64];
+		Leaf* leaf = descend(key, path);
+		const size_t pos = lowerIn(leaf, key);
+		if (pos == leaf->count || _less(key, leaf->keys[pos]))
+			return 0;
+
+		std::move(leaf->keys + pos + 1, leaf->keys + leaf->count, leaf->keys + pos);
+		std::move(leaf->values + pos + 1, leaf->values + leaf->count, leaf->values + pos);
+		--leaf->count;
+		pad(leaf->keys, leaf->count, leaf->count + 1);
+		--_size;
+
+		if (_height == 0) {
+			if (_size == 0)
+				clear();
+		}
+		else if (leaf->count < minLeaf)
+			rebalanceLeaf(leaf, path, _height - 1);
+		return 1;
+	}
+
+//  Erases the element at it; returns the element after it.
+	iterator erase(iterator it)
+	{
+		const K key = it->first;
+		erase(key);
+		return lower_bound(key);
+	}
+};
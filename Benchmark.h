@@ -0,0 +1,47 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//==============================================================
+//	Minimal benchmarking helpers (see std::chrono in
+//	C++11LibraryFeatures.cpp for the underlying idea)
+//==============================================================
+
+namespace Bench {
+
+	inline const void* volatile sink;
+
+//  Forces value to be materialized so the optimizer cannot drop the work.
+	template <typename T>
+	inline void doNotOptimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r"(&value) : "memory");
+#else
+		sink = &value;
+		_ReadWriteBarrier();
+#endif
+	}
+
+//  Runs fn repeat times and prints the best time in nanoseconds per item.
+	template <typename Fn>
+	double measure(const char* name, size_t items, Fn&& fn, int repeat = 3)
+	{
+		double best = 1e300;
+		for (int r = 0; r < repeat; ++r) {
+			const auto start = std::chrono::steady_clock::now();
+			fn();
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			best = std::min(best, elapsed.count());
+		}
+
+		const double ns = best * 1e9 / static_cast<double>(items ? items : 1);
+		std::printf("  %-44s %10.2f ns/item %10.1f Mitems/s\n", name, ns, 1e3 / ns);
+		return ns;
+	}
+}
@@ -0,0 +1,1544 @@
+//==============================================================
+// Benchmarks for the performance extensions
+//==============================================================
+//	Usage: Benchmarks [filter] [items]
+//	Runs every benchmark whose name contains filter (all by default)
+//	over the given number of items (1000000 by default).
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <regex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <thread>
+#include <unordered_map>
+#include <valarray>
+#include <vector>
+
+#include "Benchmark.h"
+#include "BTree.h"
+#include "EnumMap.h"
+#include "Expr.h"
+#include "FlatMap.h"
+#include "Fft.h"
+#include "Incremental.h"
+#include "Intern.h"
+#include "Kernels.h"
+#include "Log.h"
+#include "Lut.h"
+#include "Metrics.h"
+#include "Parallel.h"
+#include "Parse.h"
+#include "Random.h"
+#include "Rcu.h"
+#include "Regex.h"
+#include "SmallFunction.h"
+#include "SmallString.h"
+#include "ToChars.h"
+#include "Units.h"
+
+//	Build with -DBENCH_STD_PAR to compare against std::execution::par; libstdc++
+//	then needs -ltbb.
+#if defined(BENCH_STD_PAR)
+#include <execution>
+#endif
+
+
+//==============================================================
+//	1. Number formatting: Format::toChars vs std::to_string / snprintf
+//==============================================================
+
+void benchToChars(size_t n)
+{
+	std::mt19937_64 rng(42);
+	std::vector<int64_t> ints(n);
+	std::vector<double> doubles(n);
+	for (size_t i = 0; i < n; ++i) {
+		ints[i] = static_cast<int64_t>(rng()) >> (rng() % 63);
+		doubles[i] = std::ldexp(static_cast<double>(rng() >> 11), -static_cast<int>(rng() % 80));
+	}
+
+	char text[Format::maxChars];
+	Bench::measure("int64  std::to_string", n, [&] {
+		for (auto v : ints) Bench::doNotOptimize(std::to_string(v).size());
+	});
+	Bench::measure("int64  snprintf", n, [&] {
+		for (auto v : ints) Bench::doNotOptimize(std::snprintf(text, sizeof text, "%lld", static_cast<long long>(v)));
+	});
+	Bench::measure("int64  Format::toChars", n, [&] {
+		for (auto v : ints) Bench::doNotOptimize(Format::toChars(text, v));
+	});
+
+	Bench::measure("double std::to_string", n, [&] {
+		for (auto v : doubles) Bench::doNotOptimize(std::to_string(v).size());
+	});
+	Bench::measure("double snprintf %.17g", n, [&] {
+		for (auto v : doubles) Bench::doNotOptimize(std::snprintf(text, sizeof text, "%.17g", v));
+	});
+	Bench::measure("double Format::toChars (shortest)", n, [&] {
+		for (auto v : doubles) Bench::doNotOptimize(Format::toChars(text, v));
+	});
+
+	Buffer<char> out("batch", 0);
+	Bench::measure("int64  Format::toCharsBatch", n, [&] {
+		Bench::doNotOptimize(Format::toCharsBatch(ints.data(), n, out));
+	});
+	Bench::measure("double Format::toCharsBatch", n, [&] {
+		Bench::doNotOptimize(Format::toCharsBatch(doubles.data(), n, out));
+	});
+}
+
+
+//==============================================================
+//	2. Number parsing: Parse::fromChars / parseColumn vs std::stoi / strtoll
+//==============================================================
+
+void benchParse(size_t n)
+{
+	std::mt19937_64 rng(7);
+	std::vector<int64_t> values(n);
+	for (auto& v : values)
+		v = static_cast<int64_t>(rng()) >> (rng() % 63);
+
+	Buffer<char> text("csv", 0);
+	const size_t length = Format::toCharsBatch(values.data(), n, text, ',');
+	const std::string_view stream(text.data(), length);
+
+	Bench::measure("std::stoll (per field)", n, [&] {
+		size_t pos = 0;
+		int64_t total = 0;
+		while (pos < length) {
+			size_t used;
+			total += std::stoll(std::string(stream.substr(pos, 24)), &used);
+			pos += used + 1;
+		}
+		Bench::doNotOptimize(total);
+	});
+	Bench::measure("strtoll (per field)", n, [&] {
+		const char* p = text.data();
+		const char* last = p + length;
+		int64_t total = 0;
+		while (p < last) {
+			char* end;
+			total += std::strtoll(p, &end, 10);
+			p = end + 1;
+		}
+		Bench::doNotOptimize(total);
+	});
+	Bench::measure("std::from_chars (per field)", n, [&] {
+		const char* p = text.data();
+		const char* last = p + length;
+		int64_t total = 0;
+		while (p < last) {
+			int64_t v = 0;
+			p = std::from_chars(p, last, v).ptr + 1;
+			total += v;
+		}
+		Bench::doNotOptimize(total);
+	});
+	Buffer<int64_t> column("column", 0);
+	Bench::measure("Parse::parseColumn", n, [&] {
+		Bench::doNotOptimize(Parse::parseColumn(stream, column).count);
+	});
+}
+
+
+//==============================================================
+//	3. Unit conversion: Units::convertColumn vs the runtime _celsius formula
+//==============================================================
+
+void benchUnits(size_t n)
+{
+	Buffer<double> celsius("celsius", n);
+	Buffer<double> fahrenheit("fahrenheit", n);
+	for (size_t i = 0; i < n; ++i)
+		celsius[i] = static_cast<double>(i % 200) - 50.0;
+
+	Bench::measure("llround(t * 1.8 + 32) per value", n, [&] {
+		for (size_t i = 0; i < n; ++i)
+			fahrenheit[i] = static_cast<double>(std::llround(celsius[i] * 1.8 + 32));
+		Bench::doNotOptimize(fahrenheit[n / 2]);
+	});
+	Bench::measure("Units::convertColumn<Fahrenheit, Celsius>", n, [&] {
+		Units::convertColumn<Units::Fahrenheit, Units::Celsius>(celsius, fahrenheit);
+		Bench::doNotOptimize(fahrenheit[n / 2]);
+	});
+	Bench::measure("Units::convertColumn<Kilometers, Miles>", n, [&] {
+		Units::convertColumn<Units::Kilometers, Units::Miles>(celsius, fahrenheit);
+		Bench::doNotOptimize(fahrenheit[n / 2]);
+	});
+}
+
+
+//==============================================================
+//	4. Lookup tables: Lut.h tables vs computing at run time
+//==============================================================
+
+uint32_t crc32Bitwise(const unsigned char* p, size_t size)
+{
+	uint32_t crc = ~0u;
+	for (size_t i = 0; i < size; ++i) {
+		crc ^= p[i];
+		for (int k = 0; k < 8; ++k)
+			crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+	}
+	return ~crc;
+}
+
+void benchLut(size_t n)
+{
+	std::mt19937 rng(3);
+	std::vector<uint32_t> words(n);
+	for (auto& w : words)
+		w = rng();
+
+	Bench::measure("popcount, bit loop", n, [&] {
+		uint32_t total = 0;
+		for (auto w : words)
+			for (; w; w &= w - 1)
+				++total;
+		Bench::doNotOptimize(total);
+	});
+	Bench::measure("popcount, Lut::popcount32", n, [&] {
+		uint32_t total = 0;
+		for (auto w : words)
+			total += Lut::popcount32(w);
+		Bench::doNotOptimize(total);
+	});
+
+	Bench::measure("x / d (hardware divide)", n, [&] {
+		uint32_t total = 0;
+		for (auto w : words)
+			total += (w & 0xffff) / ((w >> 22) | 1);
+		Bench::doNotOptimize(total);
+	});
+	Bench::measure("x / d, Lut::divide16", n, [&] {
+		uint32_t total = 0;
+		for (auto w : words)
+			total += Lut::divide16(w & 0xffff, (w >> 22) | 1);
+		Bench::doNotOptimize(total);
+	});
+
+	Bench::measure("std::sin(2 pi i / 1024)", n, [&] {
+		double total = 0;
+		for (auto w : words)
+			total += std::sin(2 * Lut::pi * (w & 1023) / 1024);
+		Bench::doNotOptimize(total);
+	});
+	Bench::measure("Lut::sine1024[i]", n, [&] {
+		double total = 0;
+		for (auto w : words)
+			total += Lut::sine1024[w & 1023];
+		Bench::doNotOptimize(total);
+	});
+
+	const auto* bytes = reinterpret_cast<const unsigned char*>(words.data());
+	const size_t size = n * sizeof(uint32_t);
+	Bench::measure("CRC-32, bitwise (per byte)", size, [&] {
+		Bench::doNotOptimize(crc32Bitwise(bytes, size));
+	});
+	Bench::measure("CRC-32, Lut::crc32 (per byte)", size, [&] {
+		Bench::doNotOptimize(Lut::crc32(bytes, size));
+	});
+}
+
+
+//==============================================================
+//	5. FFT: Fft::forward (scalar and AVX2) vs a naive DFT
+//==============================================================
+//	items is the largest transform size (capped at 2^22).
+
+void benchFft(size_t n)
+{
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<double> uniform(-1, 1);
+
+	for (size_t size = 256; size <= n && size <= (size_t{ 1 } << 22); size *= 2) {
+		Buffer<Complex> input("input", size);
+		for (auto& c : input)
+			c = Complex(uniform(rng), uniform(rng));
+
+		Buffer<Complex> work("work", size);
+		char label[64];
+		std::printf(" n = %zu\n", size);
+
+		const int repeat = size <= 65536 ? 20 : 3;
+		std::snprintf(label, sizeof label, "Fft::forward scalar");
+		Bench::measure(label, size, [&] { work = input; Fft::forward(work, Fft::Kernel::Scalar); }, repeat);
+		if (Fft::detail::hasAvx2()) {
+			std::snprintf(label, sizeof label, "Fft::forward AVX2");
+			Bench::measure(label, size, [&] { work = input; Fft::forward(work, Fft::Kernel::Avx2); }, repeat);
+		}
+
+	//  Accuracy: against the naive DFT where that is affordable, else round trip.
+		work = input;
+		Fft::forward(work);
+		double error = 0;
+		if (size <= 4096) {
+			Buffer<Complex> reference("reference", size);
+			Bench::measure("naive DFT", size, [&] { Fft::naiveDft(input.data(), reference.data(), size); }, 1);
+			for (size_t i = 0; i < size; ++i)
+				error = std::max(error, std::sqrt((work[i] - reference[i]).norm()));
+			std::printf("  max |FFT - DFT| = %.3g\n", error);
+		}
+		else {
+			Fft::inverse(work);
+			for (size_t i = 0; i < size; ++i)
+				error = std::max(error, std::sqrt((work[i] - input[i]).norm()));
+			std::printf("  max |inverse(forward(x)) - x| = %.3g\n", error);
+		}
+	}
+}
+
+
+//==============================================================
+//	6. Function wrappers: small_function / function_ref vs std::function
+//==============================================================
+//	Lambda shapes follow main(): Add, getX, addX, plus a 32-byte capture
+//	that is past std::function's small-buffer limit in libstdc++ and MSVC.
+
+template <typename Wrapper, typename F, typename... Args>
+void benchWrapper(const char* wrapper, const char* shape, size_t n, F f, Args... args)
+{
+	char label[64];
+	std::snprintf(label, sizeof label, "%-20s %-6s construct", wrapper, shape);
+	Bench::measure(label, n, [&] {
+		for (size_t i = 0; i < n; ++i) {
+			Wrapper w(f);
+			Bench::doNotOptimize(w);
+		}
+	});
+
+	const Wrapper source(f);
+	std::snprintf(label, sizeof label, "%-20s %-6s copy", wrapper, shape);
+	Bench::measure(label, n, [&] {
+		for (size_t i = 0; i < n; ++i) {
+			Wrapper w(source);
+			Bench::doNotOptimize(w);
+		}
+	});
+
+	std::snprintf(label, sizeof label, "%-20s %-6s call", wrapper, shape);
+	Bench::measure(label, n, [&] {
+		int64_t total = 0;
+		for (size_t i = 0; i < n; ++i)
+			total += source(args...);
+		Bench::doNotOptimize(total);
+	});
+}
+
+template <typename Sig, typename F, typename... Args>
+void benchShape(const char* shape, size_t n, F f, Args... args)
+{
+	benchWrapper<std::function<Sig>>("std::function", shape, n, f, args...);
+	benchWrapper<small_function<Sig>>("small_function", shape, n, f, args...);
+
+	function_ref<Sig> ref = f;
+	char label[64];
+	std::snprintf(label, sizeof label, "%-20s %-6s call", "function_ref", shape);
+	Bench::measure(label, n, [&] {
+		int64_t total = 0;
+		for (size_t i = 0; i < n; ++i)
+			total += ref(args...);
+		Bench::doNotOptimize(total);
+	});
+}
+
+void benchFunction(size_t n)
+{
+	int xLambda = 1;
+	int64_t a = 1, b = 2, c = 3, d = 4;
+
+	benchShape<int(int, int)>("Add", n, [](int n, int m) { return (n + m); }, 5, 7);
+	benchShape<int()>("getX", n, [=] { return xLambda; });
+	benchShape<int(int)>("addX", n, [=](int y) { return xLambda + y; }, 1);
+	benchShape<int64_t(int64_t)>("big", n, [=](int64_t y) { return a + b * y + c * y * y + d; }, 3);
+}
+
+
+//==============================================================
+//	7. Parallel algorithms: Parallel:: vs std:: and std::execution::par
+//==============================================================
+//	Every sort copies the unsorted input first; the copy is timed too, and
+//	"copy only" shows its share. Thread counts run 1, 2, 4, ... up to the
+//	hardware (at most 64).
+
+void benchParallel(size_t n)
+{
+	std::mt19937_64 rng(11);
+	std::vector<int64_t> ints(n);
+	std::vector<double> doubles(n);
+	for (size_t i = 0; i < n; ++i) {
+		ints[i] = static_cast<int64_t>(rng());
+		doubles[i] = std::ldexp(static_cast<double>(rng() >> 11), -static_cast<int>(rng() % 40)) - 0.5;
+	}
+	std::vector<int64_t> sortedInts(n);
+	std::vector<double> sortedDoubles(n);
+
+	Bench::measure("int64  copy only", n, [&] {
+		sortedInts = ints;
+		Bench::doNotOptimize(sortedInts[n / 2]);
+	});
+	Bench::measure("int64  std::sort", n, [&] {
+		sortedInts = ints;
+		std::sort(sortedInts.begin(), sortedInts.end());
+		Bench::doNotOptimize(sortedInts[n / 2]);
+	});
+#if defined(BENCH_STD_PAR)
+	Bench::measure("int64  std::sort(std::execution::par)", n, [&] {
+		sortedInts = ints;
+		std::sort(std::execution::par, sortedInts.begin(), sortedInts.end());
+		Bench::doNotOptimize(sortedInts[n / 2]);
+	});
+#endif
+
+	const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned threads = 1; threads <= std::min(hardware, 64u); threads *= 2) {
+		ThreadPool pool(threads);
+		std::printf("  -- %u thread(s)\n", threads);
+		Bench::measure("int64  Parallel::sort", n, [&] {
+			sortedInts = ints;
+			Parallel::sort(sortedInts.begin(), sortedInts.end(), std::less<>(), pool);
+			Bench::doNotOptimize(sortedInts[n / 2]);
+		});
+		Bench::measure("int64  Parallel::radixSort", n, [&] {
+			sortedInts = ints;
+			Parallel::radixSort(sortedInts.data(), sortedInts.data() + n, pool);
+			Bench::doNotOptimize(sortedInts[n / 2]);
+		});
+		Bench::measure("double Parallel::radixSort", n, [&] {
+			sortedDoubles = doubles;
+			Parallel::radixSort(sortedDoubles.data(), sortedDoubles.data() + n, pool);
+			Bench::doNotOptimize(sortedDoubles[n / 2]);
+		});
+		Bench::measure("double Parallel::transform(sqrt)", n, [&] {
+			Parallel::transform(doubles.begin(), doubles.end(), sortedDoubles.begin(), [](double x) { return std::sqrt(std::fabs(x)); }, pool);
+			Bench::doNotOptimize(sortedDoubles[n / 2]);
+		});
+		Bench::measure("int64  Parallel::inclusiveScan", n, [&] {
+			Parallel::inclusiveScan(ints.begin(), ints.end(), sortedInts.begin(), std::plus<>(), pool);
+			Bench::doNotOptimize(sortedInts[n - 1]);
+		});
+	}
+
+	Bench::measure("double std::transform(sqrt)", n, [&] {
+		std::transform(doubles.begin(), doubles.end(), sortedDoubles.begin(), [](double x) { return std::sqrt(std::fabs(x)); });
+		Bench::doNotOptimize(sortedDoubles[n / 2]);
+	});
+	Bench::measure("int64  std::partial_sum", n, [&] {
+		std::partial_sum(ints.begin(), ints.end(), sortedInts.begin());
+		Bench::doNotOptimize(sortedInts[n - 1]);
+	});
+}
+
+
+//==============================================================
+//	8. ISA kernels: each Kernels level forced in turn
+//==============================================================
+//	Every level must reproduce the v_sse2 results bit for bit; levels the
+//	CPU lacks are skipped.
+
+void benchKernels(size_t n)
+{
+	std::mt19937_64 rng(13);
+	std::vector<double> doubles(n);
+	std::vector<int64_t> ints(n);
+	for (size_t i = 0; i < n; ++i) {
+		doubles[i] = static_cast<double>(rng() >> 11) * 0x1p-53 - 0.5;
+		ints[i] = static_cast<int64_t>(rng());
+	}
+	const size_t bytes = n * sizeof(double);
+	std::vector<unsigned char> copied(bytes);
+
+	const double expectedSum = Kernels::Isa::v_sse2::sum(doubles.data(), n);
+	const int64_t expectedIntSum = Kernels::Isa::v_sse2::sum(ints.data(), n);
+	const uint64_t expectedHash = Kernels::Isa::v_sse2::hash(doubles.data(), bytes, 1);
+
+	std::printf("  detected level: %s\n", Kernels::name(Kernels::supportedLevel()));
+	for (Kernels::Level level : { Kernels::Level::Sse2, Kernels::Level::Avx2, Kernels::Level::Avx512 }) {
+		if (!Kernels::force(level)) {
+			std::printf("  -- %s: not supported, skipped\n", Kernels::name(level));
+			continue;
+		}
+		std::printf("  -- %s\n", Kernels::name(level));
+
+		Kernels::copy(copied.data(), doubles.data(), bytes);
+		if (Kernels::sum(doubles.data(), n) != expectedSum || Kernels::sum(ints.data(), n) != expectedIntSum ||
+			Kernels::hash(doubles.data(), bytes, 1) != expectedHash || std::memcmp(copied.data(), doubles.data(), bytes) != 0) {
+			std::printf("  %s results differ from sse2\n", Kernels::name(level));
+			std::exit(1);
+		}
+
+		Bench::measure("double Kernels::sum", n, [&] {
+			Bench::doNotOptimize(Kernels::sum(doubles.data(), n));
+		});
+		Bench::measure("int64  Kernels::sum", n, [&] {
+			Bench::doNotOptimize(Kernels::sum(ints.data(), n));
+		});
+		Bench::measure("Kernels::copy (per byte)", bytes, [&] {
+			Kernels::copy(copied.data(), doubles.data(), bytes);
+			Bench::doNotOptimize(copied[bytes / 2]);
+		});
+		Bench::measure("Kernels::hash (per byte)", bytes, [&] {
+			Bench::doNotOptimize(Kernels::hash(doubles.data(), bytes, 1));
+		});
+	}
+	Kernels::reset();
+
+	Bench::measure("double std::accumulate", n, [&] {
+		Bench::doNotOptimize(std::accumulate(doubles.begin(), doubles.end(), 0.0));
+	});
+	Bench::measure("std::memcpy (per byte)", bytes, [&] {
+		std::memcpy(copied.data(), doubles.data(), bytes);
+		Bench::doNotOptimize(copied[bytes / 2]);
+	});
+}
+
+
+//==============================================================
+//	9. Type traits: Buffer<T> growth, zeroing and comparison
+//==============================================================
+//	The same unique_ptr holder with and without the trivially_relocatable
+//	opt-in, growing by doubling from empty to items elements.
+
+struct MovedHandle
+{
+	std::unique_ptr<int> p;
+};
+
+struct RelocatedHandle
+{
+	std::unique_ptr<int> p;
+	using trivially_relocatable = std::true_type;
+};
+
+struct ZeroedPoint
+{
+	int64_t x = 0, y = 0;
+	using bitwise_zeroable = std::true_type;
+};
+
+struct ConstructedPoint
+{
+	int64_t x = 0, y = 0;
+	using bitwise_comparable = std::true_type;
+};
+
+template <typename T>
+void benchGrowth(const char* name, size_t n)
+{
+	Bench::measure(name, n, [&] {
+		Buffer<T> grown("grown", 0);
+		for (size_t i = 0; i < n; ++i) {
+			if (i == grown.size())
+				grown.resize(std::max<size_t>(16, grown.size() * 2));
+			grown[i].p.reset();
+		}
+		Bench::doNotOptimize(grown.size());
+	});
+}
+
+void benchTraits(size_t n)
+{
+	benchGrowth<MovedHandle>("Buffer<MovedHandle> growth (move + destroy)", n);
+	benchGrowth<RelocatedHandle>("Buffer<RelocatedHandle> growth (realloc)", n);
+	Bench::measure("std::vector<MovedHandle> growth", n, [&] {
+		std::vector<MovedHandle> grown;
+		for (size_t i = 0; i < n; ++i)
+			grown.emplace_back();
+		Bench::doNotOptimize(grown.size());
+	});
+
+	Bench::measure("Buffer<ConstructedPoint>(n) (construct)", n, [&] {
+		Buffer<ConstructedPoint> points("points", n);
+		Bench::doNotOptimize(points[n / 2].x);
+	});
+	Bench::measure("Buffer<ZeroedPoint>(n) (calloc)", n, [&] {
+		Buffer<ZeroedPoint> points("points", n);
+		Bench::doNotOptimize(points[n / 2].x);
+	});
+
+	Buffer<ConstructedPoint> a("a", n), b("b", n);
+	Bench::measure("ConstructedPoint equality, std::equal", n, [&] {
+		Bench::doNotOptimize(std::equal(a.begin(), a.end(), b.begin(), [](const ConstructedPoint& l, const ConstructedPoint& r) {
+			return l.x == r.x && l.y == r.y;
+		}));
+	});
+	Bench::measure("ConstructedPoint equality, Buffer== (memcmp)", n, [&] {
+		Bench::doNotOptimize(a == b);
+	});
+}
+
+
+//==============================================================
+//	10. Enum-keyed lookups: enum_map / enum_set vs std::map / std::unordered_map
+//==============================================================
+
+enum class Color : unsigned int { Red = 0xff0000, Green = 0xff00, Blue = 0xff };
+using ColorValues = Enums::values<Color::Red, Color::Green, Color::Blue>;
+
+enum class Opcode : uint8_t { Nop, Load, Store, Add, Sub, Mul, Div, And, Or, Xor, Shl, Shr, Jmp, Jz, Call, Ret };
+
+template <typename Map, typename E>
+void benchLookup(const char* name, const std::vector<E>& keys, Map& map)
+{
+	Bench::measure(name, keys.size(), [&] {
+		for (E key : keys)
+			++map[key];
+		Bench::doNotOptimize(map);
+	});
+}
+
+template <typename E, typename Traits>
+void benchEnumKeys(const char* title, size_t n)
+{
+	using Index = Enums::Index<Traits>;
+	std::mt19937 rng(42);
+	std::vector<E> keys(n);
+	for (E& key : keys)
+		key = Index::value(rng() % Index::count);
+
+	std::printf(" %s (%zu enumerators)\n", title, Index::count);
+	std::map<E, uint64_t> tree;
+	benchLookup("std::map", keys, tree);
+	std::unordered_map<E, uint64_t> hashed;
+	benchLookup("std::unordered_map", keys, hashed);
+	enum_map<E, uint64_t, Traits> flat;
+	benchLookup(Index::dense ? "enum_map (offset)" : "enum_map (perfect hash)", keys, flat);
+}
+
+void benchEnums(size_t n)
+{
+	benchEnumKeys<Color, ColorValues>("Color, sparse", n);
+	benchEnumKeys<Opcode, enum_traits<Opcode>>("Opcode, dense", n);
+
+	std::mt19937 rng(7);
+	std::vector<Opcode> ops(n);
+	for (Opcode& op : ops)
+		op = static_cast<Opcode>(rng() % 16);
+
+	Bench::measure("std::set<Opcode> insert + contains", n, [&] {
+		std::set<Opcode> seen;
+		size_t hits = 0;
+		for (Opcode op : ops) {
+			hits += seen.count(op);
+			seen.insert(op);
+		}
+		Bench::doNotOptimize(hits);
+	});
+	Bench::measure("enum_set<Opcode> insert + contains", n, [&] {
+		enum_set<Opcode> seen;
+		size_t hits = 0;
+		for (Opcode op : ops) {
+			hits += seen.contains(op);
+			seen.insert(op);
+		}
+		Bench::doNotOptimize(hits);
+	});
+}
+
+
+//==============================================================
+//	11. Three-level int keys: flat_map<tuple<int, int, int>> vs nested std::map
+//==============================================================
+
+size_t countedBytes = 0;
+
+//  std::allocator that tracks the bytes the nested maps hold.
+template <typename T>
+struct CountingAllocator
+{
+	using value_type = T;
+
+	CountingAllocator() = default;
+	template <typename U>
+	CountingAllocator(const CountingAllocator<U>&) {}
+
+	T* allocate(size_t n)
+	{
+		countedBytes += n * sizeof(T);
+		return std::allocator<T>().allocate(n);
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		countedBytes -= n * sizeof(T);
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	friend bool operator==(const CountingAllocator&, const CountingAllocator&) { return true; }
+	friend bool operator!=(const CountingAllocator&, const CountingAllocator&) { return false; }
+};
+
+template <typename K, typename V>
+using CountedMap = std::map<K, V, std::less<K>, CountingAllocator<std::pair<const K, V>>>;
+using NestedMap = CountedMap<int, CountedMap<int, CountedMap<int, int>>>;
+using Key3 = std::tuple<int, int, int>;
+
+void benchFlatMap(size_t n)
+{
+	std::mt19937 rng(3);
+	std::vector<std::pair<Key3, int>> entries(n);
+	for (size_t i = 0; i < n; ++i)
+		entries[i] = { Key3(static_cast<int>(rng() % 64), static_cast<int>(rng() % 64), static_cast<int>(rng())), static_cast<int>(i) };
+	std::vector<Key3> probes(n);
+	for (size_t i = 0; i < n; ++i)
+		probes[i] = entries[rng() % n].first;
+
+	NestedMap nested;
+	Bench::measure("nested std::map build", n, [&] {
+		nested.clear();
+		for (const auto& [key, value] : entries)
+			nested[std::get<0>(key)][std::get<1>(key)][std::get<2>(key)] = value;
+	}, 1);
+	flat_map<Key3, int> flat;
+	Bench::measure("flat_map bulk build (one sort)", n, [&] {
+		flat = flat_map<Key3, int>(entries); // copies entries, as the nested build reads them
+	}, 1);
+
+	Bench::measure("nested std::map lookup", n, [&] {
+		long long sum = 0;
+		for (const Key3& key : probes)
+			sum += nested.find(std::get<0>(key))->second.find(std::get<1>(key))->second.find(std::get<2>(key))->second;
+		Bench::doNotOptimize(sum);
+	});
+	Bench::measure("flat_map lookup", n, [&] {
+		long long sum = 0;
+		for (const Key3& key : probes)
+			sum += flat.find(key).value();
+		Bench::doNotOptimize(sum);
+	});
+
+	Bench::measure("nested std::map prefix (k1, k2) scan", n, [&] {
+		long long sum = 0;
+		for (int k1 = 0; k1 < 64; ++k1)
+			for (int k2 = 0; k2 < 64; ++k2) {
+				const auto level1 = nested.find(k1);
+				if (level1 == nested.end())
+					continue;
+				const auto level2 = level1->second.find(k2);
+				if (level2 == level1->second.end())
+					continue;
+				for (const auto& entry : level2->second)
+					sum += entry.second;
+			}
+		Bench::doNotOptimize(sum);
+	});
+	Bench::measure("flat_map prefix (k1, k2) scan", n, [&] {
+		long long sum = 0;
+		for (int k1 = 0; k1 < 64; ++k1)
+			for (int k2 = 0; k2 < 64; ++k2)
+				for (auto entry : flat.prefix(k1, k2))
+					sum += entry.second;
+		Bench::doNotOptimize(sum);
+	});
+
+	std::printf("  memory: nested std::map %.1f bytes/entry, flat_map %.1f bytes/entry\n",
+		static_cast<double>(countedBytes) / static_cast<double>(flat.size()), static_cast<double>(flat.memory()) / static_cast<double>(flat.size()));
+}
+
+
+//==============================================================
+//	12. Ordered maps: btree_map vs std::map, 10^3 keys up to items
+//==============================================================
+
+template <typename Map>
+void benchOrdered(const char* name, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& probes)
+{
+	const size_t n = keys.size();
+	char label[64];
+	Map map;
+	std::snprintf(label, sizeof label, "%s insert", name);
+	Bench::measure(label, n, [&] {
+		map = Map();
+		for (uint64_t key : keys)
+			map[key] = key;
+	}, 1);
+
+	std::snprintf(label, sizeof label, "%s lookup", name);
+	Bench::measure(label, probes.size(), [&] {
+		uint64_t sum = 0;
+		for (uint64_t key : probes)
+			sum += map.find(key)->second;
+		Bench::doNotOptimize(sum);
+	});
+
+	std::snprintf(label, sizeof label, "%s range scan (64 from lower_bound)", name);
+	Bench::measure(label, probes.size() * 64, [&] {
+		uint64_t sum = 0;
+		for (uint64_t key : probes) {
+			auto it = map.lower_bound(key);
+			for (int k = 0; k < 64 && it != map.end(); ++k, ++it)
+				sum += it->second;
+		}
+		Bench::doNotOptimize(sum);
+	});
+}
+
+void benchBTree(size_t n)
+{
+	using CountedTree = std::map<uint64_t, uint64_t, std::less<uint64_t>, CountingAllocator<std::pair<const uint64_t, uint64_t>>>;
+	using Tree = btree_map<uint64_t, uint64_t>;
+
+	for (size_t size = 1000; size <= std::max<size_t>(n, 1000); size *= 10) {
+		std::printf(" %zu keys\n", size);
+		std::mt19937_64 rng(size);
+		std::vector<uint64_t> keys(size);
+		for (uint64_t& key : keys)
+			key = rng();
+		std::vector<uint64_t> probes(std::min<size_t>(size, 1000000));
+		for (uint64_t& probe : probes)
+			probe = keys[rng() % size];
+
+		const size_t before = countedBytes;
+		{
+			CountedTree tree;
+			for (uint64_t key : keys)
+				tree[key] = key;
+			const size_t treeBytes = countedBytes - before;
+			std::printf("  memory: std::map %.1f bytes/key", static_cast<double>(treeBytes) / static_cast<double>(size));
+		}
+
+		std::vector<std::pair<uint64_t, uint64_t>> sorted(size);
+		for (size_t i = 0; i < size; ++i)
+			sorted[i] = { keys[i], keys[i] };
+		std::sort(sorted.begin(), sorted.end());
+		sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+		Tree bulk;
+		Bench::doNotOptimize(bulk);
+		bulk.assign_sorted(sorted.begin(), sorted.end());
+		std::printf(", btree_map %.1f bytes/key bulk loaded\n", static_cast<double>(bulk.memory()) / static_cast<double>(bulk.size()));
+		Bench::measure("btree_map bulk load from sorted", sorted.size(), [&] {
+			bulk.assign_sorted(sorted.begin(), sorted.end());
+		}, 1);
+
+		benchOrdered<std::map<uint64_t, uint64_t>>("std::map", keys, probes);
+		benchOrdered<Tree>("btree_map", keys, probes);
+		benchOrdered<btree_map<uint64_t, uint64_t, std::less<uint64_t>, 4096>>("btree_map<4 KiB nodes>", keys, probes);
+	}
+}
+
+
+//==============================================================
+//	13. Logging: Log::print vs ostream << endl, per-call latency
+//==============================================================
+
+#if defined(_WIN32)
+const char* const nullDevice = "NUL";
+#else
+const char* const nullDevice = "/dev/null";
+#endif
+
+template <typename Fn>
+void benchLatency(const char* name, size_t n, Fn&& fn)
+{
+	std::vector<int64_t> samples(n);
+	for (size_t i = 0; i < n; ++i) {
+		const auto start = std::chrono::steady_clock::now();
+		fn(i);
+		samples[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	auto percentile = [&](double p) {
+		auto it = samples.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(n - 1));
+		std::nth_element(samples.begin(), it, samples.end());
+		return static_cast<double>(*it);
+	};
+	const double p50 = percentile(0.50);
+	const double p99 = percentile(0.99);
+	std::printf("  %-44s p50 %8.0f ns   p99 %8.0f ns\n", name, p50, p99);
+}
+
+void benchLog(size_t n)
+{
+	const size_t calls = std::max<size_t>(std::min<size_t>(n, 200000), 100);
+
+	Log::Options options;
+	options.path = nullDevice;
+	options.ringBytes = size_t(1) << 22;
+	options.overflow = Log::Overflow::Block;
+	Log::configure(options);
+	std::ofstream stream(nullDevice);
+	const std::string text = "value";
+
+	benchLatency("timer overhead (empty call)", calls, [](size_t i) { Bench::doNotOptimize(i); });
+	benchLatency("ostream << int << endl", calls, [&](size_t i) { stream << " normal f() - " << i << std::endl; });
+	benchLatency("ostream << int, double, string << endl", calls, [&](size_t i) {
+		stream << " normal f() - " << i << ' ' << 0.5 * static_cast<double>(i) << ' ' << text << std::endl;
+	});
+	Log::print("warm up");
+	Log::flush();
+	benchLatency("Log::print int", calls, [](size_t i) { Log::print(" normal f() - {}", i); });
+	Log::flush();
+	benchLatency("Log::print int, double, string", calls, [&](size_t i) { Log::print(" normal f() - {} {} {}", i, 0.5 * static_cast<double>(i), text); });
+	Log::flush();
+
+	Bench::measure("ostream << int << endl throughput", calls, [&] {
+		for (size_t i = 0; i < calls; ++i)
+			stream << " normal f() - " << i << std::endl;
+	});
+	Bench::measure("Log::print int throughput, incl. flush", calls, [&] {
+		for (size_t i = 0; i < calls; ++i)
+			Log::print(" normal f() - {}", i);
+		Log::flush();
+	});
+}
+
+
+//==============================================================
+//	14. Expression templates: a + b * c - 0.5 * d, 10^6 elements up to items
+//==============================================================
+
+//  The eager alternative: every operator returns a new vector.
+namespace Naive {
+	struct Vec
+	{
+		std::vector<double> v;
+	};
+
+	template <typename F>
+	Vec apply(const Vec& a, const Vec& b, F f)
+	{
+		Vec r{ std::vector<double>(a.v.size()) };
+		for (size_t i = 0; i < a.v.size(); ++i)
+			r.v[i] = f(a.v[i], b.v[i]);
+		return r;
+	}
+
+	Vec operator+(const Vec& a, const Vec& b) { return apply(a, b, std::plus<>()); }
+	Vec operator-(const Vec& a, const Vec& b) { return apply(a, b, std::minus<>()); }
+	Vec operator*(const Vec& a, const Vec& b) { return apply(a, b, std::multiplies<>()); }
+
+	Vec operator*(double s, const Vec& a)
+	{
+		Vec r{ std::vector<double>(a.v.size()) };
+		for (size_t i = 0; i < a.v.size(); ++i)
+			r.v[i] = s * a.v[i];
+		return r;
+	}
+}
+
+void benchExpr(size_t n)
+{
+	using namespace Expr::Operators;
+
+	for (size_t size = 1000000; size <= std::max<size_t>(n, 1000000); size *= 10) {
+		std::printf(" %zu elements\n", size);
+		std::vector<double> a(size), b(size), c(size), d(size), r(size);
+		for (size_t i = 0; i < size; ++i) {
+			a[i] = static_cast<double>(i);
+			b[i] = 1.0 + 1e-9 * static_cast<double>(i);
+			c[i] = 2.0;
+			d[i] = static_cast<double>(i & 1023);
+		}
+
+		Bench::measure("hand-written loop", size, [&] {
+			for (size_t i = 0; i < size; ++i)
+				r[i] = a[i] + b[i] * c[i] - 0.5 * d[i];
+			Bench::doNotOptimize(r);
+		});
+		Bench::measure("Expr::assign(r, a + b * c - 0.5 * d)", size, [&] {
+			Expr::assign(r, a + b * c - 0.5 * d);
+			Bench::doNotOptimize(r);
+		});
+		Bench::measure("Vec r = a + b * c - 0.5 * d (new vector)", size, [&] {
+			std::vector<double> fresh = a + b * c - 0.5 * d;
+			Bench::doNotOptimize(fresh);
+		});
+		Bench::measure("Expr::assign(r, r * 0.5 + a) (in place)", size, [&] {
+			Expr::assign(r, r * 0.5 + a);
+			Bench::doNotOptimize(r);
+		});
+		Bench::measure("Expr::sum(a * b) (fused dot product)", size, [&] {
+			Bench::doNotOptimize(Expr::sum(a * b));
+		});
+
+		{
+			const Naive::Vec na{ a }, nb{ b }, nc{ c }, nd{ d };
+			Naive::Vec nr;
+			Bench::measure("naive operators (a temporary per operator)", size, [&] {
+				nr = na + nb * nc - 0.5 * nd;
+				Bench::doNotOptimize(nr);
+			});
+		}
+		{
+			const std::valarray<double> va(a.data(), size), vb(b.data(), size), vc(c.data(), size), vd(d.data(), size);
+			std::valarray<double> vr(size);
+			Bench::measure("std::valarray", size, [&] {
+				vr = va + vb * vc - 0.5 * vd;
+				Bench::doNotOptimize(vr);
+			});
+		}
+	}
+}
+
+
+//==============================================================
+//	15. Strings: std::string vs small_string vs interned Symbol
+//==============================================================
+
+void benchIntern(size_t n)
+{
+//  3000 distinct values: three-letter team codes and longer team names
+	std::mt19937 rng(15);
+	std::vector<std::string> pool;
+	for (int i = 0; i < 3000; ++i) {
+		std::string text;
+		const size_t length = i % 3 == 0 ? 3 : 8 + rng() % 30;
+		for (size_t k = 0; k < length; ++k)
+			text += static_cast<char>('A' + rng() % 26);
+		pool.push_back(text);
+	}
+
+	std::vector<std::string> strings(n);
+	for (std::string& s : strings)
+		s = pool[rng() % pool.size()];
+	std::vector<small_string> smalls(strings.begin(), strings.end());
+
+	SymbolTable table;
+	std::vector<Symbol> symbols(n);
+	Bench::measure("SymbolTable::intern", n, [&] {
+		for (size_t i = 0; i < n; ++i)
+			symbols[i] = table.intern(strings[i]);
+	});
+	Bench::measure("SymbolTable::view", n, [&] {
+		size_t length = 0;
+		for (Symbol s : symbols)
+			length += table.view(s).size();
+		Bench::doNotOptimize(length);
+	});
+
+	size_t stringBytes = 0, smallBytes = 0;
+	for (const std::string& s : strings)
+		stringBytes += sizeof s + (s.capacity() > 15 ? s.capacity() + 1 : 0);
+	for (const small_string& s : smalls)
+		smallBytes += sizeof s + (s.size() > small_string::inline_capacity() ? s.capacity() + 1 : 0);
+	const double count = static_cast<double>(n);
+	std::printf("  memory per string: std::string %.1f bytes, small_string %.1f bytes, Symbol %.1f bytes (4 + table %zu KiB for %zu distinct)\n",
+		static_cast<double>(stringBytes) / count, static_cast<double>(smallBytes) / count,
+		sizeof(Symbol) + static_cast<double>(table.memory()) / count, table.memory() / 1024, table.size());
+
+	auto compare = [&](const char* name, const auto& values) {
+		Bench::measure(name, n, [&] {
+			size_t equal = 0;
+			for (size_t i = 1; i < values.size(); ++i)
+				equal += values[i] == values[i - 1];
+			Bench::doNotOptimize(equal);
+		});
+	};
+	compare("compare adjacent std::string", strings);
+	compare("compare adjacent small_string", smalls);
+	compare("compare adjacent Symbol", symbols);
+
+	auto hash = [&](const char* name, const auto& values) {
+		using Value = typename std::decay_t<decltype(values)>::value_type;
+		Bench::measure(name, n, [&] {
+			size_t h = 0;
+			for (const Value& value : values)
+				h += std::hash<Value>()(value);
+			Bench::doNotOptimize(h);
+		});
+	};
+	hash("std::hash<std::string>", strings);
+	hash("std::hash<small_string>", smalls);
+	hash("std::hash<Symbol>", symbols);
+
+	auto tally = [&](const char* name, const auto& values) {
+		using Value = typename std::decay_t<decltype(values)>::value_type;
+		std::unordered_map<Value, int> counts;
+		Bench::measure(name, n, [&] {
+			counts.clear();
+			for (const Value& value : values)
+				++counts[value];
+		}, 1);
+	};
+	tally("unordered_map<std::string, int> counting", strings);
+	tally("unordered_map<Symbol, int> counting", symbols);
+}
+
+
+//==============================================================
+//	16. Regex: compiled and lazy DFAs vs std::regex on log lines
+//==============================================================
+
+static constexpr char timeoutPattern[] = "ERROR .*timed? ?out";
+static constexpr char latencyPattern[] = "[0-9]+ms";
+static constexpr char diskPattern[] = "^(WARN|ERROR) .*disk";
+
+template <typename Search>
+void benchFilter(const char* name, const std::vector<std::string>& lines, size_t bytes, Search&& search)
+{
+	size_t hits = 0;
+	const double ns = Bench::measure(name, lines.size(), [&] {
+		hits = 0;
+		for (const std::string& line : lines)
+			hits += search(line);
+	}, 1);
+	std::printf("  %-44s %10zu matches %8.0f MB/s\n", "", hits, static_cast<double>(bytes) / static_cast<double>(lines.size()) / ns * 1e3);
+}
+
+template <const char* P>
+void benchPattern(const std::vector<std::string>& lines, size_t bytes)
+{
+	std::printf(" pattern %s\n", P);
+	Bench::measure("std::regex construction", 1000, [] {
+		for (int k = 0; k < 1000; ++k)
+			Bench::doNotOptimize(std::regex(P));
+	}, 1);
+	Bench::measure("Regex::Pattern construction", 1000, [] {
+		for (int k = 0; k < 1000; ++k)
+			Bench::doNotOptimize(Regex::Pattern(P));
+	}, 1);
+
+	const std::regex standard(P);
+	Regex::Pattern lazy(P);
+	Regex::Compiled<P> compiled;
+	benchFilter("std::regex_search", lines, bytes, [&](const std::string& line) { return std::regex_search(line, standard); });
+	benchFilter("Regex::Pattern (lazy DFA)", lines, bytes, [&](const std::string& line) { return Regex::search(line, lazy); });
+	benchFilter("Regex::Compiled (constexpr DFA)", lines, bytes, [&](const std::string& line) { return Regex::search(line, compiled); });
+	std::printf("  DFA states: lazy %zu, compiled %zu\n", lazy.states(), compiled.states());
+}
+
+void benchRegex(size_t n)
+{
+	const char* levels[] = { "INFO", "INFO", "INFO", "WARN", "ERROR" };
+	const char* messages[] = { "request served in", "cache refreshed after", "disk write timed out after", "connection timeout after", "disk almost full at" };
+	std::mt19937 rng(16);
+	auto random = [&](unsigned bound) { return static_cast<unsigned>(rng() % bound); };
+	std::vector<std::string> lines(std::min<size_t>(n, 200000));
+	size_t bytes = 0;
+	for (std::string& line : lines) {
+		char text[160];
+		std::snprintf(text, sizeof text, "%s 2024-05-%02u 12:%02u:%02u.%03u worker-%u %s %ums", levels[random(5)],
+			1 + random(28), random(60), random(60), random(1000), random(64), messages[random(5)], random(5000));
+		line = text;
+		bytes += line.size();
+	}
+
+	benchPattern<timeoutPattern>(lines, bytes);
+	benchPattern<latencyPattern>(lines, bytes);
+	benchPattern<diskPattern>(lines, bytes);
+}
+
+
+//==============================================================
+//	17. Random numbers: Random::fill vs std::mt19937 and <random>
+//==============================================================
+
+//  Prints throughput in GB/s of variates written, for a time per item.
+static void printRate(double ns, size_t bytesPerItem)
+{
+	std::printf("  %-44s %10.2f GB/s\n", "", static_cast<double>(bytesPerItem) / ns);
+}
+
+//  Mean and variance within 6 standard errors of the expected values, and
+//  for normals the share within one standard deviation near 68.27%.
+template <typename T>
+void checkMoments(const char* name, const Buffer<T>& values, double mean, double variance, double fourthMoment)
+{
+	const double count = static_cast<double>(values.size());
+	double sum = 0, squares = 0;
+	for (T x : values)
+		sum += static_cast<double>(x);
+	const double m = sum / count;
+	for (T x : values)
+		squares += (static_cast<double>(x) - m) * (static_cast<double>(x) - m);
+	const double v = squares / count;
+	const bool ok = std::fabs(m - mean) < 6 * std::sqrt(variance / count) &&
+		std::fabs(v - variance) < 6 * std::sqrt((fourthMoment - variance * variance) / count);
+	std::printf("  %-44s mean %.5f (%.5f) variance %.5f (%.5f) %s\n", name, m, mean, v, variance, ok ? "ok" : "FAIL");
+}
+
+void benchRandom(size_t n)
+{
+	Buffer<double> doubles("doubles", n);
+	Buffer<float> floats("floats", n);
+	std::mt19937 mt(17);
+	std::mt19937_64 mt64(17);
+	Random::Xoshiro256 xoshiro(17);
+	const Random::Philox philox(17);
+
+	std::printf(" raw 64-bit words\n");
+	std::vector<uint64_t> words(n);
+	printRate(Bench::measure("std::mt19937_64", n, [&] {
+		for (uint64_t& w : words)
+			w = mt64();
+		Bench::doNotOptimize(words.data());
+	}), 8);
+	printRate(Bench::measure("Random::Xoshiro256", n, [&] {
+		xoshiro.generate(words.data(), words.size());
+		Bench::doNotOptimize(words.data());
+	}), 8);
+	printRate(Bench::measure("Random::Philox (one value at a time)", n, [&] {
+		Random::Philox stream(17);
+		for (uint64_t& w : words)
+			w = uint64_t(stream()) << 32 | stream();
+		Bench::doNotOptimize(words.data());
+	}), 8);
+
+	auto compare = [&](const char* title, auto standard, const auto& distribution) {
+		std::printf(" %s\n", title);
+		printRate(Bench::measure("std::mt19937 + <random>", n, [&] {
+			for (double& x : doubles)
+				x = standard(mt);
+			Bench::doNotOptimize(doubles.data());
+		}), 8);
+		printRate(Bench::measure("Random::Xoshiro256 + <random>", n, [&] {
+			for (double& x : doubles)
+				x = standard(xoshiro);
+			Bench::doNotOptimize(doubles.data());
+		}), 8);
+		printRate(Bench::measure("Random::fill Xoshiro256 double", n, [&] {
+			Random::fill(doubles, distribution, xoshiro);
+			Bench::doNotOptimize(doubles.data());
+		}), 8);
+		printRate(Bench::measure("Random::fill Philox double, one thread", n, [&] {
+			Random::fill(doubles.data(), n, distribution, philox);
+			Bench::doNotOptimize(doubles.data());
+		}), 8);
+		printRate(Bench::measure("Random::fill Philox float, one thread", n, [&] {
+			Random::fill(floats.data(), n, distribution, philox);
+			Bench::doNotOptimize(floats.data());
+		}), 4);
+		printRate(Bench::measure("Random::fill Philox double, ThreadPool", n, [&] {
+			Random::fill(doubles, distribution, philox);
+			Bench::doNotOptimize(doubles.data());
+		}), 8);
+	};
+	compare("uniform [0, 1)", std::uniform_real_distribution<double>(0, 1), Random::Uniform{ 0, 1 });
+	compare("normal (0, 1)", std::normal_distribution<double>(0, 1), Random::Normal{ 0, 1 });
+	compare("exponential (1)", std::exponential_distribution<double>(1), Random::Exponential{ 1 });
+
+	std::printf(" sanity\n");
+	Random::fill(doubles, Random::Uniform{ -1, 3 }, philox);
+	checkMoments("uniform [-1, 3) double", doubles, 1, 16.0 / 12, 256.0 / 80);
+	Random::fill(floats, Random::Uniform{ -1, 3 }, philox);
+	checkMoments("uniform [-1, 3) float", floats, 1, 16.0 / 12, 256.0 / 80);
+	Random::fill(doubles, Random::Normal{ 2, 3 }, philox);
+	checkMoments("normal (2, 3) double", doubles, 2, 9, 3 * 81);
+	size_t within = 0;
+	for (double x : doubles)
+		within += std::fabs(x - 2) < 3;
+	std::printf("  %-44s %.4f (0.6827)\n", "normal share within one sigma", static_cast<double>(within) / static_cast<double>(n));
+	Random::fill(floats, Random::Normal{ 2, 3 }, philox);
+	checkMoments("normal (2, 3) float", floats, 2, 9, 3 * 81);
+	Random::fill(doubles, Random::Exponential{ 0.5 }, xoshiro);
+	checkMoments("exponential (0.5) double, Xoshiro256", doubles, 2, 4, 9 * 16 - 16);
+
+//  9 * 16 - 16: the fourth central moment of an exponential is 9 / lambda^4
+
+	Buffer<double> threads("threads", n);
+	bool same = true;
+	for (unsigned count : { 1u, 2u, 3u, 8u }) {
+		ThreadPool pool(count);
+		Random::fill(threads, Random::Normal{}, philox, pool);
+		if (count == 1)
+			doubles = threads;
+		same = same && doubles == threads;
+	}
+	std::printf("  %-44s %s\n", "Philox fill identical on 1, 2, 3, 8 threads", same ? "ok" : "FAIL");
+
+	Random::Xoshiro256 first(17), second = first.stream(1);
+	std::uniform_int_distribution<int> dice(1, 6);
+	size_t equal = 0;
+	for (size_t i = 0; i < n; ++i)
+		equal += dice(first) == dice(second);
+	std::printf("  %-44s %.4f (0.1667)\n", "Xoshiro256 stream 0 vs 1 agreement", static_cast<double>(equal) / static_cast<double>(n));
+}
+
+
+//==============================================================
+//	18. Metrics: sharded Counter and Histogram vs one std::atomic, 1-64 threads
+//==============================================================
+
+//  Runs body(thread, iterations) on threads threads that start together.
+template <typename Body>
+void runThreads(unsigned threads, size_t iterations, const Body& body)
+{
+	std::atomic<unsigned> ready{ 0 };
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < threads; ++t)
+		workers.emplace_back([&, t] {
+			ready.fetch_add(1);
+			while (ready.load() < threads)
+				std::this_thread::yield();
+			body(t, iterations);
+		});
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void benchMetrics(size_t n)
+{
+	std::printf(" ns per increment over all threads (%u hardware threads)\n", std::thread::hardware_concurrency());
+	for (unsigned threads : { 1u, 2u, 4u, 8u, 16u, 32u, 64u }) {
+		const size_t each = std::max<size_t>(1, n / threads);
+		char name[64];
+
+		std::atomic<uint64_t> single{ 0 };
+		std::snprintf(name, sizeof name, "std::atomic fetch_add, %u threads", threads);
+		Bench::measure(name, each * threads, [&] {
+			runThreads(threads, each, [&](unsigned, size_t k) {
+				while (k-- > 0)
+					single.fetch_add(1, std::memory_order_relaxed);
+			});
+		});
+
+		Metrics::Counter counter;
+		std::snprintf(name, sizeof name, "Metrics::Counter::add, %u threads", threads);
+		Bench::measure(name, each * threads, [&] {
+			runThreads(threads, each, [&](unsigned, size_t k) {
+				while (k-- > 0)
+					counter.add();
+			});
+		});
+
+		Metrics::Histogram histogram;
+		std::snprintf(name, sizeof name, "Metrics::Histogram::record, %u threads", threads);
+		Bench::measure(name, each * threads, [&] {
+			runThreads(threads, each, [&](unsigned t, size_t k) {
+				for (uint64_t v = 1000 + t; k-- > 0; v += 7)
+					histogram.record(v & 0xFFFF);
+			});
+		});
+
+		if (counter.value() != single.load() || histogram.snapshot().count != single.load())
+			std::printf("  counts differ: atomic %llu, Counter %llu\n", static_cast<unsigned long long>(single.load()), static_cast<unsigned long long>(counter.value()));
+	}
+}
+
+
+//==============================================================
+//	19. Incremental graph: recompute after small input changes vs full recompute
+//==============================================================
+
+//  Stand-in for an expensive derived value: a few microseconds of math.
+static double blockModel(const std::vector<double>& values)
+{
+	double total = 0;
+	for (int round = 0; round < 16; ++round)
+		for (double v : values)
+			total += std::sqrt(v * v + round);
+	return total;
+}
+
+void benchIncremental(size_t n)
+{
+//  inputs in blocks of 16, each modelled; block results summed in groups of
+//  16, then into one total
+	const size_t inputs = std::max<size_t>(256, std::min<size_t>(n, 1 << 16)) / 256 * 256;
+	const size_t blocks = inputs / 16, groups = blocks / 16;
+	std::vector<double> values(inputs, 1.0);
+
+	auto fullRecompute = [&] {
+		double total = 0;
+		for (size_t g = 0; g < groups; ++g) {
+			double group = 0;
+			for (size_t b = g * 16; b < g * 16 + 16; ++b)
+				group += blockModel(std::vector<double>(values.begin() + static_cast<std::ptrdiff_t>(b * 16), values.begin() + static_cast<std::ptrdiff_t>(b * 16 + 16)));
+			total += group;
+		}
+		return total;
+	};
+
+	Incremental::Graph graph;
+	std::vector<Incremental::Input<double>> cells;
+	for (size_t i = 0; i < inputs; ++i)
+		cells.push_back(graph.input("x" + std::to_string(i), values[i]));
+	std::vector<Incremental::Node<double>> blockNodes, groupNodes;
+	for (size_t b = 0; b < blocks; ++b) {
+		const auto* c = &cells[b * 16];
+		blockNodes.push_back(graph.node("block" + std::to_string(b), [](auto... v) { return blockModel({ v... }); },
+			c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7], c[8], c[9], c[10], c[11], c[12], c[13], c[14], c[15]));
+	}
+	for (size_t g = 0; g < groups; ++g) {
+		const auto* b = &blockNodes[g * 16];
+		groupNodes.push_back(graph.node("group" + std::to_string(g), [](auto... v) { return (v + ...); },
+			b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], b[8], b[9], b[10], b[11], b[12], b[13], b[14], b[15]));
+	}
+	std::vector<Incremental::Node<double>> level = groupNodes;
+	while (level.size() > 1) {
+		std::vector<Incremental::Node<double>> next;
+		for (size_t i = 0; i + 1 < level.size(); i += 2)
+			next.push_back(graph.node("sum" + std::to_string(graph.size()), std::plus<double>(), level[i], level[i + 1]));
+		if (level.size() % 2 != 0)
+			next.push_back(level.back());
+		level = next;
+	}
+	const Incremental::Node<double> total = level[0];
+	std::printf(" %zu inputs, %zu block models, %zu nodes\n", inputs, blocks, graph.size());
+
+	double checksum = 0;
+	Bench::measure("full recompute, plain functions", 1, [&] { checksum = fullRecompute(); });
+	Bench::measure("Incremental::Graph first get()", 1, [&] { Bench::doNotOptimize(total.get()); }, 1);
+
+	std::mt19937 rng(19);
+	auto changeAndGet = [&](const char* name, size_t changes, bool parallel) {
+		const size_t before = graph.computations();
+		double value = 0;
+		Bench::measure(name, 1, [&] {
+			for (size_t k = 0; k < changes; ++k) {
+				const size_t i = changes == inputs ? k : rng() % inputs;
+				values[i] += 0.5;
+				cells[i].set(values[i]);
+			}
+			if (parallel)
+				graph.evaluate();
+			value = total.get();
+		});
+		std::printf("  %-44s %10.1f nodes computed per run\n", "", static_cast<double>(graph.computations() - before) / 3);
+		checksum = value;
+	};
+	changeAndGet("Graph, 1 input changed", 1, false);
+	changeAndGet("Graph, 1% of inputs changed", inputs / 100, false);
+	changeAndGet("Graph, all inputs changed, get()", inputs, false);
+	changeAndGet("Graph, all inputs changed, evaluate(ThreadPool)", inputs, true);
+
+	const double expected = fullRecompute();
+	std::printf("  %-44s %s\n", "graph total equals full recompute", std::fabs(checksum - expected) <= 1e-9 * std::fabs(expected) ? "ok" : "FAIL");
+}
+
+
+//==============================================================
+//	20. Rcu::Cell reads under concurrent swaps vs atomic shared_ptr and shared_mutex
+//==============================================================
+
+//  A version object as a reader would see it: one cache line of settings.
+struct BenchVersion
+{
+	uint64_t id = 0;
+	uint64_t limits[7] = {};
+};
+
+//  Times readers threads calling read() each times, in batches of 16,
+//  while another thread calls publish(id) every 20 us.
+template <typename Read, typename Publish>
+void measureSwaps(const char* name, unsigned readers, size_t each, const Read& read, const Publish& publish)
+{
+	Metrics::Histogram batches;
+	std::atomic<bool> done{ false };
+	uint64_t swaps = 0;
+	std::thread writer([&] {
+		while (!done.load(std::memory_order_relaxed)) {
+			publish(++swaps);
+			std::this_thread::sleep_for(std::chrono::microseconds(20));
+		}
+	});
+	Bench::measure(name, each * readers, [&] {
+		runThreads(readers, each, [&](unsigned, size_t k) {
+			uint64_t sum = 0;
+			while (k > 0) {
+				const auto start = std::chrono::steady_clock::now();
+				for (int j = 0; j < 16 && k > 0; ++j, --k)
+					sum += read();
+				batches.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+			}
+			Bench::doNotOptimize(sum);
+		});
+	});
+	done.store(true);
+	writer.join();
+	const Metrics::Histogram::Snapshot s = batches.snapshot();
+	std::printf("  %-44s 16 reads: p50 %llu ns, p99 %llu ns, p99.9 %llu ns; %llu swaps\n", "",
+		static_cast<unsigned long long>(s.quantile(0.5)), static_cast<unsigned long long>(s.quantile(0.99)),
+		static_cast<unsigned long long>(s.quantile(0.999)), static_cast<unsigned long long>(swaps));
+}
+
+void benchRcu(size_t n)
+{
+	std::printf(" ns per read over all reader threads, one writer swapping (%u hardware threads)\n", std::thread::hardware_concurrency());
+	for (unsigned readers : { 1u, 2u, 4u, 8u }) {
+		const size_t each = std::max<size_t>(16, n / readers);
+		char name[64];
+
+		Rcu::Cell<BenchVersion> cell;
+		std::snprintf(name, sizeof name, "Rcu::Cell::read, %u readers", readers);
+		measureSwaps(name, readers, each,
+			[&] { return cell.read([](const BenchVersion& v) { return v.id + v.limits[6]; }); },
+			[&](uint64_t id) { BenchVersion v; v.id = id; cell.publish(v); });
+
+#if defined(__cpp_lib_atomic_shared_ptr)
+		std::atomic<std::shared_ptr<const BenchVersion>> shared{ std::make_shared<const BenchVersion>() };
+		std::snprintf(name, sizeof name, "std::atomic<shared_ptr> load, %u readers", readers);
+		measureSwaps(name, readers, each,
+			[&] { const std::shared_ptr<const BenchVersion> v = shared.load(); return v->id + v->limits[6]; },
+			[&](uint64_t id) { BenchVersion v; v.id = id; shared.store(std::make_shared<const BenchVersion>(v)); });
+#else
+		std::shared_ptr<const BenchVersion> shared = std::make_shared<const BenchVersion>();
+		std::snprintf(name, sizeof name, "std::atomic_load(shared_ptr), %u readers", readers);
+		measureSwaps(name, readers, each,
+			[&] { const std::shared_ptr<const BenchVersion> v = std::atomic_load(&shared); return v->id + v->limits[6]; },
+			[&](uint64_t id) { BenchVersion v; v.id = id; std::atomic_store(&shared, std::make_shared<const BenchVersion>(v)); });
+#endif
+
+		std::shared_mutex mutex;
+		BenchVersion guarded;
+		std::snprintf(name, sizeof name, "std::shared_mutex shared_lock, %u readers", readers);
+		measureSwaps(name, readers, each,
+			[&] { std::shared_lock<std::shared_mutex> lock(mutex); return guarded.id + guarded.limits[6]; },
+			[&](uint64_t id) { BenchVersion v; v.id = id; std::unique_lock<std::shared_mutex> lock(mutex); guarded = v; });
+	}
+	std::printf("  %-44s %zu retired versions left\n", "after Rcu::synchronize()", (Rcu::synchronize(), Rcu::reclaim()));
+}
+
+
+//==============================================================
+//	Driver
+//==============================================================
+
+struct BenchEntry
+{
+	const char* name;
+	void (*run)(size_t);
+};
+
+const BenchEntry benchmarks[] = {
+	{ "to_chars", benchToChars },
+	{ "parse", benchParse },
+	{ "units", benchUnits },
+	{ "lut", benchLut },
+	{ "fft", benchFft },
+	{ "function", benchFunction },
+	{ "parallel", benchParallel },
+	{ "kernels", benchKernels },
+	{ "traits", benchTraits },
+	{ "enums", benchEnums },
+	{ "flat_map", benchFlatMap },
+	{ "btree", benchBTree },
+	{ "log", benchLog },
+	{ "expr", benchExpr },
+	{ "intern", benchIntern },
+	{ "regex", benchRegex },
+	{ "random", benchRandom },
+	{ "metrics", benchMetrics },
+	{ "incremental", benchIncremental },
+	{ "rcu", benchRcu },
+};
+
+int main(int argc, char* argv[])
+{
+	const char* filter = argc > 1 ? argv[1] : "";
+	const size_t n = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+	for (const auto& b : benchmarks) {
+		if (std::strstr(b.name, filter) == nullptr)
+			continue;
+
+		std::printf("[%s] items=%zu\n", b.name, n);
+		b.run(n);
+	}
+	return 0;
+}
@@ -0,0 +1,285 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "TypeTraits.h"
+
+//  Elements live in malloc'd storage, so the traits in TypeTraits.h can pick
+//  calloc for zeroable types, realloc growth for relocatable ones and memcmp
+//  for comparisons.
+template <typename T>
+class Buffer
+{
+//  destroys the elements of one allocation and frees it
+	struct Release
+	{
+		size_t count = 0;
+
+		void operator()(T* p) const
+		{
+			std::destroy(p, p + count);
+			deallocate(p);
+		}
+	};
+	using Storage = std::unique_ptr<T[], Release>;
+
+	static constexpr bool zeroable = Traits::is_bitwise_zeroable_v<T>;
+	static constexpr bool relocatable = Traits::is_trivially_relocatable_v<T> && alignof(T) <= alignof(std::max_align_t);
+
+	std::string _name;
+	size_t      _size;
+	Storage     _buffer;
+
+	static T* allocateRaw(size_t n, bool zero)
+	{
+		void* p;
+		if constexpr (alignof(T) > alignof(std::max_align_t)) {
+			p = ::operator new(n * sizeof(T), std::align_val_t(alignof(T)));
+			if (zero)
+				std::memset(p, 0, n * sizeof(T));
+		}
+		else {
+			p = zero ? std::calloc(n, sizeof(T)) : std::malloc(n * sizeof(T));
+			if (p == nullptr)
+				throw std::bad_alloc();
+		}
+		return static_cast<T*>(p);
+	}
+
+	static void deallocate(T* p)
+	{
+		if constexpr (alignof(T) > alignof(std::max_align_t))
+			::operator delete(p, std::align_val_t(alignof(T)));
+		else
+			std::free(p);
+	}
+
+//  default-initializes [first, last), or leaves calloc's zeros when T allows
+	static void construct(T* first, T* last, bool zeroed)
+	{
+		if constexpr (zeroable) {
+			if (!zeroed)
+				std::memset(static_cast<void*>(first), 0, static_cast<size_t>(last - first) * sizeof(T));
+		}
+		else {
+			(void)zeroed;
+			std::uninitialized_default_construct(first, last);
+		}
+	}
+
+	static Storage allocate(size_t n)
+	{
+		if (n == 0)
+			return Storage(nullptr, Release{ 0 });
+
+		T* p = allocateRaw(n, zeroable);
+		try {
+			construct(p, p + n, true);
+		}
+		catch (...) {
+			deallocate(p);
+			throw;
+		}
+		return Storage(p, Release{ n });
+	}
+
+	static Storage copyOf(const T* source, size_t n)
+	{
+		if (n == 0)
+			return Storage(nullptr, Release{ 0 });
+
+		T* p = allocateRaw(n, false);
+		try {
+			std::uninitialized_copy(source, source + n, p);
+		}
+		catch (...) {
+			deallocate(p);
+			throw;
+		}
+		return Storage(p, Release{ n });
+	}
+
+public:
+//  default constructor
+	Buffer() :
+		_size(16),
+		_buffer(allocate(16))
+	{}
+
+//  constructor
+	Buffer(const std::string& name, size_t size) :
+		_name(name),
+		_size(size),
+		_buffer(allocate(size))
+	{}
+
+//  copy constructor
+	Buffer(const Buffer& copy) :
+		_name(copy._name),
+		_size(copy._size),
+		_buffer(copyOf(copy.data(), copy._size))
+	{}
+
+//  copy assignment operator
+	Buffer& operator=(const Buffer& copy)
+	{
+		if (this != &copy)
+		{
+			_name = copy._name;
+
+			if (_size != copy._size)
+			{
+				_size = copy._size;
+				_buffer = allocate(_size);
+			}
+
+			T* source = copy._buffer.get();
+			T* dest = _buffer.get();
+			std::copy(source, source + copy._size, dest);
+		}
+
+		return *this;
+	}
+
+//  move constructor
+	Buffer(Buffer&& temp) :
+		_name(std::move(temp._name)),
+		_size(temp._size),
+		_buffer(std::move(temp._buffer))
+	{
+		temp._buffer = nullptr;
+		temp._size = 0;
+	}
+
+//  move assignment operator
+	Buffer& operator=(Buffer&& temp)
+	{
+		//static_assert(this != &temp); // assert if this is not a temporary
+
+		_buffer = nullptr;
+		_size = temp._size;
+		_buffer = std::move(temp._buffer);
+
+		_name = std::move(temp._name);
+
+		temp._buffer = nullptr;
+		temp._size = 0;
+
+		return *this;
+	}
+
+//  element access
+	T*       data()       { return _buffer.get(); }
+	const T* data() const { return _buffer.get(); }
+	size_t   size() const { return _size; }
+	const std::string& name() const { return _name; }
+
+	T&       operator[](size_t i)       { return _buffer[i]; }
+	const T& operator[](size_t i) const { return _buffer[i]; }
+
+	T*       begin()       { return data(); }
+	T*       end()         { return data() + _size; }
+	const T* begin() const { return data(); }
+	const T* end()   const { return data() + _size; }
+
+//  replaces element i with T(args...), constructed in the slot itself
+	template <typename... Args>
+	T& emplace(size_t i, Args&&... args)
+	{
+		return emplaceWith(i, [&] { return T(std::forward<Args>(args)...); });
+	}
+
+//  Replaces element i with the T prvalue make() returns. If T() cannot
+//  throw, the result is built in the slot itself with no move, and a throw
+//  from make() leaves T() there, since Release destroys every slot.
+//  Otherwise nothing could refill the slot safely, so the result is built
+//  in a temporary and moved in: one move more, but element i is unchanged
+//  if make() throws.
+	template <typename F>
+	T& emplaceWith(size_t i, F&& make)
+	{
+		T* slot = _buffer.get() + i;
+		if constexpr (std::is_nothrow_default_constructible<T>::value) {
+			slot->~T();
+			try {
+				return *::new (static_cast<void*>(slot)) T(make());
+			}
+			catch (...) {
+				::new (static_cast<void*>(slot)) T();
+				throw;
+			}
+		}
+		else {
+			T made(make());
+			if constexpr (std::is_nothrow_move_constructible<T>::value) {
+				slot->~T();
+				return *::new (static_cast<void*>(slot)) T(std::move(made));
+			}
+			else
+				return *slot = std::move(made);
+		}
+	}
+
+//  resize, keeping the first min(old, new) elements. Trivially relocatable
+//  elements move with realloc, often without copying at all.
+	void resize(size_t size)
+	{
+		if (size == _size)
+			return;
+
+		const size_t kept = std::min(_size, size);
+		if constexpr (relocatable) {
+			if (size == 0) {
+				_buffer = nullptr;
+				_size = 0;
+				return;
+			}
+
+			T* source = _buffer.get();
+			if (size < _size) {
+				std::destroy(source + size, source + _size);
+				_buffer.get_deleter().count = size;
+				_size = size;
+			}
+
+			void* grown = std::realloc(static_cast<void*>(source), size * sizeof(T));
+			if (grown == nullptr) {
+				if (size == _size)
+					return; // a failed shrink keeps the larger block
+				throw std::bad_alloc();
+			}
+			_buffer.release();
+			_buffer = Storage(static_cast<T*>(grown), Release{ kept });
+			construct(_buffer.get() + kept, _buffer.get() + size, false);
+			_buffer.get_deleter().count = size;
+		}
+		else {
+			Storage grown(size > 0 ? allocateRaw(size, zeroable) : nullptr, Release{ 0 });
+			T* source = _buffer.get();
+			if constexpr (std::is_nothrow_move_constructible<T>::value || !std::is_copy_constructible<T>::value)
+				std::uninitialized_move(source, source + kept, grown.get());
+			else
+				std::uninitialized_copy(source, source + kept, grown.get());
+			grown.get_deleter().count = kept;
+
+			construct(grown.get() + kept, grown.get() + size, true);
+			grown.get_deleter().count = size;
+			_buffer = std::move(grown);
+		}
+		_size = size;
+	}
+
+//  element-wise equality; the name is not compared
+	friend bool operator==(const Buffer& a, const Buffer& b)
+	{
+		return a._size == b._size && Traits::equal(a.data(), b.data(), a._size);
+	}
+
+	friend bool operator!=(const Buffer& a, const Buffer& b) { return !(a == b); }
+};
@@ -1,87 +1,23 @@
 #pragma once
-#include "stdc++.h"
-
-template <typename T>
-class Buffer
-{
-	std::string          _name;
-	size_t               _size;
-	std::unique_ptr<T[]> _buffer;
-
-public:
-//  default constructor
-	Buffer() :
-		_size(16),
-		_buffer(new T[16])
-	{}
-
-//  constructor
-	Buffer(const std::string& name, size_t size) :
-		_name(name),
-		_size(size),
-		_buffer(new T[size])
-	{}
-
-//  copy constructor
-	Buffer(const Buffer& copy) :
-		_name(copy._name),
-		_size(copy._size),
-		_buffer(new T[copy._size])
-	{
-		T* source = copy._buffer.get();
-		T* dest = _buffer.get();
-		std::copy(source, source + copy._size, dest);
-	}
-
-//  copy assignment operator
-	Buffer& operator=(const Buffer& copy)
-	{
-		if (this != &copy)
-		{
-			_name = copy._name;
-
-			if (_size != copy._size)
-			{
-				_buffer = nullptr;
-				_size = copy._size;
-				_buffer = _size > 0 > new T[_size] : nullptr;
-			}
-
-			T* source = copy._buffer.get();
-			T* dest = _buffer.get();
-			std::copy(source, source + copy._size, dest);
-		}
-
-		return *this;
-	}
-
-//  move constructor
-	Buffer(Buffer&& temp) :
-		_name(std::move(temp._name)),
-		_size(temp._size),
-		_buffer(std::move(temp._buffer))
-	{
-		temp._buffer = nullptr;
-		temp._size = 0;
-	}
-
-//  move assignment operator
-	Buffer& operator=(Buffer&& temp)
-	{
-		//static_assert(this != &temp); // assert if this is not a temporary
-
-		_buffer = nullptr;
-		_size = temp._size;
-		_buffer = std::move(temp._buffer);
-
-		_name = std::move(temp._name);
-
-		temp._buffer = nullptr;
-		temp._size = 0;
-
-		return *this;
-	}
-};
+#define CPP11_SLIM_NO_CONCURRENCY
+#include "StdIncludes.h"
+#include "Buffer.h"
+#include "Complex.h"
+#include "EnumMap.h"
+#include "Expr.h"
+#include "FlatMap.h"
+#include "InPlace.h"
+#include "Intern.h"
+#include "Kernels.h"
+#include "Lut.h"
+#include "Parse.h"
+#include "Random.h"
+#include "Rcu.h"
+#include "Regex.h"
+#include "SmallFunction.h"
+#include "SmallString.h"
+#include "TypeTraits.h"
+#include "Units.h"
 
 template <typename T>
 Buffer<T> getBuffer(const std::string& name)
@@ -146,16 +82,18 @@ int square2(int x) {
 	return x * x;
 }
 
-long long operator "" _celsius(unsigned long long tempCelsius) {
-	return std::llround(tempCelsius * 1.8 + 32);
+//  The conversion factor and offset are folded at compile time (see Units.h).
+constexpr long long operator "" _celsius(unsigned long long tempCelsius) {
+	return Units::roundCount<long long, Units::Fahrenheit>(Units::Celsius(static_cast<double>(tempCelsius)));
 }
 
 long operator "" _Square(unsigned long long num) {
 	return (num * num);
 }
 
-int operator "" _int(const char* str, std::size_t) {
-	return std::stoi(str);
+//  Evaluated at compile time where consteval is available (see Parse.h).
+PARSE_CONSTEVAL int operator "" _int(const char* str, std::size_t len) {
+	return Parse::literalInt(str, len);
 }
 
 namespace Program {
@@ -166,6 +104,13 @@ namespace Program {
 	inline namespace Version2 {
 		int getVersion() { return 2; }
 	}
+
+//  The version a running program serves, swapped by Rcu::Cell.
+	struct Release
+	{
+		int (*getVersion)() = &Version1::getVersion;
+		std::string notes;
+	};
 }
 
 struct AM
@@ -180,12 +125,26 @@ struct AM
 	}
 };
 
+//  AM only holds a std::string. libc++ strings can be moved by copying their bytes, so there
+//  Buffer<AM> grows with realloc. The libstdc++ string points into itself, and MSVC debug
+//  builds track strings by address.
+#if defined(_LIBCPP_VERSION)
+template <>
+struct Traits::is_trivially_relocatable<AM> : std::true_type {};
+#endif
+
 AM fmove(AM am)
 {
 	return am;
 };
 
+//  The CMake build compiles the demo into the features library, where the
+//  entry point is runFeatureDemo(); C++11Main.cpp calls it.
+#if defined(CPP11_FEATURES_LIBRARY)
+int runFeatureDemo()
+#else
 int main()
+#endif
 {
 //============================================================
 //  C++11 Language Features
@@ -376,6 +335,13 @@ int main()
 	std::function<int(int)> lfib = [&lfib](int n) {return n < 2 ? 1 : lfib(n - 1) + lfib(n - 2); };
 	cout << " Fib - " << lfib(5) << endl;
 
+	//  std::function may heap-allocate its target. small_function (SmallFunction.h) keeps
+	//  captures up to N bytes inline and never allocates; function_ref is a non-owning view
+	//  for parameters.
+	small_function<int(int)> sfib = [&sfib](int n) {return n < 2 ? 1 : sfib(n - 1) + sfib(n - 2); };
+	function_ref<int(int)> fibRef = sfib;
+	cout << " Fib - " << fibRef(5) << endl;
+
 	auto Add = [](int n, int m) {return (n + m); };
 	cout << " Addition - " << Add(5, 7) << endl;
 
@@ -426,9 +392,32 @@ int main()
 	//  template aliases with using are easier to read and are compatible with templates.
 
 	Vec<int> vec; // std::vector<int>
+
+	//	Element-wise math on Vec<T> without a temporary per operator: Expr.h records the
+	//	whole expression and runs it as one vectorized loop when it is assigned.
+	{
+		using namespace Expr::Operators;
+		Vec<double> x{ 1, 2, 3 }, y{ 4, 5, 6 };
+		Vec<double> z = x + y * 2.0 - 1.0;  // { 8, 11, 14 }
+		Expr::assign(z, z * 0.5 + x);        // in place: { 5, 7.5, 10 }
+		cout << " Fused sum - " << Expr::sum(z) << endl;
+	}
+
+	//	A Buffer<double> of normal variates (Random.h), generated 64 at a time by vectorized
+	//	loops and split across the thread pool with the same values for any thread count.
+	Buffer<double> noise("noise", 1000);
+	Random::fill(noise, Random::Normal{ 0, 1 }, Random::Philox(42));
+	cout << " Random normal - " << noise[0] << endl;
 	using String = std::string;
 	String s{ "foo" };
 
+	//	For many short, repetitive strings: small_string keeps up to 31 characters inline in
+	//	the same 32 bytes (SmallString.h), and a Symbol is a 4-byte id for a string stored
+	//	once in SymbolTable (Intern.h), compared and hashed as an integer.
+	small_string code{ "NYI" };
+	Symbol team(code);
+	cout << " Interned - " << team.view() << " " << (team == Symbol("NYI")) << endl;
+
 
 //============================================================
 //	11. nullptr
@@ -452,6 +441,15 @@ int main()
 	enum class Alert : bool { Red, Green };
 	Color col = Color::Red;
 
+	//  Data keyed on an enum: enum_map and enum_set (EnumMap.h) index a std::array / bitset
+	//  instead of walking a std::map. Color is sparse, so its values are listed and mapped
+	//  through a compile-time perfect hash; Alert's two values are found by reflection.
+	using ColorValues = Enums::values<Color::Red, Color::Green, Color::Blue>;
+	enum_map<Color, int, ColorValues> colorCount{ { Color::Green, 2 } };
+	++colorCount[col];
+	enum_set<Alert> raised{ Alert::Red };
+	std::cout << " Red count - " << colorCount[Color::Red] << ", alerts - " << raised.size() << std::endl;
+
 
 //============================================================
 //   13. constexpr
@@ -468,18 +466,28 @@ int main()
 	const int xc = 123;
 	//constexpr const int& yc = xc; // error -- constexpr variable `y` must be initialized by a constant expression
 
-	//	Constant expressions with classes :
-	struct Complex {
-		constexpr Complex(double r, double i) : re(r), im(i) { }
-		constexpr double real() { return re; }
-		constexpr double imag() { return im; }
-
-	private:
-		double re;
-		double im;
-	};
+	//	Constant expressions with classes (Complex.h) :
+	//struct Complex {
+	//	constexpr Complex(double r, double i) : re(r), im(i) { }
+	//	constexpr double real() const { return re; }
+	//	constexpr double imag() const { return im; }
+	//
+	//private:
+	//	double re;
+	//	double im;
+	//};
 
 	constexpr Complex I(0, 1);
+	static_assert(I * I == Complex(-1, 0)); // the full type has constexpr arithmetic
+
+	//	Precomputing whole tables at compile time (Lut.h): hot paths become a single load.
+	static_assert(Lut::squares[12] == square(12));
+	static_assert(Lut::popcount8[0xff] == 8);
+
+	//	Or a whole regular expression (Regex.h): the pattern is parsed and compiled into a DFA
+	//	by the compiler, and a search is one table lookup per byte.
+	static constexpr char timeout[] = "(ERROR|WARN) .*time[sd]? ?out";
+	cout << " Compiled regex - " << Regex::Compiled<timeout>::search("ERROR db timed out") << endl;
 
 
 //============================================================
@@ -514,6 +522,13 @@ int main()
 	//}
 
 	24_celsius; // == 75
+	static_assert(24_celsius == 75, "folded at compile time");
+
+	//  Units.h generalizes this to typed quantities. Mixing dimensions does not compile:
+	using namespace Units::literals;
+	constexpr Units::Fahrenheit boiling(100.0_degC); // 212 F
+	constexpr Units::Meters run = Units::Meters(5_km) + 400_m; // 5400 m
+	//Units::Meters heavy(3_kg); // error -- Mass is not Length
 	long sq = 5_Square; // 25
 	sq = 6_Square; // 36
 	//String to integer conversion :
@@ -524,6 +539,10 @@ int main()
 
 	"123"_int; // == 123, with type `int`
 
+	//  std::stoi is locale-dependent and throws at run time. Parse::literalInt checks the
+	//  literal while compiling instead, so a malformed "12x"_int is a compile error:
+	static_assert("123"_int == 123, "converted at compile time");
+
 
 //============================================================
 //   16. Explicit virtual overrides
@@ -730,6 +749,22 @@ int main()
 	int oldVersion{ Program::Version1::getVersion() }; // Uses getVersion() from Version1
 	//  bool firstVersion{ Program::isFirstVersion() };    // Does not compile when Version2 is added
 
+	//  The inline namespace is chosen when compiling. Rcu.h switches versions while the
+	//  program runs: readers never wait and see either the old or the new Release, and
+	//  the old one is deleted once no reader can still be using it.
+	Rcu::Cell<Program::Release> release;
+	release.publish(Program::Release{ &Program::getVersion, "Version2 hot-swapped" });
+	int liveVersion{ release.read([](const Program::Release& r) { return r.getVersion(); }) };
+	cout << " Live version - " << liveVersion << endl;
+
+	//  Kernels.h versions hot loops by instruction set the same way: Kernels::Isa::v_sse2,
+	//  v_avx2 and v_avx512 each hold a copy, the inline one matches the build flags, and
+	//  Kernels::sum picks the best copy for the running CPU.
+	double samples[4]{ 1.5, 2.5, 3.5, 4.5 };
+	double dispatched{ Kernels::sum(samples, 4) };               // best level for this CPU
+	double baseline{ Kernels::Isa::v_sse2::sum(samples, 4) };    // always SSE2
+	double buildLevel{ Kernels::Isa::sum(samples, 4) };          // level of the -m flags, no dispatch
+
 
 //============================================================
 //   25. Non - static data member initializers
@@ -747,10 +782,18 @@ int main()
 	//  Default initialization on C++11
 	class Human2 
 	{
+	public:
+		using bitwise_comparable = std::true_type; // opt-in for TypeTraits.h: equal means equal bytes
+		using bitwise_zeroable = std::true_type; // opt-in for TypeTraits.h: Human2() is all zero bits
 	private:
 		unsigned age{ 0 };
 	};
 
+	//  Human2 is trivially copyable, so Buffer<Human2> grows with realloc; with the opt-ins
+	//  above it also compares with memcmp and allocates with calloc.
+	static_assert(Traits::is_trivially_relocatable_v<Human2> && Traits::is_bitwise_comparable_v<Human2>, "Human2");
+	static_assert(Traits::is_bitwise_zeroable_v<Human2> && !Traits::is_bitwise_zeroable_v<Human1>, "only Human2 opted in");
+
 
 //============================================================
 //   26. Right angle Brackets
@@ -761,6 +804,15 @@ int main()
 	typedef std::map<int, std::map <int, std::map <int, int> > > cpp98LongTypedef;
 	typedef std::map<int, std::map <int, std::map <int, int>>>   cpp11LongTypedef;
 
+	//  The same three-level lookup flattened (FlatMap.h): one sorted vector of (k1, k2, k3)
+	//  keys, so everything under (k1, k2) is one contiguous run.
+	typedef flat_map<std::tuple<int, int, int>, int> flatLongTypedef;
+	flatLongTypedef dims({ { { 1, 2, 3 }, 10 }, { { 1, 2, 4 }, 20 }, { { 2, 0, 0 }, 30 } });
+	int underOneTwo = 0;
+	for (auto entry : dims.prefix(1, 2))
+		underOneTwo += entry.second;
+	std::cout << " Under (1, 2) - " << underOneTwo << std::endl;
+
 //============================================================ End ==============================================
 	return 0;
 }
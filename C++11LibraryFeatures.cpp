@@ -65,6 +65,16 @@
 	AF a;
 	wrapper(a); // copied
 	wrapper(std::move(a)); // moved
+
+	//	The moves above come from building an AF and then returning it. Since C++17 a factory
+	//	that returns the prvalue itself constructs the caller's object directly, and
+	//	make_in_place / construct_with (InPlace.h) extend that to optional, variant and Buffer slots:
+
+	AF b = make_in_place<AF>(); // nothing printed
+	std::optional<AF> slot;
+	slot.emplace(construct_with([] { return make_in_place<AF>(); })); // nothing printed (GCC)
+	Buffer<AF> afs("afs", 4);
+	afs.emplace(2); // nothing printed: constructed in afs[2]
 */
 
 
@@ -91,6 +101,17 @@
 			thread.join(); // Wait for threads to finish
 		}
 	};
+
+	//	Threads that print with cout << ... << endl serialize on the stream and flush on every
+	//	line. Log::print (Log.h) only copies its arguments into a per-thread ring; a background
+	//	writer formats and writes them in batches:
+
+	Log::installCrashHandler();                       // still drains the rings on SIGSEGV / abort
+	threadsVector.emplace_back([]() {
+		for (int i = 0; i < 1000; ++i)
+			Log::print("worker step {} of {}", i, 1000);
+	});
+	Log::flush();                                     // everything printed so far is written
 */
 
 
@@ -105,6 +126,13 @@
 		std::to_string(1.2); // == "1.2"
 		std::to_string(123); // == "123"
 	}
+
+	//	std::to_string allocates a std::string on every call. Format::toChars (ToChars.h)
+	//	writes into a caller-provided buffer instead and never allocates:
+
+	char text[Format::maxChars];
+	char* end = Format::toChars(text, 123); // [text, end) == "123"
+	end = Format::toChars(text, 1.2);       // [text, end) == "1.2", shortest round-trip
 */
 
 
@@ -119,6 +147,14 @@
 	static_assert(std::is_integral<int>::value);
 	static_assert(std::is_same<int, int>::value);
 	static_assert(std::is_same<std::conditional<true, int, double>::type, int>::value);
+
+	//	Traits can also select faster algorithms. TypeTraits.h adds is_trivially_relocatable,
+	//	is_bitwise_comparable and is_bitwise_zeroable, which Buffer<T> consults to grow with
+	//	realloc, compare with memcmp and allocate with calloc:
+
+	static_assert(Traits::is_bitwise_comparable_v<int> && !Traits::is_bitwise_comparable_v<double>);
+	struct Handle { std::unique_ptr<int> p; using trivially_relocatable = std::true_type; }; // opt-in
+	static_assert(Traits::is_trivially_relocatable_v<Handle>);
 */
 
 //==============================================================
@@ -241,6 +277,14 @@
 	std::sort(a.begin(), a.end()); // a == { 1, 2, 3 }
 	for (int& x : a) x *= 2; // a == { 2, 4, 6 }
 
+	//	For large arrays the same operations run on every core with Parallel.h, which
+	//	accepts any random-access range: std::array, std::vector or Buffer<T>.
+
+	Buffer<double> samples("samples", 1 << 20);
+	Parallel::transform(samples.begin(), samples.end(), samples.begin(), [](double x) { return x * 2; });
+	Parallel::sort(samples.begin(), samples.end());         // merge sort on ThreadPool::instance()
+	Parallel::radixSort(samples.begin(), samples.end());    // LSD radix sort for arithmetic keys
+
 */
 
 
@@ -261,6 +305,16 @@
 	unordered_map
 	unordered_multimap
 
+	//	When order is needed after all, btree_map (BTree.h) keeps std::map's interface but
+	//	stores dozens of sorted keys per node, so lookups touch a few cache lines and range
+	//	scans walk linked arrays instead of tree nodes.
+
+	btree_map<uint64_t, double> prices;
+	prices[42] = 9.5;
+	double total = 0;
+	for (auto it = prices.lower_bound(40); it != prices.end() && it->first < 50; ++it)
+		total += it->second;
+
 */
 
 
@@ -322,4 +376,26 @@
 
 	auto handle = std::async(std::launch::async, foo);  // create an async task
 	auto result = handle.get();  // wait for the result
+
+	//	A std::atomic<uint64_t> counter incremented by many threads moves its cache line from
+	//	core to core on every fetch_add. Metrics.h splits each counter, gauge and latency
+	//	histogram into per-thread cache-line slots and adds them up only when read:
+
+	Metrics::Counter& served = Metrics::counter("requests_total", "Requests served");
+	Metrics::Histogram& latency = Metrics::histogram("request_ns", "Request latency");
+	{
+		Metrics::ScopedTimer timer(latency);
+		served.add();
+	}
+	Metrics::Registry::instance().writeFile("metrics.prom");  // Prometheus text format
+	//	std::launch::deferred computes a value lazily but only once, and cannot tell when
+	//	it would come out differently. Incremental.h keeps a graph of such values and which
+	//	inputs each one read, so a change recomputes only what depends on it:
+
+	Incremental::Graph graph;
+	auto price = graph.input("price", 10.0);
+	auto taxed = graph.node("taxed", [](double p) { return p * 1.2; }, price);
+	taxed.get();      // computes taxed
+	price.set(11.0);  // marks taxed stale
+	taxed.get();      // recomputes taxed only now
 */
@@ -0,0 +1,8 @@
+//  Entry point of the CMake build's cpp11features program; the demo itself
+//  is in the features library (C++11Features.cpp).
+int runFeatureDemo();
+
+int main()
+{
+	return runFeatureDemo();
+}
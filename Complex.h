@@ -0,0 +1,54 @@
+#pragma once
+#include <type_traits>
+
+//==============================================================
+//	Constant expressions with classes
+//==============================================================
+//	The constexpr Complex example from C++11Features.cpp, grown into a full
+//	value type so lookup tables and the FFT can do arithmetic at compile time.
+//	Layout is two adjacent doubles (real, imag), as in std::complex<double>.
+
+struct Complex {
+	constexpr Complex() : re(0), im(0) { }
+	constexpr Complex(double r, double i) : re(r), im(i) { }
+
+	using bitwise_zeroable = std::true_type; // Complex() is all zero bits: Buffer<Complex> uses calloc
+	constexpr double real() const { return re; }
+	constexpr double imag() const { return im; }
+
+	constexpr Complex conj() const { return Complex(re, -im); }
+	constexpr double norm() const { return re * re + im * im; } // |z|^2, like std::norm
+
+	constexpr Complex& operator+=(const Complex& o) { re += o.re; im += o.im; return *this; }
+	constexpr Complex& operator-=(const Complex& o) { re -= o.re; im -= o.im; return *this; }
+	constexpr Complex& operator*=(const Complex& o) { return *this = *this * o; }
+	constexpr Complex& operator*=(double s) { re *= s; im *= s; return *this; }
+
+	friend constexpr Complex operator+(const Complex& a, const Complex& b) { return Complex(a.re + b.re, a.im + b.im); }
+	friend constexpr Complex operator-(const Complex& a, const Complex& b) { return Complex(a.re - b.re, a.im - b.im); }
+	friend constexpr Complex operator-(const Complex& a) { return Complex(-a.re, -a.im); }
+	friend constexpr Complex operator*(const Complex& a, const Complex& b)
+	{
+		return Complex(a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re);
+	}
+	friend constexpr Complex operator*(const Complex& a, double s) { return Complex(a.re * s, a.im * s); }
+	friend constexpr Complex operator*(double s, const Complex& a) { return Complex(s * a.re, s * a.im); }
+	friend constexpr Complex operator/(const Complex& a, double s) { return Complex(a.re / s, a.im / s); }
+	friend constexpr Complex operator/(const Complex& a, const Complex& b)
+	{
+		return Complex(a.re * b.re + a.im * b.im, a.im * b.re - a.re * b.im) / b.norm();
+	}
+
+	friend constexpr bool operator==(const Complex& a, const Complex& b) { return a.re == b.re && a.im == b.im; }
+	friend constexpr bool operator!=(const Complex& a, const Complex& b) { return !(a == b); }
+
+private:
+	double re;
+	double im;
+};
+
+static_assert(Complex(0, 1) * Complex(0, 1) == Complex(-1, 0), "i * i == -1");
+static_assert(Complex(1, 2) + Complex(3, 4) - Complex(4, 6) == Complex(), "addition");
+static_assert(Complex(3, 4).norm() == 25 && Complex(3, 4).conj() == Complex(3, -4), "norm, conj");
+static_assert(Complex(-5, 10) / Complex(1, 2) == Complex(3, 4), "division");
+static_assert(sizeof(Complex) == 2 * sizeof(double), "interleaved layout");
@@ -0,0 +1,467 @@
+#pragma once
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+//==============================================================
+//	Enum-indexed containers
+//==============================================================
+//	The strongly-typed enums example (Color, Alert) keyed with std::map walks
+//	a tree, and std::unordered_map hashes and chases a node, for what is a
+//	fixed, tiny key set known at compile time. enum_map<E, V> stores one V per
+//	enumerator in a std::array and enum_set<E> one bit per enumerator; a key
+//	becomes an array index at compile-time cost only:
+//
+//	  dense enums (values form one run)  index = value - first
+//	  sparse enums (Color's 0xff0000)    a multiplicative perfect hash found
+//	                                     at compile time, one multiply, shift
+//	                                     and table load
+//
+//	The enumerators come from a traits type:
+//
+//	  Enums::values<Color::Red, Color::Green, Color::Blue>   listed
+//	  Enums::range<Level::First, Level::Last>                every value between
+//	  Enums::reflected<E>                                    found by probing
+//
+//	enum_traits<E> defaults to Enums::reflected<E>, which checks each value in
+//	[ENUM_REFLECT_MIN, ENUM_REFLECT_MAX] (clamped to the underlying type) for a
+//	name in __PRETTY_FUNCTION__. Specialize enum_traits for enums outside that
+//	range, or pass the traits as the last template argument, which also works
+//	for enums local to a function. Enums without a fixed underlying type must
+//	list their values: probing casts values that may be out of their range.
+
+#if !defined(ENUM_REFLECT_MIN)
+#define ENUM_REFLECT_MIN -128
+#endif
+#if !defined(ENUM_REFLECT_MAX)
+#define ENUM_REFLECT_MAX 127
+#endif
+
+namespace Enums {
+
+	template <typename E>
+	constexpr uint64_t bitsOf(E e) { return static_cast<uint64_t>(static_cast<std::underlying_type_t<E>>(e)); }
+
+	template <typename E>
+	constexpr bool less(E a, E b) { return static_cast<std::underlying_type_t<E>>(a) < static_cast<std::underlying_type_t<E>>(b); }
+
+//  Listed enumerators, in any order.
+	template <auto First, auto... Rest>
+	struct values
+	{
+		using enum_type = decltype(First);
+		static constexpr std::array<enum_type, 1 + sizeof...(Rest)> list = { First, Rest... };
+	};
+
+//  Every value from First to Last inclusive.
+	template <auto First, auto Last>
+	struct range
+	{
+		using enum_type = decltype(First);
+
+	private:
+		static constexpr size_t count = static_cast<size_t>(bitsOf(Last) - bitsOf(First)) + 1;
+
+		static constexpr std::array<enum_type, count> make()
+		{
+			std::array<enum_type, count> list{};
+			for (size_t i = 0; i < count; ++i)
+				list[i] = static_cast<enum_type>(static_cast<std::underlying_type_t<enum_type>>(bitsOf(First) + i));
+			return list;
+		}
+
+	public:
+		static constexpr std::array<enum_type, count> list = make();
+	};
+
+	namespace detail {
+	//  True when the compiler prints V by name rather than as a cast number.
+		template <typename E, E V>
+		constexpr bool isEnumerator()
+		{
+#if defined(_MSC_VER) && !defined(__clang__)
+			constexpr std::string_view signature = __FUNCSIG__;
+			constexpr size_t start = signature.rfind(',', signature.rfind('>')) + 1;
+#else
+			constexpr std::string_view signature = __PRETTY_FUNCTION__;
+			constexpr size_t start = signature.find_first_not_of(' ', signature.rfind('=') + 1);
+#endif
+			constexpr char c = signature[start];
+			return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+		}
+
+		template <typename E, long long First, size_t... I>
+		constexpr auto probe(std::index_sequence<I...>)
+		{
+			using U = std::underlying_type_t<E>;
+			constexpr bool named[] = { isEnumerator<E, static_cast<E>(static_cast<U>(First + static_cast<long long>(I)))>()... };
+
+			constexpr size_t count = [&] {
+				size_t n = 0;
+				for (bool b : named)
+					n += b;
+				return n;
+			}();
+
+			std::array<E, count> list{};
+			size_t k = 0;
+			for (size_t i = 0; i < sizeof...(I); ++i)
+				if (named[i])
+					list[k++] = static_cast<E>(static_cast<U>(First + static_cast<long long>(i)));
+			return list;
+		}
+
+		template <typename U>
+		constexpr long long reflectMin()
+		{
+			return static_cast<long long>(std::numeric_limits<U>::min()) > ENUM_REFLECT_MIN ? static_cast<long long>(std::numeric_limits<U>::min()) : ENUM_REFLECT_MIN;
+		}
+
+		template <typename U>
+		constexpr long long reflectMax()
+		{
+			return static_cast<unsigned long long>(std::numeric_limits<U>::max()) < ENUM_REFLECT_MAX ? static_cast<long long>(std::numeric_limits<U>::max()) : ENUM_REFLECT_MAX;
+		}
+	}
+
+//  The named values in [ENUM_REFLECT_MIN, ENUM_REFLECT_MAX].
+	template <typename E>
+	struct reflected
+	{
+		using enum_type = E;
+
+	private:
+		using U = std::underlying_type_t<E>;
+		static constexpr long long first = detail::reflectMin<U>();
+		static constexpr long long last = detail::reflectMax<U>();
+
+	public:
+		static constexpr auto list = detail::probe<E, first>(std::make_index_sequence<static_cast<size_t>(last - first + 1)>());
+	};
+
+	namespace detail {
+		constexpr unsigned ceilLog2(size_t n)
+		{
+			unsigned bits = 0;
+			while ((size_t(1) << bits) < n)
+				++bits;
+			return bits;
+		}
+
+		struct PerfectHash
+		{
+			uint64_t multiplier = 0;
+			unsigned bits = 0;
+
+			constexpr size_t slot(uint64_t key) const { return bits == 0 ? 0 : static_cast<size_t>((key * multiplier) >> (64 - bits)); }
+		};
+
+		template <typename E, size_t N>
+		constexpr std::array<E, N> sorted(std::array<E, N> list)
+		{
+			for (size_t i = 1; i < N; ++i)
+				for (size_t j = i; j > 0 && less(list[j], list[j - 1]); --j) {
+					const E t = list[j];
+					list[j] = list[j - 1];
+					list[j - 1] = t;
+				}
+			return list;
+		}
+
+		template <typename E, size_t N>
+		constexpr bool distinct(const std::array<E, N>& sortedList)
+		{
+			for (size_t i = 1; i < N; ++i)
+				if (sortedList[i] == sortedList[i - 1])
+					return false;
+			return true;
+		}
+
+		template <typename E, size_t N>
+		constexpr bool contiguous(const std::array<E, N>& sortedList)
+		{
+			return N == 0 || bitsOf(sortedList[N - 1]) - bitsOf(sortedList[0]) == N - 1;
+		}
+
+		template <typename E, size_t N>
+		constexpr bool collisionFree(const std::array<E, N>& list, PerfectHash hash)
+		{
+			for (size_t i = 0; i < N; ++i)
+				for (size_t j = i + 1; j < N; ++j)
+					if (hash.slot(bitsOf(list[i])) == hash.slot(bitsOf(list[j])))
+						return false;
+			return true;
+		}
+
+	//  Smallest table first, at most 128 slots per key; for each size try
+	//  odd multipliers derived from the golden ratio.
+		template <typename E, size_t N>
+		constexpr PerfectHash findPerfectHash(const std::array<E, N>& list)
+		{
+			const unsigned minBits = ceilLog2(N < 2 ? 2 : N);
+			for (unsigned bits = minBits; bits <= minBits + 7; ++bits)
+				for (uint64_t k = 0; k < 256; ++k) {
+					const PerfectHash hash{ 0x9E3779B97F4A7C15ull * (2 * k + 1), bits };
+					if (collisionFree(list, hash))
+						return hash;
+				}
+			return PerfectHash{};
+		}
+	}
+
+//  Enumerator <-> dense index mapping for a traits type, all computed at
+//  compile time. index() returns count for values that are not enumerators.
+	template <typename Traits>
+	struct Index
+	{
+		using enum_type = typename Traits::enum_type;
+
+		static constexpr auto values = detail::sorted(Traits::list);
+		static constexpr size_t count = values.size();
+		static constexpr bool dense = detail::contiguous(values);
+
+		static_assert(std::is_enum<enum_type>::value, "enum_map and enum_set need an enum type");
+		static_assert(detail::distinct(values), "each enumerator value must be listed once");
+		static_assert(count < 65535, "at most 65534 enumerators");
+
+	private:
+		using Slot = std::conditional_t<(count < 255), uint8_t, uint16_t>;
+
+		static constexpr detail::PerfectHash hash = dense ? detail::PerfectHash{} : detail::findPerfectHash(values);
+		static_assert(dense || hash.bits != 0, "no perfect hash found: list fewer, or denser, enumerators");
+
+		static constexpr std::array<Slot, (size_t(1) << hash.bits)> makeSlots()
+		{
+			std::array<Slot, (size_t(1) << hash.bits)> slots{};
+			for (Slot& s : slots)
+				s = static_cast<Slot>(count);
+			if (!dense)
+				for (size_t i = 0; i < count; ++i)
+					slots[hash.slot(bitsOf(values[i]))] = static_cast<Slot>(i);
+			return slots;
+		}
+
+		static constexpr auto slots = makeSlots();
+
+	public:
+	//  Index of an enumerator; e must be one.
+		static constexpr size_t of(enum_type e)
+		{
+			if constexpr (dense)
+				return static_cast<size_t>(bitsOf(e) - bitsOf(values[0]));
+			else
+				return slots[hash.slot(bitsOf(e))];
+		}
+
+	//  Index of e, or count when e is not an enumerator.
+		static constexpr size_t find(enum_type e)
+		{
+			if constexpr (count == 0)
+				return 0;
+			else if constexpr (dense) {
+				const uint64_t i = bitsOf(e) - bitsOf(values[0]);
+				return i < count ? static_cast<size_t>(i) : count;
+			}
+			else {
+				const size_t i = of(e);
+				return i < count && values[i] == e ? i : count;
+			}
+		}
+
+		static constexpr enum_type value(size_t i) { return values[i]; }
+	};
+}
+
+template <typename E>
+struct enum_traits : Enums::reflected<E> {};
+
+//  One V per enumerator of E, in enumerator value order. Every key is always
+//  present; operator[] expects an enumerator, at() checks.
+template <typename E, typename V, typename Traits = enum_traits<E>>
+class enum_map
+{
+public:
+	using index_type = Enums::Index<Traits>;
+	using key_type = E;
+	using mapped_type = V;
+	using size_type = size_t;
+
+private:
+	std::array<V, index_type::count> _values{};
+
+	template <bool Const>
+	class Iterator
+	{
+		using Values = std::conditional_t<Const, const std::array<V, index_type::count>, std::array<V, index_type::count>>;
+		using Ref = std::conditional_t<Const, const V&, V&>;
+
+		Values* _values;
+		size_t _i;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::pair<E, Ref>;
+		using difference_type = std::ptrdiff_t;
+		using reference = value_type;
+		using pointer = void;
+
+		constexpr Iterator(Values* values, size_t i) : _values(values), _i(i) {}
+
+		constexpr value_type operator*() const { return { index_type::value(_i), (*_values)[_i] }; }
+		constexpr Iterator& operator++() { ++_i; return *this; }
+		constexpr Iterator operator++(int) { Iterator t = *this; ++_i; return t; }
+		constexpr bool operator==(const Iterator& o) const { return _i == o._i; }
+		constexpr bool operator!=(const Iterator& o) const { return _i != o._i; }
+	};
+
+public:
+	using iterator = Iterator<false>;
+	using const_iterator = Iterator<true>;
+
+	constexpr enum_map() = default;
+
+	constexpr enum_map(std::initializer_list<std::pair<E, V>> init)
+	{
+		for (const auto& kv : init)
+			at(kv.first) = kv.second;
+	}
+
+	static constexpr size_type size() { return index_type::count; }
+	static constexpr bool contains(E key) { return index_type::find(key) != index_type::count; }
+
+	constexpr V&       operator[](E key)       { return _values[index_type::of(key)]; }
+	constexpr const V& operator[](E key) const { return _values[index_type::of(key)]; }
+
+	constexpr V& at(E key)
+	{
+		const size_t i = index_type::find(key);
+		if (i == index_type::count)
+			throw std::out_of_range("enum_map: not an enumerator");
+		return _values[i];
+	}
+
+	constexpr const V& at(E key) const { return const_cast<enum_map&>(*this).at(key); }
+
+	constexpr void fill(const V& value) { _values.fill(value); }
+
+//  the values in enumerator order, for bulk operations
+	constexpr std::array<V, index_type::count>&       values()       { return _values; }
+	constexpr const std::array<V, index_type::count>& values() const { return _values; }
+
+	constexpr iterator       begin()       { return { &_values, 0 }; }
+	constexpr iterator       end()         { return { &_values, index_type::count }; }
+	constexpr const_iterator begin() const { return { &_values, 0 }; }
+	constexpr const_iterator end()   const { return { &_values, index_type::count }; }
+
+	friend constexpr bool operator==(const enum_map& a, const enum_map& b) { return a._values == b._values; }
+	friend constexpr bool operator!=(const enum_map& a, const enum_map& b) { return !(a == b); }
+};
+
+//  A set of enumerators of E, one bit each.
+template <typename E, typename Traits = enum_traits<E>>
+class enum_set
+{
+public:
+	using index_type = Enums::Index<Traits>;
+	using key_type = E;
+	using size_type = size_t;
+
+private:
+	std::bitset<index_type::count> _bits;
+
+	explicit enum_set(const std::bitset<index_type::count>& bits) : _bits(bits) {}
+
+public:
+	class iterator
+	{
+		const std::bitset<index_type::count>* _bits;
+		size_t _i;
+
+		void skip()
+		{
+			while (_i < index_type::count && !_bits->test(_i))
+				++_i;
+		}
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = E;
+		using difference_type = std::ptrdiff_t;
+		using reference = E;
+		using pointer = void;
+
+		iterator(const std::bitset<index_type::count>* bits, size_t i) : _bits(bits), _i(i) { skip(); }
+
+		E operator*() const { return index_type::value(_i); }
+		iterator& operator++() { ++_i; skip(); return *this; }
+		iterator operator++(int) { iterator t = *this; ++*this; return t; }
+		bool operator==(const iterator& o) const { return _i == o._i; }
+		bool operator!=(const iterator& o) const { return _i != o._i; }
+	};
+	using const_iterator = iterator;
+
+	enum_set() = default;
+
+	enum_set(std::initializer_list<E> init)
+	{
+		for (E e : init)
+			insert(e);
+	}
+
+	static enum_set all() { return enum_set(std::bitset<index_type::count>().set()); }
+
+	static constexpr size_type max_size() { return index_type::count; }
+	size_type size() const { return _bits.count(); }
+	bool empty() const { return _bits.none(); }
+
+//  e must be an enumerator; contains() also accepts any other value
+	void insert(E e) { _bits.set(index_type::of(e)); }
+	void erase(E e) { _bits.reset(index_type::of(e)); }
+	void clear() { _bits.reset(); }
+
+	bool contains(E e) const
+	{
+		const size_t i = index_type::find(e);
+		return i != index_type::count && _bits.test(i);
+	}
+
+	iterator begin() const { return { &_bits, 0 }; }
+	iterator end()   const { return { &_bits, index_type::count }; }
+
+	enum_set& operator|=(const enum_set& o) { _bits |= o._bits; return *this; }
+	enum_set& operator&=(const enum_set& o) { _bits &= o._bits; return *this; }
+	enum_set& operator^=(const enum_set& o) { _bits ^= o._bits; return *this; }
+
+	friend enum_set operator|(enum_set a, const enum_set& b) { return a |= b; }
+	friend enum_set operator&(enum_set a, const enum_set& b) { return a &= b; }
+	friend enum_set operator^(enum_set a, const enum_set& b) { return a ^= b; }
+	friend enum_set operator~(const enum_set& a) { return enum_set(~a._bits); }
+
+	friend bool operator==(const enum_set& a, const enum_set& b) { return a._bits == b._bits; }
+	friend bool operator!=(const enum_set& a, const enum_set& b) { return !(a == b); }
+};
+
+namespace Enums {
+	namespace detail {
+		enum class SparseCheck : unsigned int { Red = 0xff0000, Green = 0xff00, Blue = 0xff };
+		enum class DenseCheck : short { A = -2, B, C, D };
+		enum class BoolCheck : bool { No, Yes };
+
+		using SparseIndex = Index<values<SparseCheck::Red, SparseCheck::Green, SparseCheck::Blue>>;
+		static_assert(!SparseIndex::dense && SparseIndex::find(SparseCheck::Blue) == 0 && SparseIndex::find(SparseCheck::Red) == 2, "sparse enums hash to ascending indices");
+		static_assert(SparseIndex::find(static_cast<SparseCheck>(0xff01)) == 3, "non-enumerators are not found");
+
+		static_assert(Index<reflected<DenseCheck>>::dense && Index<reflected<DenseCheck>>::count == 4, "reflection finds negative enumerators");
+		static_assert(Index<reflected<DenseCheck>>::find(DenseCheck::C) == 2, "dense enums index by offset");
+		static_assert(Index<reflected<BoolCheck>>::count == 2, "bool-based enums reflect both values");
+		static_assert(Index<range<DenseCheck::B, DenseCheck::D>>::find(DenseCheck::A) == 3, "ranges exclude what they do not cover");
+	}
+}
@@ -0,0 +1,295 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "Buffer.h"
+
+//==============================================================
+//	Lazy element-wise arithmetic (expression templates)
+//==============================================================
+//	With plain operator overloads on Vec<T> (std::vector<T>), a + b * c
+//	allocates and fills a temporary for b * c, another for the sum, and
+//	walks memory once per operator. Here each operator only records its
+//	operands, and the whole expression runs as one loop when it is assigned:
+//
+//	  using namespace Expr::Operators;
+//	  Vec<double> r = a + b * c - 0.5 * d;  // one pass, no temporaries
+//	  Expr::assign(r, r * 2 + a);            // reuses r's storage
+//	  double dot = Expr::sum(a * b);
+//
+//	Operands are Vec<T>, Buffer<T>, std::array<T, N>, Expr::view(p, n) and
+//	arithmetic scalars; at least one of them must be an array. The loop
+//	carries no dependencies between elements and is marked so (ivdep), which
+//	lets the compiler vectorize it without runtime overlap checks; assign()
+//	takes care of the overlaps that would make that unsafe, evaluating into
+//	a temporary when the destination partially overlaps an operand or is
+//	resized while being read. r = r * 2 + a writes element i after reading
+//	element i only, and runs in place.
+//
+//	Expressions refer to their operands: evaluate them within the statement
+//	that builds them rather than keeping them in an auto variable.
+
+namespace Expr {
+
+//  Base of every expression node.
+	struct Node {};
+
+//  Size of an expression made only of scalars.
+	constexpr size_t unsized = SIZE_MAX;
+
+//  A contiguous array operand.
+	template <typename T>
+	struct Ref : Node
+	{
+		using value_type = T;
+
+		const T* data;
+		size_t count;
+
+		Ref(const T* data, size_t count) : data(data), count(count) {}
+
+		size_t size() const { return count; }
+		T operator[](size_t i) const { return data[i]; }
+
+	//  Whether evaluating into [first, last) would read elements this
+	//  operand has not yet been read at: it overlaps the destination other
+	//  than element for element.
+		bool overlaps(const void* first, const void* last, bool resized) const
+		{
+			const void* end = data + count;
+			const bool intersects = std::less<const void*>()(data, last) && std::less<const void*>()(first, end) && count > 0;
+			return intersects && (resized || static_cast<const void*>(data) != first);
+		}
+	};
+
+	template <typename T>
+	struct Scalar : Node
+	{
+		using value_type = T;
+
+		T value;
+
+		explicit Scalar(T value) : value(value) {}
+
+		size_t size() const { return unsized; }
+		T operator[](size_t) const { return value; }
+		bool overlaps(const void*, const void*, bool) const { return false; }
+	};
+
+	namespace detail {
+
+		inline size_t common(size_t a, size_t b)
+		{
+			if (a != unsized && b != unsized && a != b)
+				throw std::invalid_argument("Expr: operand sizes differ");
+			return a != unsized ? a : b;
+		}
+
+		template <typename T>
+		struct IsArray : std::false_type {};
+		template <typename T, typename A>
+		struct IsArray<std::vector<T, A>> : std::is_arithmetic<T> {};
+		template <typename T>
+		struct IsArray<Buffer<T>> : std::is_arithmetic<T> {};
+		template <typename T, size_t N>
+		struct IsArray<std::array<T, N>> : std::is_arithmetic<T> {};
+
+		template <typename C>
+		using Element = std::remove_cv_t<std::remove_pointer_t<decltype(std::declval<C&>().data())>>;
+
+		template <typename T>
+		constexpr bool isNode = std::is_base_of<Node, T>::value;
+		template <typename T>
+		constexpr bool isArray = IsArray<T>::value;
+		template <typename T>
+		constexpr bool isOperand = isNode<T> || isArray<T> || std::is_arithmetic<T>::value;
+
+	//  Operator templates apply when both sides are operands and at least
+	//  one side is an array or an expression.
+		template <typename L, typename R>
+		using EnableBinary = std::enable_if_t<isOperand<L> && isOperand<R> &&
+			(isNode<L> || isArray<L> || isNode<R> || isArray<R>)>;
+		template <typename E>
+		using EnableUnary = std::enable_if_t<isNode<E> || isArray<E>>;
+	}
+
+//  Wraps an operand in its node type: arrays become Ref, scalars Scalar.
+	template <typename E>
+	auto operand(const E& e)
+	{
+		if constexpr (detail::isNode<E>)
+			return e;
+		else if constexpr (std::is_arithmetic<E>::value)
+			return Scalar<E>(e);
+		else
+			return Ref<detail::Element<const E>>(e.data(), e.size());
+	}
+
+	template <typename E>
+	using Operand = decltype(operand(std::declval<const E&>()));
+
+//  A raw array or part of one, as an operand.
+	template <typename T>
+	Ref<T> view(const T* data, size_t count) { return Ref<T>(data, count); }
+
+	template <typename T>
+	Ref<T> view(const Buffer<T>& buffer, size_t first, size_t count) { return Ref<T>(buffer.data() + first, count); }
+
+	template <typename T, typename E>
+	void evaluate(T* out, E e, size_t n);
+
+	template <typename Derived>
+	struct Evaluable : Node
+	{
+	//  Materializes the expression as a Vec; converts implicitly, so
+	//  Vec<double> r = a + b; just works.
+		template <typename T, typename A>
+		operator std::vector<T, A>() const
+		{
+			const Derived& e = static_cast<const Derived&>(*this);
+			std::vector<T, A> result(e.size() == unsized ? 0 : e.size());
+			evaluate(result.data(), e, result.size());
+			return result;
+		}
+
+		auto eval() const { return static_cast<std::vector<typename Derived::value_type>>(*this); }
+	};
+
+	template <typename Op, typename L, typename R>
+	struct Binary : Evaluable<Binary<Op, L, R>>
+	{
+		using value_type = std::decay_t<decltype(Op()(std::declval<typename L::value_type>(), std::declval<typename R::value_type>()))>;
+
+		L l;
+		R r;
+		size_t count;
+
+		Binary(const L& l, const R& r) : l(l), r(r), count(detail::common(l.size(), r.size())) {}
+
+		size_t size() const { return count; }
+		value_type operator[](size_t i) const { return Op()(l[i], r[i]); }
+		bool overlaps(const void* first, const void* last, bool resized) const { return l.overlaps(first, last, resized) || r.overlaps(first, last, resized); }
+	};
+
+	template <typename Op, typename E>
+	struct Unary : Evaluable<Unary<Op, E>>
+	{
+		using value_type = std::decay_t<decltype(Op()(std::declval<typename E::value_type>()))>;
+
+		E e;
+
+		explicit Unary(const E& e) : e(e) {}
+
+		size_t size() const { return e.size(); }
+		value_type operator[](size_t i) const { return Op()(e[i]); }
+		bool overlaps(const void* first, const void* last, bool resized) const { return e.overlaps(first, last, resized); }
+	};
+
+	namespace detail {
+		struct Sqrt { template <typename T> auto operator()(T x) const { return std::sqrt(x); } };
+		struct Abs  { template <typename T> auto operator()(T x) const { return std::abs(x); } };
+		struct Exp  { template <typename T> auto operator()(T x) const { return std::exp(x); } };
+		struct Min  { template <typename T, typename U> auto operator()(T a, U b) const { return b < a ? b : a; } };
+		struct Max  { template <typename T, typename U> auto operator()(T a, U b) const { return a < b ? b : a; } };
+
+		template <typename Op, typename L, typename R>
+		auto binary(const L& l, const R& r) { return Binary<Op, Operand<L>, Operand<R>>(operand(l), operand(r)); }
+
+		template <typename Op, typename E>
+		auto unary(const E& e) { return Unary<Op, Operand<E>>(operand(e)); }
+	}
+
+//  In their own namespace for Vec and Buffer operands, which are not
+//  found by argument-dependent lookup: using namespace Expr::Operators;
+	inline namespace Operators {
+		template <typename L, typename R, typename = detail::EnableBinary<L, R>>
+		auto operator+(const L& l, const R& r) { return detail::binary<std::plus<>>(l, r); }
+
+		template <typename L, typename R, typename = detail::EnableBinary<L, R>>
+		auto operator-(const L& l, const R& r) { return detail::binary<std::minus<>>(l, r); }
+
+		template <typename L, typename R, typename = detail::EnableBinary<L, R>>
+		auto operator*(const L& l, const R& r) { return detail::binary<std::multiplies<>>(l, r); }
+
+		template <typename L, typename R, typename = detail::EnableBinary<L, R>>
+		auto operator/(const L& l, const R& r) { return detail::binary<std::divides<>>(l, r); }
+
+		template <typename E, typename = detail::EnableUnary<E>>
+		auto operator-(const E& e) { return detail::unary<std::negate<>>(e); }
+	}
+
+	template <typename E, typename = detail::EnableUnary<E>>
+	auto sqrt(const E& e) { return detail::unary<detail::Sqrt>(e); }
+
+	template <typename E, typename = detail::EnableUnary<E>>
+	auto abs(const E& e) { return detail::unary<detail::Abs>(e); }
+
+	template <typename E, typename = detail::EnableUnary<E>>
+	auto exp(const E& e) { return detail::unary<detail::Exp>(e); }
+
+	template <typename L, typename R, typename = detail::EnableBinary<L, R>>
+	auto min(const L& l, const R& r) { return detail::binary<detail::Min>(l, r); }
+
+	template <typename L, typename R, typename = detail::EnableBinary<L, R>>
+	auto max(const L& l, const R& r) { return detail::binary<detail::Max>(l, r); }
+
+//  The fused loop. e is taken by value so its operand pointers live in
+//  registers rather than memory the stores could alias.
+	template <typename T, typename E>
+	void evaluate(T* out, E e, size_t n)
+	{
+#if defined(__clang__)
+#pragma clang loop vectorize(assume_safety)
+#elif defined(__GNUC__)
+#pragma GCC ivdep
+#elif defined(_MSC_VER)
+#pragma loop(ivdep)
+#endif
+		for (size_t i = 0; i < n; ++i)
+			out[i] = static_cast<T>(e[i]);
+	}
+
+//  dest = expression, for a Vec<T> or Buffer<T> dest, resized to the
+//  expression's size. Safe when dest is also an operand.
+	template <typename C, typename E>
+	void assign(C& dest, const E& expression)
+	{
+		using T = detail::Element<C>;
+		const auto e = operand(expression);
+		const size_t n = e.size() == unsized ? dest.size() : e.size();
+		const bool resized = n != dest.size();
+		if (e.overlaps(dest.data(), dest.data() + dest.size(), resized)) {
+			std::vector<T> staged(n);
+			evaluate(staged.data(), e, n);
+			dest.resize(n);
+			std::copy(staged.begin(), staged.end(), dest.data());
+			return;
+		}
+		dest.resize(n);
+		evaluate(dest.data(), e, n);
+	}
+
+//  Sum of the elements of an expression, in one pass with eight partial
+//  sums that vectorize.
+	template <typename E>
+	auto sum(const E& expression)
+	{
+		const auto e = operand(expression);
+		using T = typename decltype(e)::value_type;
+		const size_t n = e.size() == unsized ? 0 : e.size();
+		T partial[8] = {};
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+			for (size_t j = 0; j < 8; ++j)
+				partial[j] += e[i + j];
+		T total = ((partial[0] + partial[1]) + (partial[2] + partial[3])) + ((partial[4] + partial[5]) + (partial[6] + partial[7]));
+		for (; i < n; ++i)
+			total += e[i];
+		return total;
+	}
+}
@@ -0,0 +1,253 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include "Buffer.h"
+#include "Complex.h"
+#include "Lut.h"
+
+#if ((defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))) || defined(__AVX2__)
+#include <immintrin.h>
+#define FFT_HAS_AVX2 1
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(__AVX2__)
+#define FFT_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define FFT_TARGET_AVX2
+#endif
+
+//==============================================================
+//	In-place radix-2/4 FFT on Complex
+//==============================================================
+//	Iterative decimation in time over interleaved Complex data. Pairs of
+//	radix-2 stages are fused into radix-4 passes, and the early passes run
+//	block by block so each block stays in L1 while its stages complete.
+//	Twiddles are precomputed per stage: tw[h + k] = exp(-2 pi i k / 2h) for
+//	k < h, so every pass reads its twiddles contiguously. Transforms up to
+//	compileTimeTwiddles points read a table built at compile time.
+
+namespace Fft {
+
+//  Auto picks AVX2 when the CPU has it; Avx2 forces it and is the caller's
+//  responsibility on older hardware.
+	enum class Kernel { Auto, Scalar, Avx2 };
+
+	constexpr size_t compileTimeTwiddles = 1024;
+	constexpr size_t blockSize = 2048; // complex values per cache block (32 KB)
+
+	namespace detail {
+		constexpr Complex stageTwiddle(size_t i)
+		{
+			size_t h = 1;
+			while (h * 2 <= i)
+				h *= 2;
+
+			const double angle = -Lut::pi * static_cast<double>(i - h) / static_cast<double>(h);
+			return i == 0 ? Complex(1, 0) : Complex(Lut::cos(angle), Lut::sin(angle));
+		}
+
+		inline constexpr auto twiddleTable = Lut::make_lut<compileTimeTwiddles>(stageTwiddle);
+
+	//  Larger sizes build their table once with std::cos/std::sin and keep it.
+		inline const Complex* twiddles(size_t n)
+		{
+			if (n <= compileTimeTwiddles)
+				return twiddleTable.data();
+
+			static std::mutex lock;
+			static std::unique_ptr<Complex[]> tables[64];
+
+			size_t log2n = 0;
+			while ((size_t{ 1 } << log2n) < n)
+				++log2n;
+
+			std::lock_guard<std::mutex> guard(lock);
+			if (!tables[log2n]) {
+				std::unique_ptr<Complex[]> table(new Complex[n]);
+				table[0] = Complex(1, 0);
+				for (size_t h = 1; h < n; h *= 2)
+					for (size_t k = 0; k < h; ++k) {
+						const double angle = -Lut::pi * static_cast<double>(k) / static_cast<double>(h);
+						table[h + k] = Complex(std::cos(angle), std::sin(angle));
+					}
+				tables[log2n] = std::move(table);
+			}
+			return tables[log2n].get();
+		}
+
+		inline void bitReverse(Complex* x, size_t n)
+		{
+			for (size_t i = 1, j = 0; i < n; ++i) {
+				size_t bit = n >> 1;
+				for (; j & bit; bit >>= 1)
+					j ^= bit;
+				j ^= bit;
+
+				if (i < j)
+					std::swap(x[i], x[j]);
+			}
+		}
+
+		inline void radix2(Complex* x, size_t n)
+		{
+			for (size_t i = 0; i < n; i += 2) {
+				const Complex a = x[i], b = x[i + 1];
+				x[i] = a + b;
+				x[i + 1] = a - b;
+			}
+		}
+
+	//  Stages h and 2h of the radix-2 network, fused.
+		inline void radix4Scalar(Complex* x, size_t n, size_t h, const Complex* tw)
+		{
+			const Complex* w1 = tw + h;
+			const Complex* w2 = tw + 2 * h;
+			for (size_t j = 0; j < n; j += 4 * h)
+				for (size_t k = 0; k < h; ++k) {
+					Complex* p = x + j + k;
+					const Complex a = p[0], b = p[h] * w1[k], c = p[2 * h], d = p[3 * h] * w1[k];
+					const Complex a1 = a + b, b1 = a - b, c1 = c + d, d1 = c - d;
+					const Complex c2 = c1 * w2[k], d2 = d1 * w2[k + h];
+					p[0] = a1 + c2;
+					p[h] = b1 + d2;
+					p[2 * h] = a1 - c2;
+					p[3 * h] = b1 - d2;
+				}
+		}
+
+#if defined(FFT_HAS_AVX2)
+	//  Two interleaved complex values per register: [re0, im0, re1, im1].
+		FFT_TARGET_AVX2 inline __m256d mulAvx2(__m256d x, __m256d w)
+		{
+			const __m256d wr = _mm256_movedup_pd(w);
+			const __m256d wi = _mm256_permute_pd(w, 0xF);
+			const __m256d xs = _mm256_permute_pd(x, 0x5);
+			return _mm256_fmaddsub_pd(x, wr, _mm256_mul_pd(xs, wi));
+		}
+
+	//  Same butterfly as radix4Scalar, two k at a time; needs h >= 2.
+		FFT_TARGET_AVX2 inline void radix4Avx2(Complex* x, size_t n, size_t h, const Complex* tw)
+		{
+			const double* w1 = reinterpret_cast<const double*>(tw + h);
+			const double* w2 = reinterpret_cast<const double*>(tw + 2 * h);
+			double* base = reinterpret_cast<double*>(x);
+			const size_t s = 2 * h; // doubles between p[0] and p[h]
+
+			for (size_t j = 0; j < n; j += 4 * h)
+				for (size_t k = 0; k < h; k += 2) {
+					double* p = base + 2 * (j + k);
+					const __m256d t1 = _mm256_loadu_pd(w1 + 2 * k);
+					const __m256d a = _mm256_loadu_pd(p);
+					const __m256d b = mulAvx2(_mm256_loadu_pd(p + s), t1);
+					const __m256d c = _mm256_loadu_pd(p + 2 * s);
+					const __m256d d = mulAvx2(_mm256_loadu_pd(p + 3 * s), t1);
+
+					const __m256d a1 = _mm256_add_pd(a, b), b1 = _mm256_sub_pd(a, b);
+					const __m256d c1 = _mm256_add_pd(c, d), d1 = _mm256_sub_pd(c, d);
+					const __m256d c2 = mulAvx2(c1, _mm256_loadu_pd(w2 + 2 * k));
+					const __m256d d2 = mulAvx2(d1, _mm256_loadu_pd(w2 + 2 * (k + h)));
+
+					_mm256_storeu_pd(p, _mm256_add_pd(a1, c2));
+					_mm256_storeu_pd(p + s, _mm256_add_pd(b1, d2));
+					_mm256_storeu_pd(p + 2 * s, _mm256_sub_pd(a1, c2));
+					_mm256_storeu_pd(p + 3 * s, _mm256_sub_pd(b1, d2));
+				}
+		}
+#endif
+
+		inline bool hasAvx2()
+		{
+#if defined(__AVX2__)
+			return true;
+#elif defined(FFT_HAS_AVX2)
+			static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+			return supported;
+#else
+			return false;
+#endif
+		}
+
+		inline void radix4(Complex* x, size_t n, size_t h, const Complex* tw, bool avx2)
+		{
+#if defined(FFT_HAS_AVX2)
+			if (avx2 && h >= 2)
+				return radix4Avx2(x, n, h, tw);
+#endif
+			(void)avx2;
+			radix4Scalar(x, n, h, tw);
+		}
+
+		inline void transform(Complex* x, size_t n, Kernel kernel)
+		{
+			if (n & (n - 1))
+				throw std::invalid_argument("Fft: size must be a power of two");
+			if (n < 2)
+				return;
+
+			const Complex* tw = twiddles(n);
+			const bool avx2 = kernel == Kernel::Avx2 || (kernel == Kernel::Auto && hasAvx2());
+
+			size_t log2n = 0;
+			while ((size_t{ 1 } << log2n) < n)
+				++log2n;
+
+			bitReverse(x, n);
+
+			size_t h0 = 1;
+			if (log2n & 1) {
+				radix2(x, n);
+				h0 = 2;
+			}
+
+		//  Passes that stay inside one block finish a block at a time.
+			const size_t block = std::min(n, blockSize);
+			size_t h = h0;
+			for (size_t j = 0; j < n; j += block)
+				for (h = h0; 4 * h <= block; h *= 4)
+					radix4(x + j, block, h, tw, avx2);
+
+			for (; 4 * h <= n; h *= 4)
+				radix4(x, n, h, tw, avx2);
+		}
+	}
+
+//  Forward transform: X[k] = sum x[j] exp(-2 pi i j k / n). n must be a power of two.
+	inline void forward(Complex* data, size_t n, Kernel kernel = Kernel::Auto)
+	{
+		detail::transform(data, n, kernel);
+	}
+
+//  Inverse transform, scaled by 1 / n so that inverse(forward(x)) == x.
+	inline void inverse(Complex* data, size_t n, Kernel kernel = Kernel::Auto)
+	{
+		for (size_t i = 0; i < n; ++i)
+			data[i] = data[i].conj();
+
+		detail::transform(data, n, kernel);
+
+		const double scale = 1.0 / static_cast<double>(n);
+		for (size_t i = 0; i < n; ++i)
+			data[i] = data[i].conj() * scale;
+	}
+
+	inline void forward(Buffer<Complex>& data, Kernel kernel = Kernel::Auto) { forward(data.data(), data.size(), kernel); }
+	inline void inverse(Buffer<Complex>& data, Kernel kernel = Kernel::Auto) { inverse(data.data(), data.size(), kernel); }
+
+//  O(n^2) reference transform for validation.
+	inline void naiveDft(const Complex* in, Complex* out, size_t n)
+	{
+		for (size_t k = 0; k < n; ++k) {
+			Complex sum;
+			for (size_t j = 0; j < n; ++j) {
+				const double angle = -2 * Lut::pi * static_cast<double>((j * k) % n) / static_cast<double>(n);
+				sum += in[j] * Complex(std::cos(angle), std::sin(angle));
+			}
+			out[k] = sum;
+		}
+	}
+}
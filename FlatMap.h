@@ -0,0 +1,251 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//==============================================================
+//	Flattened multi-key map
+//==============================================================
+//	cpp11LongTypedef in the right angle brackets example,
+//	std::map<int, std::map<int, std::map<int, int>>>, walks three red-black
+//	trees through separate heap nodes for every lookup. flat_map<K, V> keeps
+//	the keys sorted in one vector and the values in another, so a lookup is
+//	a binary search over contiguous keys and all the entries under a key
+//	prefix are one contiguous run:
+//
+//	  flat_map<std::tuple<int, int, int>, int> m(std::move(entries)); // sorts once
+//	  m.find({ 1, 2, 3 });
+//	  for (auto [key, value] : m.prefix(1, 2)) ...                   // (1, 2, *)
+//
+//	Building from a vector sorts once; insert() and erase() shift the
+//	vectors and suit occasional updates. Iterators and references are
+//	invalidated by any insert or erase. prefix() compares tuple prefixes
+//	with <, so it needs the keys ordered by std::less.
+
+namespace FlatMap {
+
+	namespace detail {
+
+//  Lexicographic comparison of the first sizeof...(P) elements of a tuple key
+//  against a prefix.
+		template <typename Key, typename... P>
+		struct PrefixLess
+		{
+			template <size_t... I>
+			static bool less(const Key& key, const std::tuple<const P&...>& prefix, std::index_sequence<I...>)
+			{
+				return std::forward_as_tuple(std::get<I>(key)...) < prefix;
+			}
+
+			template <size_t... I>
+			static bool less(const std::tuple<const P&...>& prefix, const Key& key, std::index_sequence<I...>)
+			{
+				return prefix < std::forward_as_tuple(std::get<I>(key)...);
+			}
+
+			bool operator()(const Key& key, const std::tuple<const P&...>& prefix) const { return less(key, prefix, std::index_sequence_for<P...>()); }
+			bool operator()(const std::tuple<const P&...>& prefix, const Key& key) const { return less(prefix, key, std::index_sequence_for<P...>()); }
+		};
+	}
+}
+
+template <typename K, typename V, typename Compare = std::less<K>>
+class flat_map
+{
+	std::vector<K> _keys;
+	std::vector<V> _values;
+	Compare _less;
+
+	template <bool Const>
+	class Iterator
+	{
+		using Map = std::conditional_t<Const, const flat_map, flat_map>;
+		using Ref = std::conditional_t<Const, const V&, V&>;
+
+		Map* _map;
+		size_t _i;
+
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = std::pair<const K&, Ref>;
+		using difference_type = std::ptrdiff_t;
+		using reference = value_type;
+		using pointer = void;
+
+		Iterator() : _map(nullptr), _i(0) {}
+		Iterator(Map* map, size_t i) : _map(map), _i(i) {}
+		operator Iterator<true>() const { return { _map, _i }; }
+
+		value_type operator*() const { return { _map->_keys[_i], _map->_values[_i] }; }
+		value_type operator[](difference_type d) const { return *(*this + d); }
+		const K& key() const { return _map->_keys[_i]; }
+		Ref value() const { return _map->_values[_i]; }
+		size_t index() const { return _i; }
+
+		Iterator& operator++() { ++_i; return *this; }
+		Iterator operator++(int) { Iterator t = *this; ++_i; return t; }
+		Iterator& operator--() { --_i; return *this; }
+		Iterator operator--(int) { Iterator t = *this; --_i; return t; }
+		Iterator& operator+=(difference_type d) { _i += d; return *this; }
+		Iterator& operator-=(difference_type d) { _i -= d; return *this; }
+		friend Iterator operator+(Iterator it, difference_type d) { return it += d; }
+		friend Iterator operator-(Iterator it, difference_type d) { return it -= d; }
+		friend difference_type operator-(const Iterator& a, const Iterator& b) { return static_cast<difference_type>(a._i) - static_cast<difference_type>(b._i); }
+
+		friend bool operator==(const Iterator& a, const Iterator& b) { return a._i == b._i; }
+		friend bool operator!=(const Iterator& a, const Iterator& b) { return a._i != b._i; }
+		friend bool operator<(const Iterator& a, const Iterator& b) { return a._i < b._i; }
+	};
+
+	template <typename Key>
+	size_t lowerIndex(const Key& key) const
+	{
+		return static_cast<size_t>(std::lower_bound(_keys.begin(), _keys.end(), key, _less) - _keys.begin());
+	}
+
+	template <typename... P>
+	std::pair<size_t, size_t> prefixIndices(const P&... prefix) const
+	{
+		static_assert(sizeof...(P) <= std::tuple_size<K>::value, "prefix longer than the key");
+		static_assert(std::is_same<Compare, std::less<K>>::value || std::is_same<Compare, std::less<>>::value, "prefix() searches in tuple < order, which Compare must be");
+		const auto range = std::equal_range(_keys.begin(), _keys.end(), std::tuple<const P&...>(prefix...), FlatMap::detail::PrefixLess<K, P...>());
+		return { static_cast<size_t>(range.first - _keys.begin()), static_cast<size_t>(range.second - _keys.begin()) };
+	}
+
+public:
+	using key_type = K;
+	using mapped_type = V;
+	using size_type = size_t;
+	using iterator = Iterator<false>;
+	using const_iterator = Iterator<true>;
+
+//  A run of entries, for prefix() and range queries.
+	template <typename It>
+	struct Range
+	{
+		It first, last;
+
+		It begin() const { return first; }
+		It end() const { return last; }
+		size_t size() const { return static_cast<size_t>(last - first); }
+		bool empty() const { return first == last; }
+	};
+
+	flat_map() = default;
+
+//  Bulk build: one stable sort; for repeated keys the last entry wins, as
+//  with repeated assignment through operator[].
+	explicit flat_map(std::vector<std::pair<K, V>> entries, Compare less = Compare()) :
+		_less(std::move(less))
+	{
+		std::stable_sort(entries.begin(), entries.end(), [&](const auto& a, const auto& b) { return _less(a.first, b.first); });
+
+		_keys.reserve(entries.size());
+		_values.reserve(entries.size());
+		for (auto& entry : entries) {
+			if (!_keys.empty() && !_less(_keys.back(), entry.first)) {
+				_values.back() = std::move(entry.second);
+				continue;
+			}
+			_keys.push_back(std::move(entry.first));
+			_values.push_back(std::move(entry.second));
+		}
+	}
+
+	size_type size() const { return _keys.size(); }
+	bool empty() const { return _keys.empty(); }
+
+	void reserve(size_t n)
+	{
+		_keys.reserve(n);
+		_values.reserve(n);
+	}
+
+	void clear()
+	{
+		_keys.clear();
+		_values.clear();
+	}
+
+//  heap bytes held by the two vectors
+	size_t memory() const { return _keys.capacity() * sizeof(K) + _values.capacity() * sizeof(V); }
+
+	iterator       begin()       { return { this, 0 }; }
+	iterator       end()         { return { this, size() }; }
+	const_iterator begin() const { return { this, 0 }; }
+	const_iterator end()   const { return { this, size() }; }
+
+	const std::vector<K>& keys() const { return _keys; }
+	const std::vector<V>& values() const { return _values; }
+
+	iterator find(const K& key)
+	{
+		const size_t i = lowerIndex(key);
+		return i < size() && !_less(key, _keys[i]) ? iterator(this, i) : end();
+	}
+
+	const_iterator find(const K& key) const { return const_cast<flat_map&>(*this).find(key); }
+
+	bool contains(const K& key) const { return find(key) != end(); }
+
+	V& at(const K& key)
+	{
+		const iterator it = find(key);
+		if (it == end())
+			throw std::out_of_range("flat_map: key not found");
+		return it.value();
+	}
+
+	const V& at(const K& key) const { return const_cast<flat_map&>(*this).at(key); }
+
+	iterator       lower_bound(const K& key)       { return { this, lowerIndex(key) }; }
+	const_iterator lower_bound(const K& key) const { return { this, lowerIndex(key) }; }
+
+//  Inserts (key, value) if key is absent. Linear in the entries after it.
+	std::pair<iterator, bool> insert(const K& key, V value)
+	{
+		const size_t i = lowerIndex(key);
+		if (i < size() && !_less(key, _keys[i]))
+			return { iterator(this, i), false };
+		_keys.insert(_keys.begin() + static_cast<std::ptrdiff_t>(i), key);
+		_values.insert(_values.begin() + static_cast<std::ptrdiff_t>(i), std::move(value));
+		return { iterator(this, i), true };
+	}
+
+	V& operator[](const K& key) { return insert(key, V()).first.value(); }
+
+	bool erase(const K& key)
+	{
+		const iterator it = find(key);
+		if (it == end())
+			return false;
+		_keys.erase(_keys.begin() + static_cast<std::ptrdiff_t>(it.index()));
+		_values.erase(_values.begin() + static_cast<std::ptrdiff_t>(it.index()));
+		return true;
+	}
+
+//  All entries whose key starts with prefix, for tuple keys: prefix(k1) is
+//  every (k1, *, *), prefix(k1, k2) every (k1, k2, *).
+	template <typename... P>
+	Range<iterator> prefix(const P&... prefix)
+	{
+		const auto [first, last] = prefixIndices(prefix...);
+		return { iterator(this, first), iterator(this, last) };
+	}
+
+	template <typename... P>
+	Range<const_iterator> prefix(const P&... prefix) const
+	{
+		const auto [first, last] = prefixIndices(prefix...);
+		return { const_iterator(this, first), const_iterator(this, last) };
+	}
+
+//  Entries with first <= key < last.
+	Range<const_iterator> range(const K& first, const K& last) const { return { lower_bound(first), lower_bound(last) }; }
+};
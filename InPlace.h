@@ -0,0 +1,182 @@
+#pragma once
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+//==============================================================
+//	In-place construction factories
+//==============================================================
+//	The AF wrapper in the std::forward example (C++11LibraryFeatures.cpp)
+//	builds an AF and then moves or copies it out. Since C++17 a prvalue is
+//	not materialized until it reaches its final object, so a factory that
+//	returns T(args...) directly constructs the caller's variable, member,
+//	or slot with no move and no copy at all, even for types that cannot be
+//	moved.
+//
+//	make_in_place<T>(args...) is that factory. construct_with(f) adapts any
+//	callable returning a T prvalue to the emplace functions of std::optional,
+//	std::variant and the standard containers; Buffer<T>::emplace and
+//	emplaceWith do the same for a Buffer slot. The static checks at the end
+//	count copies and moves, the way AF's constructors print them.
+
+//  T(args...), or T{ args... } for aggregates, returned as a prvalue. The
+//  arguments themselves are references: passing a T prvalue as an argument
+//  materializes it, and T is then moved from it.
+template <typename T, typename... Args>
+constexpr T make_in_place(Args&&... args) noexcept(std::is_nothrow_constructible<T, Args...>::value)
+{
+	if constexpr (std::is_constructible<T, Args...>::value)
+		return T(std::forward<Args>(args)...);
+	else
+		return T{ std::forward<Args>(args)... };
+}
+
+//  Converts to the result of f(), calling f only at the moment the target
+//  object is initialized. opt.emplace(construct_with(f)) builds the value
+//  straight into the optional's storage.
+//
+//  Copy-initialization (T t = construct_with(f)) is guaranteed to elide.
+//  Inside emplace the library direct-initializes T(construct_with(f)); GCC
+//  elides that as well (CWG 2327), other compilers may move once.
+template <typename F>
+class construct_with_t
+{
+	F _make;
+
+public:
+	using result_type = decltype(std::declval<F&>()());
+
+	constexpr explicit construct_with_t(F make) : _make(std::move(make)) {}
+
+	constexpr operator result_type() { return _make(); }
+};
+
+template <typename F>
+constexpr construct_with_t<F> construct_with(F make)
+{
+	return construct_with_t<F>(std::move(make));
+}
+
+//  Factory that emplaces from arguments, for callers holding an optional.
+template <typename T, typename... Args>
+T& emplace_in_place(std::optional<T>& slot, Args&&... args)
+{
+	return slot.emplace(construct_with([&] { return make_in_place<T>(std::forward<Args>(args)...); }));
+}
+
+template <typename T, typename... Types, typename... Args>
+T& emplace_in_place(std::variant<Types...>& slot, Args&&... args)
+{
+	return slot.template emplace<T>(construct_with([&] { return make_in_place<T>(std::forward<Args>(args)...); }));
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define IN_PLACE_CONVERSION_ELIDES 1
+#endif
+
+namespace InPlace {
+
+	namespace detail {
+
+		struct CopyMoveCount
+		{
+			int copies = 0;
+			int moves = 0;
+		};
+
+//  AF from the std::forward example, counting instead of printing.
+		struct CountedAF
+		{
+			CopyMoveCount* count;
+			int value;
+
+			constexpr CountedAF(CopyMoveCount& c, int v = 0) : count(&c), value(v) {}
+			constexpr CountedAF(const CountedAF& o) : count(o.count), value(o.value) { ++count->copies; }
+			constexpr CountedAF(CountedAF&& o) : count(o.count), value(o.value) { ++count->moves; }
+		};
+
+//  Neither copyable nor movable: these only compile with guaranteed elision.
+		struct PinnedAF
+		{
+			int value;
+
+			constexpr explicit PinnedAF(int v) : value(v) {}
+			PinnedAF(const PinnedAF&) = delete;
+			PinnedAF(PinnedAF&&) = delete;
+		};
+
+		struct AggregateAF
+		{
+			CountedAF af;
+			int extra;
+		};
+
+		template <typename Shape>
+		constexpr CopyMoveCount countCopiesAndMoves(Shape shape)
+		{
+			CopyMoveCount count;
+			shape(count);
+			return count;
+		}
+
+		constexpr bool noCopiesOrMoves(CopyMoveCount count) { return count.copies == 0 && count.moves == 0; }
+
+//  The std::forward example's wrapper, and the same factory built on make_in_place.
+		template <typename T>
+		constexpr CountedAF forwardingWrapper(T&& arg) { return CountedAF{ std::forward<T>(arg) }; }
+
+		template <typename... Args>
+		constexpr CountedAF inPlaceWrapper(Args&&... args) { return make_in_place<CountedAF>(std::forward<Args>(args)...); }
+
+		template <typename... Args>
+		constexpr CountedAF nestedWrapper(Args&&... args) { return inPlaceWrapper(std::forward<Args>(args)...); }
+
+		constexpr CopyMoveCount oldWrapper = countCopiesAndMoves([](CopyMoveCount& c) {
+			CountedAF a = forwardingWrapper(CountedAF(c));
+			CountedAF b = forwardingWrapper(a);
+			(void)b;
+		});
+		static_assert(oldWrapper.moves == 1 && oldWrapper.copies == 1, "the old wrapper moves a temporary and copies an lvalue");
+
+		static_assert(noCopiesOrMoves(countCopiesAndMoves([](CopyMoveCount& c) {
+			CountedAF a = make_in_place<CountedAF>(c, 1);
+			(void)a;
+		})), "make_in_place into a local");
+
+		static_assert(noCopiesOrMoves(countCopiesAndMoves([](CopyMoveCount& c) {
+			CountedAF a = nestedWrapper(c, 2);
+			(void)a;
+		})), "forwarding factories two levels deep");
+
+		static_assert(noCopiesOrMoves(countCopiesAndMoves([](CopyMoveCount& c) {
+			const bool odd = c.copies % 2 == 1;
+			CountedAF a = odd ? make_in_place<CountedAF>(c, 1) : inPlaceWrapper(c, 2);
+			(void)a;
+		})), "either branch of a conditional");
+
+		static_assert(noCopiesOrMoves(countCopiesAndMoves([](CopyMoveCount& c) {
+			AggregateAF a{ make_in_place<CountedAF>(c, 3), 4 };
+			(void)a;
+		})), "aggregate members");
+
+		static_assert(noCopiesOrMoves(countCopiesAndMoves([](CopyMoveCount& c) {
+			CountedAF a = construct_with([&c] { return make_in_place<CountedAF>(c, 7); });
+			(void)a;
+		})), "copy-initialization from construct_with");
+
+		static_assert(make_in_place<PinnedAF>(8).value == 8, "non-movable result");
+
+#if defined(IN_PLACE_CONVERSION_ELIDES)
+		static_assert(noCopiesOrMoves(countCopiesAndMoves([](CopyMoveCount& c) {
+			std::optional<CountedAF> slot(std::in_place, construct_with([&c] { return inPlaceWrapper(c, 9); }));
+			(void)slot;
+		})), "std::optional slot");
+
+		static_assert(noCopiesOrMoves(countCopiesAndMoves([](CopyMoveCount& c) {
+			std::variant<int, CountedAF> slot(std::in_place_type<CountedAF>, construct_with([&c] { return inPlaceWrapper(c, 10); }));
+			(void)slot;
+		})), "std::variant slot");
+#endif
+	}
+}
@@ -0,0 +1,365 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ThreadPool.h"
+
+//==============================================================
+//	Incremental computation graph
+//==============================================================
+//	std::async(std::launch::deferred, f) (see the memory model section of
+//	C++11LibraryFeatures.cpp) computes f lazily, but only once, and knows
+//	nothing about what f read. A Graph remembers both: each node is a named
+//	function of other nodes, its result is kept, and changing an input
+//	recomputes only the nodes downstream of it, the next time they are read:
+//
+//	  Incremental::Graph graph;
+//	  auto price = graph.input("price", 10.0);
+//	  auto count = graph.input("count", 3);
+//	  auto total = graph.node("total", [](double p, int n) { return p * n; }, price, count);
+//	  auto taxed = graph.node("taxed", [](double t) { return t * 1.2; }, total);
+//	  taxed.get();              // computes total, then taxed
+//	  price.set(11.0);          // marks total and taxed stale; computes nothing
+//	  taxed.get();              // recomputes both
+//	  count.set(3);             // same value: nothing becomes stale
+//
+//	A recomputed value that compares equal to the old one (for types with
+//	operator==) does not count as a change, so nodes that depend only on it
+//	are confirmed rather than recomputed. evaluate(pool) brings every stale
+//	node up to date, running the nodes of each dependency level side by side
+//	on a ThreadPool.
+//
+//	A Graph is not thread safe: set() and get() belong to one thread at a
+//	time, and node functions run on pool threads only inside evaluate().
+//	Node functions must not read other nodes except through their arguments.
+
+namespace Incremental {
+
+	class Graph;
+
+	namespace detail {
+
+		template <typename T, typename = void>
+		struct Comparable : std::false_type {};
+		template <typename T>
+		struct Comparable<T, std::void_t<decltype(std::declval<const T&>() == std::declval<const T&>())>> : std::true_type {};
+
+		class NodeBase
+		{
+		public:
+			std::string name;
+			size_t level = 0;                  // 0 for inputs, else 1 + the deepest input
+			std::vector<NodeBase*> inputs;
+			std::vector<NodeBase*> outputs;
+			uint64_t changedAt = 0;            // revision of the last change of value
+			uint64_t verifiedAt = 0;           // revision the value was last known current at
+			bool stale = true;
+			bool computed = false;
+
+			virtual ~NodeBase() = default;
+
+//  Recomputes the value; true if it changed.
+			virtual bool compute() = 0;
+		};
+
+		template <typename T>
+		class Cell : public NodeBase
+		{
+		public:
+			std::optional<T> value;
+
+			bool store(T v)
+			{
+				if constexpr (Comparable<T>::value)
+					if (value && *value == v)
+						return false;
+				value = std::move(v);
+				return true;
+			}
+		};
+
+		template <typename T>
+		class Source : public Cell<T>
+		{
+		public:
+			bool compute() override { return false; }
+		};
+
+		template <typename T, typename F, typename... In>
+		class Computed : public Cell<T>
+		{
+			F _f;
+			std::tuple<Cell<In>*...> _in;
+
+		public:
+			Computed(F f, Cell<In>*... in) : _f(std::move(f)), _in(in...) {}
+
+			bool compute() override
+			{
+				return this->store(std::apply([this](Cell<In>*... in) { return static_cast<T>(_f(*in->value...)); }, _in));
+			}
+		};
+	}
+
+//  A handle to a node of a Graph; copies refer to the same node.
+	template <typename T>
+	class Node
+	{
+	protected:
+		friend class Graph;
+
+		Graph* _graph = nullptr;
+		detail::Cell<T>* _cell = nullptr;
+
+		Node(Graph* graph, detail::Cell<T>* cell) : _graph(graph), _cell(cell) {}
+
+	public:
+		using value_type = T;
+
+		Node() = default;
+
+//  The current value, computing this node and whatever it depends on
+//  that is stale.
+		const T& get() const;
+
+		const std::string& name() const { return _cell->name; }
+		bool stale() const { return _cell->stale; }
+	};
+
+	template <typename T>
+	class Input : public Node<T>
+	{
+		friend class Graph;
+
+		using Node<T>::Node;
+
+	public:
+		Input() = default;
+
+//  Marks everything downstream stale, unless value equals the current one.
+		void set(T value);
+	};
+
+	class Graph
+	{
+		std::vector<std::unique_ptr<detail::NodeBase>> _nodes;
+		std::unordered_map<std::string, detail::NodeBase*> _byName;
+		std::vector<detail::NodeBase*> _stale;     // marked stale since the last evaluate(), with repeats
+		std::vector<detail::NodeBase*> _pending;
+		uint64_t _revision = 1;
+		std::atomic<size_t> _computations{ 0 };
+
+		template <typename T>
+		friend class Node;
+		template <typename T>
+		friend class Input;
+
+		void add(std::unique_ptr<detail::NodeBase> node, std::string name)
+		{
+			if (_byName.count(name) != 0)
+				throw std::invalid_argument("Incremental: duplicate node " + name);
+			node->name = std::move(name);
+			_byName.emplace(node->name, node.get());
+			if (node->stale)
+				_stale.push_back(node.get());
+			_nodes.push_back(std::move(node));
+		}
+
+		template <typename T>
+		detail::Cell<T>* cellOf(const Node<T>& node) const
+		{
+			if (node._graph != this)
+				throw std::invalid_argument("Incremental: node of another graph");
+			return node._cell;
+		}
+
+//  Marks the nodes downstream of changed stale, stopping at nodes that
+//  already are: their own outputs were marked then.
+		void invalidate(detail::NodeBase* changed)
+		{
+			_pending.assign(changed->outputs.begin(), changed->outputs.end());
+			while (!_pending.empty()) {
+				detail::NodeBase* node = _pending.back();
+				_pending.pop_back();
+				if (node->stale)
+					continue;
+				node->stale = true;
+				_stale.push_back(node);
+				_pending.insert(_pending.end(), node->outputs.begin(), node->outputs.end());
+			}
+			if (_stale.size() > 2 * _nodes.size())
+				compactStale();
+		}
+
+//  Drops entries refreshed by get() since they were marked, so a graph
+//  that is only ever read through get() does not grow the list forever.
+		void compactStale()
+		{
+			_stale.erase(std::remove_if(_stale.begin(), _stale.end(), [](const detail::NodeBase* node) { return !node->stale; }), _stale.end());
+			std::sort(_stale.begin(), _stale.end());
+			_stale.erase(std::unique(_stale.begin(), _stale.end()), _stale.end());
+		}
+
+//  Brings node up to date, given that its inputs are: recomputes it only
+//  if one of them changed since it was last verified.
+		void refresh(detail::NodeBase* node)
+		{
+			bool dirty = !node->computed;
+			for (const detail::NodeBase* input : node->inputs)
+				dirty = dirty || input->changedAt > node->verifiedAt;
+			if (dirty) {
+				if (node->compute() || !node->computed)
+					node->changedAt = _revision;
+				node->computed = true;
+				_computations.fetch_add(1, std::memory_order_relaxed);
+			}
+			node->verifiedAt = _revision;
+			node->stale = false;
+		}
+
+//  Depth first over the stale inputs, then node itself.
+		void ensure(detail::NodeBase* node)
+		{
+			if (!node->stale)
+				return;
+			for (detail::NodeBase* input : node->inputs)
+				ensure(input);
+			refresh(node);
+		}
+
+		template <typename T>
+		void set(detail::Cell<T>* cell, T value)
+		{
+			if (!cell->store(std::move(value)))
+				return;
+			cell->changedAt = ++_revision;
+			invalidate(cell);
+		}
+
+	public:
+		Graph() = default;
+		Graph(const Graph&) = delete;
+		Graph& operator=(const Graph&) = delete;
+
+		template <typename T>
+		Input<std::decay_t<T>> input(std::string name, T&& value)
+		{
+			using V = std::decay_t<T>;
+			auto cell = std::make_unique<detail::Source<V>>();
+			cell->value.emplace(std::forward<T>(value));
+			cell->stale = false;
+			cell->computed = true;
+			cell->changedAt = _revision;
+			detail::Cell<V>* raw = cell.get();
+			add(std::move(cell), std::move(name));
+			return Input<V>(this, raw);
+		}
+
+//  A node computing f(inputs' values...), lazily. The result type is
+//  f's, decayed.
+		template <typename F, typename... In>
+		auto node(std::string name, F f, const Node<In>&... inputs)
+		{
+			using T = std::decay_t<std::invoke_result_t<F&, const In&...>>;
+			auto cell = std::make_unique<detail::Computed<T, F, In...>>(std::move(f), cellOf(inputs)...);
+			for (detail::NodeBase* input : { static_cast<detail::NodeBase*>(cellOf(inputs))... }) {
+				cell->inputs.push_back(input);
+				cell->level = std::max(cell->level, input->level + 1);
+				input->outputs.push_back(cell.get());
+			}
+			detail::Cell<T>* raw = cell.get();
+			add(std::move(cell), std::move(name));
+			return Node<T>(this, raw);
+		}
+
+//  The node called name, which must hold a T.
+		template <typename T>
+		Node<T> find(const std::string& name)
+		{
+			const auto it = _byName.find(name);
+			detail::Cell<T>* cell = it == _byName.end() ? nullptr : dynamic_cast<detail::Cell<T>*>(it->second);
+			if (cell == nullptr)
+				throw std::invalid_argument("Incremental: no node " + name + " of that type");
+			return Node<T>(this, cell);
+		}
+
+//  Brings every stale node up to date. Nodes of one level depend only on
+//  lower levels, so each level runs as one batch on pool. If a node
+//  function throws, the exception propagates and the nodes not yet
+//  refreshed stay stale.
+		void evaluate(ThreadPool& pool = ThreadPool::instance())
+		{
+			std::vector<detail::NodeBase*> stale;
+			for (detail::NodeBase* node : _stale)
+				if (node->stale)
+					stale.push_back(node);
+			_stale.clear();
+			std::sort(stale.begin(), stale.end(), [](const detail::NodeBase* a, const detail::NodeBase* b) {
+				return a->level != b->level ? a->level < b->level : a < b;
+			});
+			stale.erase(std::unique(stale.begin(), stale.end()), stale.end());
+
+			try {
+				refreshLevels(stale, pool);
+			}
+			catch (...) {
+				for (detail::NodeBase* node : stale)
+					if (node->stale)
+						_stale.push_back(node);
+				throw;
+			}
+		}
+
+		size_t size() const { return _nodes.size(); }
+
+//  Node functions run so far, for checking how much work a change caused.
+		size_t computations() const { return _computations.load(std::memory_order_relaxed); }
+
+	private:
+		void refreshLevels(const std::vector<detail::NodeBase*>& stale, ThreadPool& pool)
+		{
+			for (size_t first = 0; first < stale.size();) {
+				size_t last = first;
+				while (last < stale.size() && stale[last]->level == stale[first]->level)
+					++last;
+				if (last - first == 1 || pool.size() == 1)
+					for (size_t i = first; i < last; ++i)
+						refresh(stale[i]);
+				else {
+					TaskGroup group(pool);
+					const size_t chunks = std::min<size_t>(size_t{ pool.size() } * 4, last - first);
+					for (size_t c = 0; c < chunks; ++c) {
+						detail::NodeBase* const* begin = stale.data() + first + (last - first) * c / chunks;
+						detail::NodeBase* const* end = stale.data() + first + (last - first) * (c + 1) / chunks;
+						group.run([this, begin, end] {
+							for (detail::NodeBase* const* node = begin; node != end; ++node)
+								refresh(*node);
+						});
+					}
+					group.wait();
+				}
+				first = last;
+			}
+		}
+	};
+
+	template <typename T>
+	const T& Node<T>::get() const
+	{
+		_graph->ensure(_cell);
+		return *_cell->value;
+	}
+
+	template <typename T>
+	void Input<T>::set(T value) { this->_graph->set(this->_cell, std::move(value)); }
+}
@@ -0,0 +1,274 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+//==============================================================
+//	Interned strings
+//==============================================================
+//	Hundreds of millions of copies of a few thousand short strings ("NYI",
+//	team names) as String = std::string cost 32 bytes each plus a heap block
+//	for the long ones. SymbolTable stores every distinct string once, in
+//	arena chunks, and hands out a 4-byte Symbol for it:
+//
+//	  Symbol team("NYI");                     // SymbolTable::instance()
+//	  team == Symbol("NYI");                  // compares the ids
+//	  std::string_view text = team.view();
+//	  std::unordered_map<Symbol, int> wins;   // hashes the id
+//
+//	The table is split into 64 shards by hash, each with a reader-writer
+//	lock, so threads interning different strings rarely meet and threads
+//	looking up existing ones share the lock. view() takes no lock at all:
+//	text and directory entries never move once written.
+//
+//	Symbols compare by id, which is interning order, not alphabetical.
+//	Strings are never freed before the table is.
+
+class Symbol
+{
+	uint32_t _id = 0;
+
+	friend class SymbolTable;
+	explicit Symbol(uint32_t id, int) : _id(id) {}
+
+public:
+//  the empty string
+	Symbol() = default;
+
+//  interned in SymbolTable::instance()
+	explicit Symbol(std::string_view text);
+
+	uint32_t id() const { return _id; }
+	bool empty() const { return _id == 0; }
+
+//  the text, for symbols of SymbolTable::instance()
+	std::string_view view() const;
+
+	friend bool operator==(Symbol a, Symbol b) { return a._id == b._id; }
+	friend bool operator!=(Symbol a, Symbol b) { return a._id != b._id; }
+	friend bool operator<(Symbol a, Symbol b) { return a._id < b._id; }
+};
+
+namespace std {
+	template <>
+	struct hash<Symbol>
+	{
+		size_t operator()(Symbol s) const { return static_cast<size_t>(s.id() * 0x9E3779B97F4A7C15ull >> 16); }
+	};
+}
+
+class SymbolTable
+{
+	static constexpr unsigned shardBits = 6;
+	static constexpr size_t shardCount = size_t(1) << shardBits;
+	static constexpr size_t sequenceLimit = size_t(1) << (32 - shardBits);
+
+//  Directory segment k holds 2^(k + firstSegmentBits) entries, so entries
+//  never move and 19 segments cover the 2^26 ids of a shard.
+	static constexpr unsigned firstSegmentBits = 8;
+	static constexpr unsigned segmentCount = 32 - shardBits - firstSegmentBits + 1;
+	static constexpr size_t minChunkBytes = size_t(1) << 12;
+	static constexpr size_t maxChunkBytes = size_t(1) << 20;
+
+	struct alignas(64) Shard
+	{
+		mutable std::shared_mutex mutex;
+		std::vector<uint64_t> slots;         // hash << 32 | id, 0 when empty
+		size_t count = 0;
+		std::unique_ptr<const char*[]> segments[segmentCount];
+		std::vector<std::unique_ptr<char[]>> chunks;
+		char* cursor = nullptr;
+		size_t left = 0;
+		size_t arenaBytes = 0;
+	};
+
+	Shard _shards[shardCount];
+
+	static uint64_t hashOf(std::string_view text) { return std::hash<std::string_view>()(text); }
+
+	static size_t segmentOf(size_t sequence, size_t& offset)
+	{
+		const size_t biased = sequence + (size_t(1) << firstSegmentBits);
+		size_t segment = 0;
+		while ((biased >> (segment + firstSegmentBits + 1)) != 0)
+			++segment;
+		offset = biased - (size_t(1) << (segment + firstSegmentBits));
+		return segment;
+	}
+
+	static const char* textOf(const Shard& shard, size_t sequence)
+	{
+		size_t offset;
+		const size_t segment = segmentOf(sequence, offset);
+		return shard.segments[segment][offset];
+	}
+
+	static std::string_view viewOf(const char* text)
+	{
+		uint32_t length;
+		std::memcpy(&length, text, sizeof length);
+		return { text + sizeof length, length };
+	}
+
+	static uint32_t idOf(size_t shard, size_t sequence) { return static_cast<uint32_t>(sequence << shardBits | shard); }
+
+//  Index of the slot holding text, or of the empty slot where it belongs.
+	static size_t probe(const Shard& shard, std::string_view text, uint32_t hash)
+	{
+		const size_t mask = shard.slots.size() - 1;
+		for (size_t i = hash & mask;; i = (i + 1) & mask) {
+			const uint64_t slot = shard.slots[i];
+			if (slot == 0)
+				return i;
+			if (static_cast<uint32_t>(slot >> 32) == hash && viewOf(textOf(shard, static_cast<uint32_t>(slot) >> shardBits)) == text)
+				return i;
+		}
+	}
+
+	static void grow(Shard& shard)
+	{
+		std::vector<uint64_t> slots(std::max<size_t>(64, 2 * shard.slots.size()));
+		const size_t mask = slots.size() - 1;
+		for (uint64_t slot : shard.slots) {
+			if (slot == 0)
+				continue;
+			size_t i = static_cast<uint32_t>(slot >> 32) & mask;
+			while (slots[i] != 0)
+				i = (i + 1) & mask;
+			slots[i] = slot;
+		}
+		shard.slots = std::move(slots);
+	}
+
+//  Copies text into the shard's arena; chunks double up to 1 MiB.
+	static const char* store(Shard& shard, std::string_view text)
+	{
+		const size_t bytes = (sizeof(uint32_t) + text.size() + 1 + 3) & ~size_t(3);
+		if (bytes > shard.left) {
+			const size_t size = std::max(bytes, std::clamp(shard.arenaBytes, minChunkBytes, maxChunkBytes));
+			shard.chunks.push_back(std::unique_ptr<char[]>(new char[size]));
+			shard.cursor = shard.chunks.back().get();
+			shard.left = size;
+			shard.arenaBytes += size;
+		}
+		char* p = shard.cursor;
+		const uint32_t length = static_cast<uint32_t>(text.size());
+		std::memcpy(p, &length, sizeof length);
+		std::memcpy(p + sizeof length, text.data(), text.size());
+		p[sizeof length + text.size()] = '\0';
+		shard.cursor += bytes;
+		shard.left -= bytes;
+		return p;
+	}
+
+public:
+	SymbolTable() = default;
+	SymbolTable(const SymbolTable&) = delete;
+	SymbolTable& operator=(const SymbolTable&) = delete;
+
+	static SymbolTable& instance()
+	{
+		static SymbolTable table;
+		return table;
+	}
+
+//  The symbol for text, adding it on first use.
+	Symbol intern(std::string_view text)
+	{
+		if (text.empty())
+			return Symbol();
+		if (text.size() > UINT32_MAX)
+			throw std::length_error("SymbolTable: string too long");
+
+		const uint64_t h = hashOf(text);
+		const size_t shardIndex = static_cast<size_t>(h >> (64 - shardBits));
+		const uint32_t hash = static_cast<uint32_t>(h) | 1;
+		Shard& shard = _shards[shardIndex];
+		{
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			if (!shard.slots.empty())
+				if (const uint64_t slot = shard.slots[probe(shard, text, hash)])
+					return Symbol(static_cast<uint32_t>(slot), 0);
+		}
+
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+		if (2 * (shard.count + 1) > shard.slots.size())
+			grow(shard);
+		uint64_t& slot = shard.slots[probe(shard, text, hash)];
+		if (slot != 0)
+			return Symbol(static_cast<uint32_t>(slot), 0);
+
+//  sequence 0 of shard 0 would be id 0, the empty string
+		const size_t sequence = shard.count + (shardIndex == 0 ? 1 : 0);
+		if (sequence >= sequenceLimit)
+			throw std::length_error("SymbolTable: shard full");
+		size_t offset;
+		const size_t segment = segmentOf(sequence, offset);
+		if (!shard.segments[segment])
+			shard.segments[segment].reset(new const char*[size_t(1) << (segment + firstSegmentBits)]);
+		shard.segments[segment][offset] = store(shard, text);
+
+		const uint32_t id = idOf(shardIndex, sequence);
+		slot = uint64_t(hash) << 32 | id;
+		++shard.count;
+		return Symbol(id, 0);
+	}
+
+//  The symbol for text if it has been interned, else the empty symbol.
+	Symbol find(std::string_view text) const
+	{
+		if (text.empty())
+			return Symbol();
+		const uint64_t h = hashOf(text);
+		const size_t shardIndex = static_cast<size_t>(h >> (64 - shardBits));
+		const Shard& shard = _shards[shardIndex];
+		std::shared_lock<std::shared_mutex> lock(shard.mutex);
+		if (shard.slots.empty())
+			return Symbol();
+		return Symbol(static_cast<uint32_t>(shard.slots[probe(shard, text, static_cast<uint32_t>(h) | 1)]), 0);
+	}
+
+//  The text of a symbol from this table; NUL-terminated.
+	std::string_view view(Symbol symbol) const
+	{
+		if (symbol.empty())
+			return {};
+		return viewOf(textOf(_shards[symbol.id() & (shardCount - 1)], symbol.id() >> shardBits));
+	}
+
+	size_t size() const
+	{
+		size_t total = 0;
+		for (const Shard& shard : _shards) {
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			total += shard.count;
+		}
+		return total;
+	}
+
+//  Heap bytes: arena chunks, directory segments and hash slots.
+	size_t memory() const
+	{
+		size_t total = 0;
+		for (const Shard& shard : _shards) {
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			total += shard.arenaBytes + shard.slots.capacity() * sizeof(uint64_t);
+			for (unsigned k = 0; k < segmentCount; ++k)
+				if (shard.segments[k])
+					total += (size_t(1) << (k + firstSegmentBits)) * sizeof(const char*);
+		}
+		return total;
+	}
+};
+
+inline Symbol::Symbol(std::string_view text) : Symbol(SymbolTable::instance().intern(text)) {}
+
+inline std::string_view Symbol::view() const { return SymbolTable::instance().view(*this); }
@@ -0,0 +1,245 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define KERNELS_X86 1
+#endif
+
+#include "TypeTraits.h"
+
+//==============================================================
+//	ISA-versioned kernels
+//==============================================================
+//	The inline namespace example in C++11Features.cpp (Program::Version2)
+//	applied to instruction sets. Hot kernels are compiled once per level, in
+//	Kernels::Isa::v_sse2, v_avx2 and v_avx512, from the same source
+//	(KernelsBody.h). Each level is compiled for its own x86-64 psABI level
+//	(baseline, v3, v4) whatever the -m flags of the translation unit, and
+//	the level namespace is part of every mangled name, so every definition
+//	of, say, v_sse2::sum is the same SSE2 code and the linker may keep any.
+//	A level's code calls nothing outside its namespace but builtins.
+//
+//	Kernels::sum / copy / hash dispatch through a function-pointer table
+//	chosen once from CPUID on first use; force() pins a level for tests and
+//	benchmarks. Kernels::Isa::sum etc. call the best level the build itself
+//	targets (the inline namespace) with no dispatch at all. Off x86 all three
+//	levels hold the same portable code.
+
+namespace Kernels {
+
+	enum class Level { Sse2, Avx2, Avx512 };
+
+	inline const char* name(Level level)
+	{
+		switch (level) {
+		case Level::Sse2: return "sse2";
+		case Level::Avx2: return "avx2";
+		default: return "avx512";
+		}
+	}
+
+	namespace detail {
+#if defined(__GNUC__) || defined(__clang__)
+		typedef uint64_t U64x2 __attribute__((vector_size(16)));
+		typedef uint64_t U64x4 __attribute__((vector_size(32)));
+		typedef uint64_t U64x8 __attribute__((vector_size(64)));
+		typedef double F64x2 __attribute__((vector_size(16)));
+		typedef double F64x4 __attribute__((vector_size(32)));
+		typedef double F64x8 __attribute__((vector_size(64)));
+#else
+	//  Lanes with the vector-extension operators the kernels use. MSVC builds
+	//  every level with the same flags, so the width is not significant.
+		template <typename T>
+		struct Lanes2
+		{
+			T v[2];
+
+			Lanes2& operator+=(const Lanes2& o) { v[0] += o.v[0]; v[1] += o.v[1]; return *this; }
+			Lanes2& operator*=(T s) { v[0] *= s; v[1] *= s; return *this; }
+			Lanes2 operator*(T s) const { return { { v[0] * s, v[1] * s } }; }
+			Lanes2 operator<<(int b) const { return { { v[0] << b, v[1] << b } }; }
+			Lanes2 operator>>(int b) const { return { { v[0] >> b, v[1] >> b } }; }
+			Lanes2 operator|(const Lanes2& o) const { return { { v[0] | o.v[0], v[1] | o.v[1] } }; }
+		};
+		typedef Lanes2<uint64_t> U64x2, U64x4, U64x8;
+		typedef Lanes2<double> F64x2, F64x4, F64x8;
+#endif
+
+		constexpr uint64_t prime64[5] = {
+			0x9E3779B185EBCA87ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0x85EBCA77C2B2AE63ull, 0x27D4EB2F165667C5ull
+		};
+	}
+
+	namespace Isa {
+#if defined(KERNELS_X86) && defined(__clang__)
+#pragma clang attribute push(__attribute__((target("arch=x86-64,no-avx"))), apply_to = function)
+#elif defined(KERNELS_X86) && defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("arch=x86-64,no-avx")
+#endif
+#if !defined(__AVX2__)
+		inline
+#endif
+		namespace v_sse2 {
+			using VecU64 = detail::U64x2;
+			using VecF64 = detail::F64x2;
+#include "KernelsBody.h"
+		}
+#if defined(KERNELS_X86) && defined(__clang__)
+#pragma clang attribute pop
+#elif defined(KERNELS_X86) && defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(KERNELS_X86) && defined(__clang__)
+#pragma clang attribute push(__attribute__((target("arch=x86-64-v3,no-avx512f"))), apply_to = function)
+#elif defined(KERNELS_X86) && defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("arch=x86-64-v3,no-avx512f")
+#endif
+#if defined(__AVX2__) && !defined(__AVX512F__)
+		inline
+#endif
+		namespace v_avx2 {
+			using VecU64 = detail::U64x4;
+			using VecF64 = detail::F64x4;
+#include "KernelsBody.h"
+		}
+#if defined(KERNELS_X86) && defined(__clang__)
+#pragma clang attribute pop
+#elif defined(KERNELS_X86) && defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(KERNELS_X86) && defined(__clang__)
+#pragma clang attribute push(__attribute__((target("arch=x86-64-v4"))), apply_to = function)
+#elif defined(KERNELS_X86) && defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("arch=x86-64-v4")
+#endif
+#if defined(__AVX512F__)
+		inline
+#endif
+		namespace v_avx512 {
+			using VecU64 = detail::U64x8;
+			using VecF64 = detail::F64x8;
+#include "KernelsBody.h"
+		}
+#if defined(KERNELS_X86) && defined(__clang__)
+#pragma clang attribute pop
+#elif defined(KERNELS_X86) && defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+	}
+
+//  One level's entry points.
+	struct Table
+	{
+		Level level;
+		double (*sumDouble)(const double*, size_t);
+		int64_t (*sumInt64)(const int64_t*, size_t);
+		void (*copy)(void*, const void*, size_t);
+		uint64_t (*hash)(const void*, size_t, uint64_t);
+	};
+
+	namespace detail {
+		inline const Table tables[] = {
+			{ Level::Sse2, Isa::v_sse2::sum, Isa::v_sse2::sum, Isa::v_sse2::copy, Isa::v_sse2::hash },
+			{ Level::Avx2, Isa::v_avx2::sum, Isa::v_avx2::sum, Isa::v_avx2::copy, Isa::v_avx2::hash },
+			{ Level::Avx512, Isa::v_avx512::sum, Isa::v_avx512::sum, Isa::v_avx512::copy, Isa::v_avx512::hash },
+		};
+
+#if defined(_MSC_VER) && defined(KERNELS_X86)
+		inline bool cpuHas(int leaf, int subleaf, int reg, int bit)
+		{
+			int info[4];
+			__cpuidex(info, leaf, subleaf);
+			return (info[reg] >> bit) & 1;
+		}
+
+	//  The OS must also save the wide registers on a context switch (XCR0).
+		inline Level detectLevel()
+		{
+			if (!cpuHas(1, 0, 2, 27)) // OSXSAVE
+				return Level::Sse2;
+			const unsigned long long xcr0 = _xgetbv(0);
+			const bool avx2 = (xcr0 & 0x6) == 0x6 && cpuHas(7, 0, 1, 5) && cpuHas(1, 0, 2, 12) && cpuHas(7, 0, 1, 8);
+			const bool avx512 = avx2 && (xcr0 & 0xe6) == 0xe6 &&
+				cpuHas(7, 0, 1, 16) && cpuHas(7, 0, 1, 17) && cpuHas(7, 0, 1, 30) && cpuHas(7, 0, 1, 31);
+			return avx512 ? Level::Avx512 : avx2 ? Level::Avx2 : Level::Sse2;
+		}
+#elif defined(KERNELS_X86)
+	//  __builtin_cpu_supports also checks that the OS saves the registers.
+		inline Level detectLevel()
+		{
+			__builtin_cpu_init();
+			const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("bmi2");
+			const bool avx512 = avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+				__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl");
+			return avx512 ? Level::Avx512 : avx2 ? Level::Avx2 : Level::Sse2;
+		}
+#else
+		inline Level detectLevel() { return Level::Sse2; }
+#endif
+	}
+
+//  Best level this CPU supports, detected once.
+	inline Level supportedLevel()
+	{
+		static const Level level = detail::detectLevel();
+		return level;
+	}
+
+	namespace detail {
+		inline std::atomic<const Table*>& active()
+		{
+			static std::atomic<const Table*> table{ &tables[static_cast<int>(supportedLevel())] };
+			return table;
+		}
+	}
+
+	inline const Table& table() { return *detail::active().load(std::memory_order_relaxed); }
+	inline Level level() { return table().level; }
+
+//  Pins the dispatched kernels to level. Returns false, leaving the choice
+//  unchanged, if the CPU does not support it.
+	inline bool force(Level level)
+	{
+		if (static_cast<int>(level) > static_cast<int>(supportedLevel()))
+			return false;
+		detail::active().store(&detail::tables[static_cast<int>(level)], std::memory_order_relaxed);
+		return true;
+	}
+
+//  Back to the best supported level.
+	inline void reset() { force(supportedLevel()); }
+
+	inline double sum(const double* p, size_t n) { return table().sumDouble(p, n); }
+	inline int64_t sum(const int64_t* p, size_t n) { return table().sumInt64(p, n); }
+	inline void copy(void* dst, const void* src, size_t bytes) { table().copy(dst, src, bytes); }
+	inline uint64_t hash(const void* data, size_t bytes, uint64_t seed = 0) { return table().hash(data, bytes, seed); }
+
+//  Hash and key-equality functors for unordered containers of bitwise
+//  comparable keys (TypeTraits.h): one hash over the key's bytes, and memcmp.
+	template <typename T>
+	struct BitwiseHash
+	{
+		static_assert(Traits::is_bitwise_comparable_v<T>, "equal keys must have equal bytes");
+		size_t operator()(const T& key) const { return static_cast<size_t>(Isa::hash(std::addressof(key), sizeof(T), 0)); }
+	};
+
+	template <typename T>
+	struct BitwiseEqual
+	{
+		static_assert(Traits::is_bitwise_comparable_v<T>, "equal keys must have equal bytes");
+		bool operator()(const T& a, const T& b) const { return std::memcmp(std::addressof(a), std::addressof(b), sizeof(T)) == 0; }
+	};
+}
@@ -0,0 +1,124 @@
+//==============================================================
+//	Kernel bodies for Kernels.h
+//==============================================================
+//	Included once per ISA level, inside that level's namespace and target
+//	options, so this file deliberately has no include guard. The level
+//	defines VecU64 and VecF64 at its native register width; the kernels keep
+//	a fixed number of logical lanes made of as many registers as needed and
+//	combine them in a fixed order, so every level returns bit-identical
+//	results and only the instructions differ.
+
+constexpr size_t lanesPerVec = sizeof(VecU64) / sizeof(uint64_t);
+
+//  xxHash64 helpers, per level so they are compiled for it too.
+constexpr uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+constexpr uint64_t round(uint64_t acc, uint64_t v) { return rotl(acc + v * detail::prime64[1], 31) * detail::prime64[0]; }
+constexpr uint64_t mergeRound(uint64_t h, uint64_t lane) { return (h ^ round(0, lane)) * detail::prime64[0] + detail::prime64[3]; }
+
+constexpr uint64_t avalanche(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= detail::prime64[1];
+	h ^= h >> 29;
+	h *= detail::prime64[2];
+	return h ^ (h >> 32);
+}
+
+//  Sum of n doubles: 32 lanes hide the add latency at every width.
+inline double sum(const double* p, size_t n)
+{
+	constexpr size_t vecs = 32 / lanesPerVec;
+	VecF64 acc[vecs] = {};
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32)
+		for (size_t j = 0; j < vecs; ++j) {
+			VecF64 v;
+			std::memcpy(&v, p + i + j * lanesPerVec, sizeof v);
+			acc[j] += v;
+		}
+
+	double lanes[32];
+	std::memcpy(lanes, acc, sizeof lanes);
+	for (size_t k = 0; i < n; ++i, ++k)
+		lanes[k] += p[i];
+	for (size_t width = 16; width > 0; width /= 2)
+		for (size_t k = 0; k < width; ++k)
+			lanes[k] += lanes[k + width];
+	return lanes[0];
+}
+
+//  Sum of n integers, wrapping on overflow.
+inline int64_t sum(const int64_t* p, size_t n)
+{
+	constexpr size_t vecs = 16 / lanesPerVec;
+	VecU64 acc[vecs] = {};
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+		for (size_t j = 0; j < vecs; ++j) {
+			VecU64 v;
+			std::memcpy(&v, p + i + j * lanesPerVec, sizeof v);
+			acc[j] += v;
+		}
+
+	uint64_t lanes[16];
+	std::memcpy(lanes, acc, sizeof lanes);
+	uint64_t total = 0;
+	for (uint64_t lane : lanes)
+		total += lane;
+	for (; i < n; ++i)
+		total += static_cast<uint64_t>(p[i]);
+	return static_cast<int64_t>(total);
+}
+
+//  memcpy for non-overlapping ranges, 128 bytes per step in the level's
+//  widest registers.
+inline void copy(void* dst, const void* src, size_t bytes)
+{
+	constexpr size_t vecs = 128 / sizeof(VecU64);
+	unsigned char* d = static_cast<unsigned char*>(dst);
+	const unsigned char* s = static_cast<const unsigned char*>(src);
+	size_t i = 0;
+	for (; i + 128 <= bytes; i += 128) {
+		VecU64 v[vecs];
+		std::memcpy(v, s + i, sizeof v);
+		std::memcpy(d + i, v, sizeof v);
+	}
+	std::memcpy(d + i, s + i, bytes - i);
+}
+
+//  64-bit hash: xxHash64 rounds on eight lanes per 64-byte stripe, then the
+//  xxHash64 tail and avalanche. Not compatible with XXH64 itself.
+inline uint64_t hash(const void* data, size_t bytes, uint64_t seed)
+{
+	constexpr size_t vecs = 8 / lanesPerVec;
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	uint64_t lanes[8];
+	for (size_t k = 0; k < 8; ++k)
+		lanes[k] = seed + detail::prime64[k & 3] + k;
+
+	VecU64 acc[vecs];
+	std::memcpy(acc, lanes, sizeof acc);
+	size_t i = 0;
+	for (; i + 64 <= bytes; i += 64)
+		for (size_t j = 0; j < vecs; ++j) {
+			VecU64 v;
+			std::memcpy(&v, p + i + j * sizeof v, sizeof v);
+			acc[j] += v * detail::prime64[1];
+			acc[j] = (acc[j] << 31) | (acc[j] >> 33);
+			acc[j] *= detail::prime64[0];
+		}
+	std::memcpy(lanes, acc, sizeof lanes);
+
+	uint64_t h = bytes;
+	for (uint64_t lane : lanes)
+		h = mergeRound(h, lane);
+
+	for (; i + 8 <= bytes; i += 8) {
+		uint64_t v;
+		std::memcpy(&v, p + i, sizeof v);
+		h = rotl(h ^ round(0, v), 27) * detail::prime64[0] + detail::prime64[3];
+	}
+	for (; i < bytes; ++i)
+		h = rotl(h ^ (p[i] * detail::prime64[4]), 11) * detail::prime64[0];
+	return avalanche(h);
+}
@@ -0,0 +1,569 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "ToChars.h"
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+//==============================================================
+//	Asynchronous batched logging
+//==============================================================
+//	f(int&&) and f(T&&) in C++11Features.cpp log with cout << ... << endl,
+//	which takes the stream lock, formats through the locale and flushes on
+//	every call. Log::print keeps all of that off the calling thread:
+//
+//	  Log::print("normal f() - {}", t);
+//
+//	copies the format literal's address and the arguments' bytes into a
+//	lock-free ring owned by the calling thread, and returns. A background
+//	writer drains every thread's ring, formats with Format::toChars and
+//	writes 64 KiB batches with a single write() each.
+//
+//	Rings are bounded (Options::ringBytes per thread). When one is full the
+//	record is dropped and counted (Overflow::Drop, the default) or the
+//	caller waits for the writer (Overflow::Block). flush() drains
+//	synchronously; installCrashHandler() also drains on fatal signals and
+//	std::terminate. Arguments may be arithmetic, bool, char, enums,
+//	pointers and strings (copied); the format must be a string literal, and
+//	each {} takes the next argument.
+
+namespace Log {
+
+	enum class Overflow { Drop, Block };
+
+	struct Options
+	{
+		int fd = 1;                                   // standard output
+		std::string path;                             // appended to instead of fd, if set
+		size_t ringBytes = size_t(1) << 16;           // per thread, a power of two
+		Overflow overflow = Overflow::Drop;
+		bool timestamps = true;                       // "[seconds.micros] " since start
+		std::chrono::microseconds interval{ 1000 };   // writer wake-up period
+	};
+
+	namespace detail {
+
+		inline void writeAll(int fd, const char* data, size_t n)
+		{
+			while (n > 0) {
+#if defined(_WIN32)
+				const int written = _write(fd, data, static_cast<unsigned>(std::min<size_t>(n, 1u << 30)));
+				if (written <= 0)
+					return;
+#else
+				const ssize_t written = ::write(fd, data, n);
+				if (written < 0 && errno == EINTR)
+					continue;
+				if (written <= 0)
+					return;
+#endif
+				data += written;
+				n -= static_cast<size_t>(written);
+			}
+		}
+
+//  Output buffer of one drain: appends and writes whole batches.
+		class Batch
+		{
+			static constexpr size_t capacity = size_t(1) << 16;
+
+			int _fd = 1;
+			size_t _used = 0;
+			char _data[capacity];
+
+		public:
+			void target(int fd) { _fd = fd; }
+
+			void append(const char* s, size_t n)
+			{
+				while (n > 0) {
+					if (_used == capacity)
+						flush();
+					const size_t k = std::min(n, capacity - _used);
+					std::memcpy(_data + _used, s, k);
+					_used += k;
+					s += k;
+					n -= k;
+				}
+			}
+
+			void append(char c) { append(&c, 1); }
+
+//  n contiguous bytes to write into, then commit(end)
+			char* room(size_t n)
+			{
+				if (capacity - _used < n)
+					flush();
+				return _data + _used;
+			}
+
+			void commit(char* end) { _used = static_cast<size_t>(end - _data); }
+
+			void flush()
+			{
+				writeAll(_fd, _data, _used);
+				_used = 0;
+			}
+		};
+
+//  Argument bytes in the ring: trivially copied values, strings as a
+//  32-bit length and the characters.
+		template <typename T, typename = void>
+		struct Codec
+		{
+			static_assert(sizeof(T) == 0, "Log::print: unsupported argument type");
+		};
+
+		template <typename T>
+		struct Codec<T, std::enable_if_t<std::is_arithmetic<T>::value>>
+		{
+			static size_t size(T) { return sizeof(T); }
+
+			static unsigned char* encode(unsigned char* p, T v)
+			{
+				std::memcpy(p, &v, sizeof v);
+				return p + sizeof v;
+			}
+
+			static const unsigned char* decode(const unsigned char* p, Batch& out)
+			{
+				T v;
+				std::memcpy(&v, p, sizeof v);
+				if constexpr (std::is_same<T, bool>::value)
+					v ? out.append("true", 4) : out.append("false", 5);
+				else if constexpr (std::is_same<T, char>::value)
+					out.append(v);
+				else
+					out.commit(Format::toChars(out.room(Format::maxChars), v));
+				return p + sizeof v;
+			}
+		};
+
+		template <typename T>
+		struct Codec<T, std::enable_if_t<std::is_enum<T>::value>> : Codec<std::underlying_type_t<T>>
+		{
+			static size_t size(T) { return sizeof(T); }
+			static unsigned char* encode(unsigned char* p, T v) { return Codec<std::underlying_type_t<T>>::encode(p, static_cast<std::underlying_type_t<T>>(v)); }
+		};
+
+		struct StringCodec
+		{
+			static size_t size(std::string_view s) { return sizeof(uint32_t) + s.size(); }
+
+			static unsigned char* encode(unsigned char* p, std::string_view s)
+			{
+				const uint32_t n = static_cast<uint32_t>(s.size());
+				std::memcpy(p, &n, sizeof n);
+				std::memcpy(p + sizeof n, s.data(), n);
+				return p + sizeof n + n;
+			}
+
+			static const unsigned char* decode(const unsigned char* p, Batch& out)
+			{
+				uint32_t n;
+				std::memcpy(&n, p, sizeof n);
+				out.append(reinterpret_cast<const char*>(p + sizeof n), n);
+				return p + sizeof n + n;
+			}
+		};
+
+		template <> struct Codec<const char*> : StringCodec {};
+		template <> struct Codec<char*> : StringCodec {};
+		template <> struct Codec<std::string> : StringCodec {};
+		template <> struct Codec<std::string_view> : StringCodec {};
+
+		template <typename T>
+		struct Codec<T*, std::enable_if_t<!std::is_same<std::remove_cv_t<T>, char>::value>>
+		{
+			static size_t size(const T*) { return sizeof(uintptr_t); }
+
+			static unsigned char* encode(unsigned char* p, const T* v)
+			{
+				const uintptr_t bits = reinterpret_cast<uintptr_t>(v);
+				std::memcpy(p, &bits, sizeof bits);
+				return p + sizeof bits;
+			}
+
+			static const unsigned char* decode(const unsigned char* p, Batch& out)
+			{
+				uintptr_t bits;
+				std::memcpy(&bits, p, sizeof bits);
+				char hex[2 + 2 * sizeof bits];
+				char* end = hex + sizeof hex;
+				char* first = end;
+				do {
+					*--first = "0123456789abcdef"[bits & 15];
+					bits >>= 4;
+				} while (bits != 0);
+				*--first = 'x';
+				*--first = '0';
+				out.append(first, static_cast<size_t>(end - first));
+				return p + sizeof bits;
+			}
+		};
+
+		using FormatFn = void (*)(const char* format, const unsigned char* args, Batch& out);
+
+//  One record in a ring, followed by its encoded arguments. The unused
+//  tail before the ring wraps holds only bytes and flags, with wrapFlag
+//  set: it can be as short as 8 bytes.
+		struct Record
+		{
+			static constexpr uint32_t wrapFlag = 1;
+
+			uint32_t bytes;
+			uint32_t flags;
+			FormatFn format;
+			const char* text;
+			int64_t ticks;
+		};
+
+		constexpr size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+		template <typename... Args>
+		void formatRecord(const char* format, const unsigned char* args, Batch& out)
+		{
+			[[maybe_unused]] auto next = [&](auto decode) {
+				const char* hole = std::strstr(format, "{}");
+				if (hole) {
+					out.append(format, static_cast<size_t>(hole - format));
+					format = hole + 2;
+				}
+				else {
+					const size_t n = std::strlen(format);
+					out.append(format, n);
+					format += n;
+					out.append(' ');
+				}
+				args = decode(args, out);
+			};
+			(next(&Codec<Args>::decode), ...);
+			out.append(format, std::strlen(format));
+			out.append('\n');
+		}
+
+//  Single-producer single-consumer byte ring: the owning thread writes,
+//  the writer (or a flush) reads. Positions only grow.
+		struct Ring
+		{
+			const size_t capacity;
+			std::unique_ptr<unsigned char[]> data;
+
+			alignas(64) std::atomic<size_t> tail{ 0 };
+			size_t cachedHead = 0;
+			std::atomic<uint64_t> dropped{ 0 };
+			std::atomic<bool> nudged{ false };
+
+			alignas(64) std::atomic<size_t> head{ 0 };
+			std::atomic<bool> closed{ false };
+
+//  Touched up front so the first laps of a thread do not page fault.
+			explicit Ring(size_t bytes) : capacity(bytes), data(new unsigned char[bytes]) { std::memset(data.get(), 0, bytes); }
+
+//  Room for n bytes (a multiple of 8) at the returned pointer, or null.
+			unsigned char* reserve(size_t n, size_t& at)
+			{
+				size_t t = tail.load(std::memory_order_relaxed);
+				const size_t offset = t & (capacity - 1);
+				const size_t contiguous = capacity - offset;
+				const size_t needed = n <= contiguous ? n : contiguous + n;
+				if (t + needed - cachedHead > capacity) {
+					cachedHead = head.load(std::memory_order_acquire);
+					if (t + needed - cachedHead > capacity)
+						return nullptr;
+				}
+				if (n > contiguous) {
+					const uint32_t skip[2] = { static_cast<uint32_t>(contiguous), Record::wrapFlag };
+					std::memcpy(data.get() + offset, skip, sizeof skip);
+					t += contiguous;
+				}
+				at = t;
+				return data.get() + (t & (capacity - 1));
+			}
+
+			void publish(size_t at, size_t n) { tail.store(at + n, std::memory_order_release); }
+
+			size_t used() const { return tail.load(std::memory_order_relaxed) - cachedHead; }
+
+//  Formats every published record into out.
+			void drain(Batch& out, int64_t start, bool timestamps)
+			{
+				size_t h = head.load(std::memory_order_relaxed);
+				const size_t t = tail.load(std::memory_order_acquire);
+				while (h != t) {
+					const unsigned char* p = data.get() + (h & (capacity - 1));
+					Record record;
+					std::memcpy(&record, p, sizeof(uint32_t) + sizeof(uint32_t));
+					if ((record.flags & Record::wrapFlag) == 0) {
+						std::memcpy(&record, p, sizeof record);
+						if (timestamps) {
+							const int64_t micros = (record.ticks - start) / 1000;
+							char* q = out.room(2 * Format::maxChars);
+							*q++ = '[';
+							q = Format::toChars(q, micros / 1000000);
+							*q++ = '.';
+							const int64_t fraction = micros % 1000000;
+							for (int64_t d = 100000; d > 0; d /= 10)
+								*q++ = static_cast<char>('0' + fraction / d % 10);
+							*q++ = ']';
+							*q++ = ' ';
+							out.commit(q);
+						}
+						record.format(record.text, p + sizeof record, out);
+					}
+					h += record.bytes;
+				}
+				head.store(h, std::memory_order_release);
+				nudged.store(false, std::memory_order_relaxed);
+
+				if (const uint64_t lost = dropped.exchange(0, std::memory_order_relaxed)) {
+					char* q = out.room(2 * Format::maxChars);
+					q = Format::toChars(q, lost);
+					out.commit(q);
+					out.append(" log records dropped\n", 21);
+				}
+			}
+		};
+
+		inline int64_t now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		class Logger
+		{
+			Options _options;
+			int _fd;
+			const int64_t _start = now();
+
+			std::mutex _ringsMutex;
+			std::vector<std::unique_ptr<Ring>> _rings;
+
+			std::mutex _drainMutex;
+			Batch _batch;
+
+			std::mutex _wakeMutex;
+			std::condition_variable _wake;
+			bool _stop = false;
+			std::thread _writer;
+
+			void run()
+			{
+				std::unique_lock<std::mutex> lock(_wakeMutex);
+				while (!_stop) {
+					_wake.wait_for(lock, _options.interval);
+					lock.unlock();
+					drain();
+					lock.lock();
+				}
+			}
+
+		public:
+			explicit Logger(Options options) :
+				_options(std::move(options)),
+				_fd(_options.fd)
+			{
+				if (!_options.path.empty()) {
+#if defined(_WIN32)
+					_fd = _open(_options.path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, 0644);
+#else
+					_fd = ::open(_options.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+					if (_fd < 0)
+						_fd = _options.fd;
+				}
+				_batch.target(_fd);
+				_writer = std::thread([this] { run(); });
+			}
+
+			~Logger()
+			{
+				{
+					std::lock_guard<std::mutex> lock(_wakeMutex);
+					_stop = true;
+				}
+				_wake.notify_one();
+				_writer.join();
+				drain();
+				if (_fd != _options.fd) {
+#if defined(_WIN32)
+					_close(_fd);
+#else
+					::close(_fd);
+#endif
+				}
+			}
+
+			const Options& options() const { return _options; }
+
+			Ring* attach()
+			{
+				std::lock_guard<std::mutex> lock(_ringsMutex);
+				_rings.push_back(std::make_unique<Ring>(_options.ringBytes));
+				return _rings.back().get();
+			}
+
+			void nudge() { _wake.notify_one(); }
+
+//  Formats and writes everything logged so far; frees the rings of
+//  threads that have exited.
+			void drain()
+			{
+				std::lock_guard<std::mutex> drainLock(_drainMutex);
+				std::lock_guard<std::mutex> ringsLock(_ringsMutex);
+				for (auto& ring : _rings)
+					ring->drain(_batch, _start, _options.timestamps);
+				_batch.flush();
+				_rings.erase(std::remove_if(_rings.begin(), _rings.end(), [](const std::unique_ptr<Ring>& ring) {
+					return ring->closed.load(std::memory_order_acquire) &&
+						ring->head.load(std::memory_order_relaxed) == ring->tail.load(std::memory_order_acquire);
+				}), _rings.end());
+			}
+
+//  The crash path: no waiting on locks another thread may hold
+//  forever, its own output buffer.
+			void drainOnCrash()
+			{
+				static Batch crashBatch;
+				crashBatch.target(_fd);
+				const bool owned = _ringsMutex.try_lock();
+				for (auto& ring : _rings)
+					ring->drain(crashBatch, _start, _options.timestamps);
+				crashBatch.flush();
+				if (owned)
+					_ringsMutex.unlock();
+			}
+		};
+
+		inline Options& pendingOptions()
+		{
+			static Options options;
+			return options;
+		}
+
+		inline Logger& logger()
+		{
+			static Logger instance(pendingOptions());
+			return instance;
+		}
+
+		struct ThreadRing
+		{
+			Ring* ring = nullptr;
+
+			~ThreadRing()
+			{
+				if (ring)
+					ring->closed.store(true, std::memory_order_release);
+			}
+		};
+
+		inline Ring& threadRing()
+		{
+			thread_local ThreadRing local;
+			if (local.ring == nullptr)
+				local.ring = logger().attach();
+			return *local.ring;
+		}
+
+		template <typename T>
+		using Stored = std::conditional_t<std::is_array<std::remove_reference_t<T>>::value, const char*, std::decay_t<T>>;
+	}
+
+//  Options for the logger; takes effect only before the first print.
+	inline void configure(Options options) { detail::pendingOptions() = std::move(options); }
+
+//  Queues one line. format must be a string literal: only its address is kept.
+	template <size_t N, typename... Args>
+	void print(const char (&format)[N], const Args&... args)
+	{
+		using namespace detail;
+		Ring& ring = threadRing();
+		const size_t bytes = align8(sizeof(Record) + (size_t(0) + ... + Codec<Stored<Args>>::size(args)));
+		const Options& options = logger().options();
+		if (bytes > ring.capacity / 2) {
+			ring.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		size_t at;
+		unsigned char* p = ring.reserve(bytes, at);
+		while (p == nullptr) {
+			if (options.overflow == Overflow::Drop) {
+				ring.dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			logger().nudge();
+			std::this_thread::yield();
+			p = ring.reserve(bytes, at);
+		}
+
+		const Record record{ static_cast<uint32_t>(bytes), 0, &formatRecord<Stored<Args>...>, format, options.timestamps ? now() : 0 };
+		std::memcpy(p, &record, sizeof record);
+		[[maybe_unused]] unsigned char* q = p + sizeof record;
+		((q = Codec<Stored<Args>>::encode(q, args)), ...);
+		ring.publish(at, bytes);
+
+		if (ring.used() > ring.capacity / 2 && !ring.nudged.exchange(true, std::memory_order_relaxed))
+			logger().nudge();
+	}
+
+//  Writes everything printed so far, by any thread, before returning.
+	inline void flush() { detail::logger().drain(); }
+
+//  Drains the rings from a fatal signal handler or std::terminate, then lets
+//  the default action run.
+	inline void flushOnCrash() { detail::logger().drainOnCrash(); }
+
+	namespace detail {
+		inline void onFatalSignal(int signal)
+		{
+			flushOnCrash();
+			std::signal(signal, SIG_DFL);
+			std::raise(signal);
+		}
+
+		inline std::terminate_handler& previousTerminate()
+		{
+			static std::terminate_handler handler = nullptr;
+			return handler;
+		}
+	}
+
+	inline void installCrashHandler()
+	{
+		detail::logger();
+		for (int signal : { SIGSEGV, SIGABRT, SIGFPE, SIGILL })
+			std::signal(signal, detail::onFatalSignal);
+#if defined(SIGBUS)
+		std::signal(SIGBUS, detail::onFatalSignal);
+#endif
+		detail::previousTerminate() = std::set_terminate([] {
+			flushOnCrash();
+			if (detail::previousTerminate())
+				detail::previousTerminate()();
+			std::abort();
+		});
+	}
+}
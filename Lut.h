@@ -0,0 +1,134 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "Complex.h"
+
+//==============================================================
+//	Compile-time lookup tables
+//==============================================================
+//	make_lut<N>(f) evaluates f(0) ... f(N - 1) in a constant expression and
+//	returns the results as a std::array. Tables declared inline constexpr are
+//	emitted into read-only data, so startup does no work and a lookup is a
+//	single load. scripts/check-rodata.sh verifies the placement.
+
+namespace Lut {
+
+	template <size_t N, typename F>
+	constexpr auto make_lut(F f) -> std::array<decltype(f(size_t{})), N>
+	{
+		std::array<decltype(f(size_t{})), N> table{};
+		for (size_t i = 0; i < N; ++i)
+			table[i] = f(i);
+		return table;
+	}
+
+//  constexpr trigonometry (std::sin/std::cos are not constant expressions).
+	constexpr double pi = 3.14159265358979323846;
+
+	namespace detail {
+	//  Taylor series in Horner form, accurate to double precision on [-pi/4, pi/4].
+		constexpr double sinSeries(double x)
+		{
+			double r = 1;
+			for (int k = 10; k >= 1; --k)
+				r = 1 - x * x / ((2 * k) * (2 * k + 1)) * r;
+			return x * r;
+		}
+
+		constexpr double cosSeries(double x)
+		{
+			double r = 1;
+			for (int k = 10; k >= 1; --k)
+				r = 1 - x * x / ((2 * k - 1) * (2 * k)) * r;
+			return r;
+		}
+
+	//  sin(x + quadrant * pi / 2), reduced to the nearest multiple of pi / 2.
+		constexpr double sinQuadrant(double x, long long quadrant)
+		{
+			const double turns = x / (pi / 2);
+			const long long q = static_cast<long long>(turns + (turns < 0 ? -0.5 : 0.5));
+			const double r = x - static_cast<double>(q) * (pi / 2);
+			switch ((q + quadrant) & 3) {
+			case 0: return sinSeries(r);
+			case 1: return cosSeries(r);
+			case 2: return -sinSeries(r);
+			default: return -cosSeries(r);
+			}
+		}
+	}
+
+	constexpr double sin(double x) { return detail::sinQuadrant(x, 0); }
+	constexpr double cos(double x) { return detail::sinQuadrant(x, 1); }
+
+	constexpr uint8_t popcount(size_t v)
+	{
+		uint8_t n = 0;
+		for (; v; v &= v - 1)
+			++n;
+		return n;
+	}
+
+//  Reflected CRC-32 table entry for the given polynomial.
+	constexpr uint32_t crcEntry(uint32_t polynomial, size_t i)
+	{
+		uint32_t c = static_cast<uint32_t>(i);
+		for (int k = 0; k < 8; ++k)
+			c = (c & 1) ? (c >> 1) ^ polynomial : c >> 1;
+		return c;
+	}
+
+	inline constexpr auto squares = make_lut<256>([](size_t i) { return static_cast<int>(i * i); });
+	inline constexpr auto popcount8 = make_lut<256>([](size_t i) { return popcount(i); });
+	inline constexpr auto crc32Table = make_lut<256>([](size_t i) { return crcEntry(0xEDB88320u, i); });
+	inline constexpr auto crc32cTable = make_lut<256>([](size_t i) { return crcEntry(0x82F63B78u, i); });
+
+//  ceil(2^32 / d): for x < 2^16 and d < 1024, x / d == (x * reciprocal16[d]) >> 32.
+	inline constexpr auto reciprocal16 = make_lut<1024>([](size_t d) {
+		return d == 0 ? uint64_t{ 0 } : ((uint64_t{ 1 } << 32) + d - 1) / d;
+	});
+
+//  sin(2 pi i / 1024), one full turn.
+	inline constexpr auto sine1024 = make_lut<1024>([](size_t i) { return sin(2 * pi * static_cast<double>(i) / 1024); });
+
+//  FFT twiddle factors exp(-2 pi i k / N) for k < N / 2.
+	template <size_t N>
+	inline constexpr auto twiddles = make_lut<N / 2>([](size_t k) {
+		const double angle = -2 * pi * static_cast<double>(k) / static_cast<double>(N);
+		return Complex(cos(angle), sin(angle));
+	});
+
+	inline uint32_t popcount32(uint32_t v)
+	{
+		return popcount8[v & 0xff] + popcount8[(v >> 8) & 0xff] + popcount8[(v >> 16) & 0xff] + popcount8[v >> 24];
+	}
+
+	inline uint32_t divide16(uint32_t x, uint32_t d)
+	{
+		return static_cast<uint32_t>((x * reciprocal16[d]) >> 32);
+	}
+
+	namespace detail {
+		inline uint32_t crc(const std::array<uint32_t, 256>& table, uint32_t crc, const void* data, size_t size)
+		{
+			const unsigned char* p = static_cast<const unsigned char*>(data);
+			crc = ~crc;
+			for (size_t i = 0; i < size; ++i)
+				crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+			return ~crc;
+		}
+	}
+
+//  Pass the previous result as crc to checksum data in pieces.
+	inline uint32_t crc32(const void* data, size_t size, uint32_t crc = 0) { return detail::crc(crc32Table, crc, data, size); }
+	inline uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0) { return detail::crc(crc32cTable, crc, data, size); }
+
+	static_assert(squares[255] == 255 * 255, "squares");
+	static_assert(popcount8[0] == 0 && popcount8[0xa5] == 4 && popcount8[0xff] == 8, "popcount");
+	static_assert(crc32Table[1] == 0x77073096 && crc32Table[255] == 0x2D02EF8D, "CRC-32 (IEEE) table");
+	static_assert(crc32cTable[1] == 0xF26B8303 && crc32cTable[255] == 0xAD7D5351, "CRC-32C (Castagnoli) table");
+	static_assert(reciprocal16[3] == 1431655766 && reciprocal16[1] == (uint64_t{ 1 } << 32), "reciprocals");
+	static_assert(sine1024[0] == 0.0 && sine1024[256] == 1.0 && sine1024[768] == -1.0, "sin at quarter turns");
+	static_assert(twiddles<8>[0].real() == 1.0 && twiddles<8>[2].real() == 0.0 && twiddles<8>[2].imag() == -1.0, "exp(-i pi / 2)");
+}
@@ -0,0 +1,472 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ToChars.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//==============================================================
+//	Runtime metrics: sharded counters, gauges and histograms
+//==============================================================
+//	One std::atomic<uint64_t> bumped from every thread (see the memory
+//	model section of C++11LibraryFeatures.cpp) bounces its cache line
+//	between cores on each increment, and throughput falls as threads are
+//	added. Here every metric is split into cache-line-sized slots; each
+//	thread is given a slot on first use and increments only that one, so
+//	the line stays in its core's cache. Reads add up the slots:
+//
+//	  Metrics::Counter& served = Metrics::counter("requests_total", "Requests served");
+//	  Metrics::Histogram& latency = Metrics::histogram("request_ns", "Request latency");
+//	  served.add();
+//	  latency.record(elapsedNs);                        // or a ScopedTimer
+//	  Metrics::Registry::instance().writeFile("/var/lib/node_exporter/app.prom");
+//
+//	Histograms are HDR style: exact below 32, then 32 linear buckets per
+//	power of two, so any recorded value up to 2^44 is known within 1/32
+//	(3%). They are exported as Prometheus summaries (quantiles, _sum and
+//	_count) in the text exposition format; writeFile() replaces the file
+//	atomically for node_exporter's textfile collector, and Exporter does so
+//	periodically from a background thread.
+//
+//	Slots are per thread rather than per CPU: threads beyond the slot count
+//	share slots, which stays correct (slots are atomics) but contends.
+
+namespace Metrics {
+
+	namespace detail {
+
+		inline size_t shardCount()
+		{
+			static const size_t count = [] {
+				const size_t wanted = 2 * std::max(1u, std::thread::hardware_concurrency());
+				size_t n = 8;
+				while (n < wanted && n < 64)
+					n *= 2;
+				return n;
+			}();
+			return count;
+		}
+
+//  This thread's slot number, handed out round-robin on first use.
+		inline size_t threadIndex()
+		{
+			static std::atomic<size_t> next{ 0 };
+			thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed);
+			return index;
+		}
+
+		struct alignas(64) Slot
+		{
+			std::atomic<int64_t> value{ 0 };
+		};
+
+//  Index of the highest set bit of a non-zero value.
+		inline unsigned highestBit(uint64_t value)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#elif defined(_MSC_VER) && defined(_M_X64)
+			unsigned long index;
+			_BitScanReverse64(&index, value);
+			return static_cast<unsigned>(index);
+#else
+			unsigned msb = 0;
+			while (value >>= 1)
+				++msb;
+			return msb;
+#endif
+		}
+
+		inline void appendNumber(std::string& out, int64_t value)
+		{
+			char text[Format::maxChars];
+			out.append(text, Format::toChars(text, value));
+		}
+
+		inline void appendNumber(std::string& out, uint64_t value)
+		{
+			char text[Format::maxChars];
+			out.append(text, Format::toChars(text, value));
+		}
+	}
+
+//  A monotonically increasing count.
+	class Counter
+	{
+		std::unique_ptr<detail::Slot[]> _slots;
+		size_t _mask;
+
+	public:
+		Counter() : _slots(new detail::Slot[detail::shardCount()]), _mask(detail::shardCount() - 1) {}
+
+		void add(uint64_t n = 1) { _slots[detail::threadIndex() & _mask].value.fetch_add(static_cast<int64_t>(n), std::memory_order_relaxed); }
+
+		uint64_t value() const
+		{
+			uint64_t total = 0;
+			for (size_t i = 0; i <= _mask; ++i)
+				total += static_cast<uint64_t>(_slots[i].value.load(std::memory_order_relaxed));
+			return total;
+		}
+	};
+
+//  A value that goes up and down: in-flight requests, queue depth. add()
+//  is sharded like Counter; set() is meant for a single writer, as adds
+//  racing with it may be lost.
+	class Gauge
+	{
+		std::unique_ptr<detail::Slot[]> _slots;
+		size_t _mask;
+		std::atomic<int64_t> _base{ 0 };
+
+		int64_t shards() const
+		{
+			int64_t total = 0;
+			for (size_t i = 0; i <= _mask; ++i)
+				total += _slots[i].value.load(std::memory_order_relaxed);
+			return total;
+		}
+
+	public:
+		Gauge() : _slots(new detail::Slot[detail::shardCount()]), _mask(detail::shardCount() - 1) {}
+
+		void add(int64_t n = 1) { _slots[detail::threadIndex() & _mask].value.fetch_add(n, std::memory_order_relaxed); }
+		void sub(int64_t n = 1) { add(-n); }
+		void set(int64_t value) { _base.store(value - shards(), std::memory_order_relaxed); }
+		int64_t value() const { return _base.load(std::memory_order_relaxed) + shards(); }
+	};
+
+//  Log-linear histogram of non-negative integers, typically nanoseconds.
+	class Histogram
+	{
+	public:
+		static constexpr unsigned subBits = 5;
+		static constexpr unsigned maxBits = 44;
+		static constexpr size_t bucketCount = size_t(maxBits - subBits + 1) << subBits;
+		static constexpr uint64_t maxValue = (uint64_t(1) << maxBits) - 1;
+
+//  Values at or above maxValue land in the last bucket.
+		static size_t bucketOf(uint64_t value)
+		{
+			value = std::min(value, maxValue);
+			if (value < (uint64_t(1) << subBits))
+				return static_cast<size_t>(value);
+			const unsigned shift = detail::highestBit(value) - subBits;
+			return (size_t(shift + 1) << subBits) + static_cast<size_t>((value >> shift) & ((uint64_t(1) << subBits) - 1));
+		}
+
+		static uint64_t lowestOf(size_t bucket)
+		{
+			const size_t group = bucket >> subBits;
+			const uint64_t sub = bucket & ((size_t(1) << subBits) - 1);
+			return group == 0 ? sub : ((uint64_t(1) << subBits) + sub) << (group - 1);
+		}
+
+		static uint64_t highestOf(size_t bucket) { return bucket + 1 < bucketCount ? lowestOf(bucket + 1) - 1 : maxValue; }
+
+//  Merged counts, for reading quantiles.
+		struct Snapshot
+		{
+			std::vector<uint64_t> buckets = std::vector<uint64_t>(bucketCount);
+			uint64_t count = 0;
+			uint64_t sum = 0;
+
+//  The highest value equivalent to the q-quantile's bucket; 0 when
+//  empty.
+			uint64_t quantile(double q) const
+			{
+				if (count == 0)
+					return 0;
+				const double rank = std::min(1.0, std::max(0.0, q)) * static_cast<double>(count);
+				const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(rank + 0.5));
+				uint64_t seen = 0;
+				for (size_t b = 0; b < bucketCount; ++b)
+					if ((seen += buckets[b]) >= target)
+						return highestOf(b);
+				return maxValue;
+			}
+
+			double mean() const { return count == 0 ? 0 : static_cast<double>(sum) / static_cast<double>(count); }
+		};
+
+	private:
+		struct alignas(64) Shard
+		{
+			std::atomic<uint64_t> sum{ 0 };
+			std::atomic<uint64_t> buckets[bucketCount] = {};
+		};
+
+		std::unique_ptr<Shard[]> _shards;
+		size_t _mask;
+
+	public:
+//  At most 16 shards of 10 KiB each.
+		Histogram() : _shards(new Shard[std::min<size_t>(16, detail::shardCount())]), _mask(std::min<size_t>(16, detail::shardCount()) - 1) {}
+
+		void record(uint64_t value)
+		{
+			Shard& shard = _shards[detail::threadIndex() & _mask];
+			shard.buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+			shard.sum.fetch_add(value, std::memory_order_relaxed);
+		}
+
+		Snapshot snapshot() const
+		{
+			Snapshot s;
+			for (size_t i = 0; i <= _mask; ++i) {
+				s.sum += _shards[i].sum.load(std::memory_order_relaxed);
+				for (size_t b = 0; b < bucketCount; ++b) {
+					const uint64_t n = _shards[i].buckets[b].load(std::memory_order_relaxed);
+					s.buckets[b] += n;
+					s.count += n;
+				}
+			}
+			return s;
+		}
+	};
+
+//  Records the nanoseconds between construction and destruction.
+	class ScopedTimer
+	{
+		Histogram& _histogram;
+		std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+
+	public:
+		explicit ScopedTimer(Histogram& histogram) : _histogram(histogram) {}
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+		~ScopedTimer()
+		{
+			const auto elapsed = std::chrono::steady_clock::now() - _start;
+			_histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+		}
+	};
+
+//  Named metrics and their Prometheus text. Names may carry labels,
+//  "requests_total{method=\"GET\"}"; series of one family share its HELP
+//  and TYPE lines, which come from the first series registered.
+	class Registry
+	{
+		enum class Kind { Counter, Gauge, Histogram };
+
+		struct Entry
+		{
+			std::string name;
+			std::string help;
+			Kind kind;
+			std::unique_ptr<Counter> counter;
+			std::unique_ptr<Gauge> gauge;
+			std::unique_ptr<Histogram> histogram;
+		};
+
+		mutable std::mutex _lock;
+		std::vector<std::unique_ptr<Entry>> _entries;
+
+		Entry& find(const std::string& name, const std::string& help, Kind kind)
+		{
+			for (const auto& entry : _entries)
+				if (entry->name == name) {
+					if (entry->kind != kind)
+						throw std::invalid_argument("Metrics: " + name + " is registered as another kind");
+					return *entry;
+				}
+			_entries.push_back(std::unique_ptr<Entry>(new Entry{ name, help, kind, nullptr, nullptr, nullptr }));
+			return *_entries.back();
+		}
+
+		static std::string familyOf(const std::string& name) { return name.substr(0, name.find('{')); }
+
+//  name with one more label, quantile="0.99", or with a suffix on the
+//  family, request_ns_sum{route="/"}.
+		static std::string withLabel(const std::string& name, const std::string& label)
+		{
+			const size_t brace = name.find('{');
+			if (brace == std::string::npos)
+				return name + "{" + label + "}";
+			return name.substr(0, name.size() - 1) + "," + label + "}";
+		}
+
+		static std::string withSuffix(const std::string& name, const char* suffix)
+		{
+			const size_t brace = name.find('{');
+			return brace == std::string::npos ? name + suffix : name.substr(0, brace) + suffix + name.substr(brace);
+		}
+
+	public:
+		Registry() = default;
+		Registry(const Registry&) = delete;
+		Registry& operator=(const Registry&) = delete;
+
+		static Registry& instance()
+		{
+			static Registry registry;
+			return registry;
+		}
+
+//  The metric called name, created on first use. The references stay
+//  valid for the registry's lifetime; look them up once, outside hot
+//  loops.
+		Counter& counter(const std::string& name, const std::string& help = "")
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			Entry& entry = find(name, help, Kind::Counter);
+			if (!entry.counter)
+				entry.counter.reset(new Counter);
+			return *entry.counter;
+		}
+
+		Gauge& gauge(const std::string& name, const std::string& help = "")
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			Entry& entry = find(name, help, Kind::Gauge);
+			if (!entry.gauge)
+				entry.gauge.reset(new Gauge);
+			return *entry.gauge;
+		}
+
+		Histogram& histogram(const std::string& name, const std::string& help = "")
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			Entry& entry = find(name, help, Kind::Histogram);
+			if (!entry.histogram)
+				entry.histogram.reset(new Histogram);
+			return *entry.histogram;
+		}
+
+//  Prometheus text exposition format, version 0.0.4.
+		std::string text() const
+		{
+			static const char* const types[] = { "counter", "gauge", "summary" };
+			static const struct { const char* label; double q; } quantiles[] = {
+				{ "quantile=\"0.5\"", 0.5 }, { "quantile=\"0.9\"", 0.9 }, { "quantile=\"0.99\"", 0.99 }, { "quantile=\"0.999\"", 0.999 }
+			};
+
+			std::lock_guard<std::mutex> guard(_lock);
+			std::string out;
+			std::vector<std::string> families;
+			for (const auto& entry : _entries) {
+				const std::string family = familyOf(entry->name);
+				if (std::find(families.begin(), families.end(), family) == families.end()) {
+					families.push_back(family);
+					if (!entry->help.empty())
+						out += "# HELP " + family + " " + entry->help + "\n";
+					out += "# TYPE " + family + " " + types[static_cast<int>(entry->kind)] + "\n";
+				}
+				switch (entry->kind) {
+				case Kind::Counter:
+					out += entry->name + " ";
+					detail::appendNumber(out, entry->counter->value());
+					out += "\n";
+					break;
+				case Kind::Gauge:
+					out += entry->name + " ";
+					detail::appendNumber(out, entry->gauge->value());
+					out += "\n";
+					break;
+				case Kind::Histogram: {
+					const Histogram::Snapshot s = entry->histogram->snapshot();
+					for (const auto& q : quantiles) {
+						out += withLabel(entry->name, q.label) + " ";
+						detail::appendNumber(out, s.quantile(q.q));
+						out += "\n";
+					}
+					out += withSuffix(entry->name, "_sum") + " ";
+					detail::appendNumber(out, s.sum);
+					out += "\n" + withSuffix(entry->name, "_count") + " ";
+					detail::appendNumber(out, s.count);
+					out += "\n";
+					break;
+				}
+				}
+			}
+			return out;
+		}
+
+//  Writes path + ".tmp" and renames it over path, so scrapers never see
+//  a partial file. On POSIX rename replaces path atomically; on Windows
+//  path is removed first, so it is briefly missing.
+		void writeFile(const std::string& path) const
+		{
+			const std::string text = this->text();
+			const std::string temporary = path + ".tmp";
+			std::FILE* file = std::fopen(temporary.c_str(), "wb");
+			if (file == nullptr)
+				throw std::runtime_error("Metrics: cannot open " + temporary);
+			const bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+			if (std::fclose(file) != 0 || !written) {
+				std::remove(temporary.c_str());
+				throw std::runtime_error("Metrics: cannot write " + temporary);
+			}
+#if defined(_WIN32)
+			std::remove(path.c_str());  // rename does not replace on Windows
+#endif
+			if (std::rename(temporary.c_str(), path.c_str()) != 0)
+				throw std::runtime_error("Metrics: cannot rename " + temporary);
+		}
+	};
+
+	inline Counter& counter(const std::string& name, const std::string& help = "") { return Registry::instance().counter(name, help); }
+	inline Gauge& gauge(const std::string& name, const std::string& help = "") { return Registry::instance().gauge(name, help); }
+	inline Histogram& histogram(const std::string& name, const std::string& help = "") { return Registry::instance().histogram(name, help); }
+
+//  Rewrites a registry's file every interval from a background thread,
+//  and once more when destroyed. Write errors are retried next interval.
+	class Exporter
+	{
+		const Registry& _registry;
+		std::string _path;
+		std::chrono::milliseconds _interval;
+		std::mutex _lock;
+		std::condition_variable _wake;
+		bool _stopping = false;
+		std::thread _thread;
+
+		void write()
+		{
+			try {
+				_registry.writeFile(_path);
+			}
+			catch (const std::runtime_error&) {
+			}
+		}
+
+	public:
+		Exporter(const Registry& registry, std::string path, std::chrono::milliseconds interval = std::chrono::milliseconds(10000)) :
+			_registry(registry), _path(std::move(path)), _interval(interval)
+		{
+			_thread = std::thread([this] {
+				std::unique_lock<std::mutex> lock(_lock);
+				while (!_wake.wait_for(lock, _interval, [this] { return _stopping; }))
+					write();
+			});
+		}
+
+		Exporter(const Exporter&) = delete;
+		Exporter& operator=(const Exporter&) = delete;
+
+		~Exporter()
+		{
+			{
+				std::lock_guard<std::mutex> guard(_lock);
+				_stopping = true;
+			}
+			_wake.notify_one();
+			_thread.join();
+			write();
+		}
+	};
+}
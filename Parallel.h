@@ -0,0 +1,305 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+#include "ThreadPool.h"
+
+//==============================================================
+//	Parallel algorithms
+//==============================================================
+//	Data-parallel versions of std::sort, std::transform, std::for_each and
+//	std::inclusive_scan, plus an LSD radix sort for integer and floating-point
+//	keys. Work is split into a few chunks per thread and run on a ThreadPool;
+//	ranges shorter than serialCutoff, or a one-thread pool, take the serial
+//	std:: path. Iterators must be random access.
+
+namespace Parallel {
+
+	constexpr size_t serialCutoff = 1 << 15;
+
+	namespace detail {
+		inline size_t chunkCount(const ThreadPool& pool, size_t n, size_t minChunk)
+		{
+			return std::max<size_t>(1, std::min<size_t>(size_t{ pool.size() } * 4, n / minChunk));
+		}
+
+	//  Calls f(chunk, begin, end) for chunks equal slices of [0, n), in parallel.
+		template <typename F>
+		void forChunks(ThreadPool& pool, size_t n, size_t chunks, const F& f)
+		{
+			TaskGroup group(pool);
+			for (size_t c = 1; c < chunks; ++c)
+				group.run([&f, c, n, chunks] { f(c, n * c / chunks, n * (c + 1) / chunks); });
+
+			f(size_t{ 0 }, size_t{ 0 }, n / chunks);
+			group.wait();
+		}
+
+		inline bool runSerially(const ThreadPool& pool, size_t n)
+		{
+			return n < serialCutoff || pool.size() == 1;
+		}
+	}
+
+	template <typename It, typename F>
+	void forEach(It first, It last, F f, ThreadPool& pool = ThreadPool::instance())
+	{
+		const size_t n = static_cast<size_t>(last - first);
+		if (detail::runSerially(pool, n)) {
+			std::for_each(first, last, f);
+			return;
+		}
+
+		detail::forChunks(pool, n, detail::chunkCount(pool, n, serialCutoff / 4), [&](size_t, size_t b, size_t e) {
+			std::for_each(first + b, first + e, f);
+		});
+	}
+
+	template <typename It, typename Out, typename F>
+	Out transform(It first, It last, Out out, F op, ThreadPool& pool = ThreadPool::instance())
+	{
+		const size_t n = static_cast<size_t>(last - first);
+		if (detail::runSerially(pool, n))
+			return std::transform(first, last, out, op);
+
+		detail::forChunks(pool, n, detail::chunkCount(pool, n, serialCutoff / 4), [&](size_t, size_t b, size_t e) {
+			std::transform(first + b, first + e, out + b, op);
+		});
+		return out + n;
+	}
+
+//  op must be associative. Scans each chunk locally, then adds the carry of
+//  all earlier chunks in a second parallel pass.
+	template <typename It, typename Out, typename Op = std::plus<>>
+	Out inclusiveScan(It first, It last, Out out, Op op = Op(), ThreadPool& pool = ThreadPool::instance())
+	{
+		const size_t n = static_cast<size_t>(last - first);
+		if (detail::runSerially(pool, n))
+			return std::partial_sum(first, last, out, op);
+
+		using T = typename std::iterator_traits<Out>::value_type;
+		const size_t chunks = detail::chunkCount(pool, n, serialCutoff / 4);
+		std::vector<T> carry(chunks);
+
+		detail::forChunks(pool, n, chunks, [&](size_t c, size_t b, size_t e) {
+			std::partial_sum(first + b, first + e, out + b, op);
+			carry[c] = out[e - 1];
+		});
+
+		for (size_t c = 1; c < chunks; ++c)
+			carry[c] = op(carry[c - 1], carry[c]);
+
+		detail::forChunks(pool, n, chunks, [&](size_t c, size_t b, size_t e) {
+			if (c == 0)
+				return;
+			const T offset = carry[c - 1];
+			for (size_t i = b; i < e; ++i)
+				out[i] = op(offset, out[i]);
+		});
+		return out + n;
+	}
+
+	namespace detail {
+	//  Number of elements of a taken among the first k of merge(a, b); ties go
+	//  to a, as in std::merge.
+		template <typename It, typename Comp>
+		size_t coRank(size_t k, It a, size_t m, It b, size_t n, Comp& comp)
+		{
+			size_t lo = k > n ? k - n : 0;
+			size_t hi = std::min(k, m);
+			while (lo < hi) {
+				const size_t i = (lo + hi + 1) / 2;
+				const size_t j = k - i;
+				if (j == n || !comp(b[j], a[i - 1]))
+					lo = i;
+				else
+					hi = i - 1;
+			}
+			return lo;
+		}
+
+	//  Merge of sorted [a, a + m) and [b, b + n) into out, cut into independent
+	//  slices of the output. The cuts are co-ranked before any slice starts,
+	//  since merging moves elements out of a and b.
+		template <typename In, typename Out>
+		struct MergeJob
+		{
+			In     a;
+			size_t m;
+			In     b;
+			size_t n;
+			Out    out;
+			std::vector<size_t> cut; // output index of each slice boundary
+			std::vector<size_t> fromA; // elements of a before each boundary
+
+			template <typename Comp>
+			MergeJob(In a, size_t m, In b, size_t n, Out out, size_t pieces, Comp& comp) :
+				a(a), m(m), b(b), n(n), out(out), cut(pieces + 1), fromA(pieces + 1)
+			{
+				for (size_t p = 0; p <= pieces; ++p) {
+					cut[p] = (m + n) * p / pieces;
+					fromA[p] = coRank(cut[p], a, m, b, n, comp);
+				}
+			}
+
+			size_t pieces() const { return cut.size() - 1; }
+		};
+
+		template <typename In, typename Out, typename Comp>
+		void mergePiece(const MergeJob<In, Out>& job, size_t piece, Comp& comp)
+		{
+			const size_t k0 = job.cut[piece], k1 = job.cut[piece + 1];
+			const size_t i0 = job.fromA[piece], i1 = job.fromA[piece + 1];
+			std::merge(std::make_move_iterator(job.a + i0), std::make_move_iterator(job.a + i1),
+				std::make_move_iterator(job.b + (k0 - i0)), std::make_move_iterator(job.b + (k1 - i1)),
+				job.out + k0, comp);
+		}
+	}
+
+//  Parallel merge sort: sort chunks with std::sort, then merge pairs of runs.
+//  Every merge is itself split across tasks by co-ranking, so the last
+//  rounds stay parallel. Not stable; needs n extra elements of storage.
+	template <typename It, typename Comp = std::less<>>
+	void sort(It first, It last, Comp comp = Comp(), ThreadPool& pool = ThreadPool::instance())
+	{
+		using T = typename std::iterator_traits<It>::value_type;
+		const size_t n = static_cast<size_t>(last - first);
+		if (detail::runSerially(pool, n)) {
+			std::sort(first, last, comp);
+			return;
+		}
+
+		size_t runs = 1;
+		while (runs < pool.size() * 2 && n / (runs * 2) >= serialCutoff / 4)
+			runs *= 2;
+
+		detail::forChunks(pool, n, runs, [&](size_t, size_t b, size_t e) {
+			std::sort(first + b, first + e, comp);
+		});
+
+		std::unique_ptr<T[]> scratch(new T[n]);
+		T* buffer = scratch.get();
+		bool inBuffer = false;
+		const size_t pieces = size_t{ pool.size() } * 2;
+
+		auto mergeRound = [&](auto src, auto dst) {
+			using Job = detail::MergeJob<decltype(src), decltype(dst)>;
+			std::vector<Job> jobs;
+			jobs.reserve(runs / 2);
+			for (size_t r = 0; r < runs; r += 2) {
+				const size_t b = n * r / runs, mid = n * (r + 1) / runs, e = n * (r + 2) / runs;
+				jobs.emplace_back(src + b, mid - b, src + mid, e - mid, dst + b, std::max<size_t>(1, pieces * 2 / runs), comp);
+			}
+
+			TaskGroup group(pool);
+			for (const Job& job : jobs)
+				for (size_t p = 0; p < job.pieces(); ++p)
+					group.run([&job, &comp, p] { detail::mergePiece(job, p, comp); });
+			group.wait();
+		};
+
+		for (; runs > 1; runs /= 2, inBuffer = !inBuffer) {
+			if (inBuffer)
+				mergeRound(buffer, first);
+			else
+				mergeRound(first, buffer);
+		}
+
+		if (inBuffer)
+			transform(buffer, buffer + n, first, [](T& v) { return std::move(v); }, pool);
+	}
+
+	namespace detail {
+	//  Maps keys to unsigned integers whose order matches the key order.
+		template <typename T, typename Enable = void>
+		struct RadixKey;
+
+		template <typename T>
+		struct RadixKey<T, typename std::enable_if<std::is_integral<T>::value>::type>
+		{
+			using type = typename std::make_unsigned<T>::type;
+			static type get(T v)
+			{
+				type u = static_cast<type>(v);
+				if (std::is_signed<T>::value)
+					u ^= type(1) << (sizeof(T) * 8 - 1);
+				return u;
+			}
+		};
+
+		template <typename T>
+		struct RadixKey<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+		{
+			using type = typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type;
+			static type get(T v)
+			{
+				type u;
+				std::memcpy(&u, &v, sizeof u);
+				const type sign = type(1) << (sizeof(T) * 8 - 1);
+				return (u & sign) ? ~u : (u | sign);
+			}
+		};
+	}
+
+//  LSD radix sort, 8 bits per pass, for integer and floating-point values in
+//  contiguous storage. Each pass histograms chunks in parallel, computes every
+//  chunk's output offsets, then scatters in parallel; passes where every key
+//  has the same digit are skipped. Stable; NaNs sort by bit pattern.
+	template <typename T>
+	void radixSort(T* first, T* last, ThreadPool& pool = ThreadPool::instance())
+	{
+		static_assert(std::is_arithmetic<T>::value, "radixSort sorts integer or floating-point values");
+		using Key = detail::RadixKey<T>;
+
+		const size_t n = static_cast<size_t>(last - first);
+		if (n < 2)
+			return;
+
+		const size_t chunks = detail::runSerially(pool, n) ? 1 : detail::chunkCount(pool, n, serialCutoff / 4);
+		std::vector<std::array<size_t, 256>> counts(chunks);
+		std::unique_ptr<T[]> scratch(new T[n]);
+		T* src = first;
+		T* dst = scratch.get();
+
+		for (unsigned shift = 0; shift < sizeof(T) * 8; shift += 8) {
+			detail::forChunks(pool, n, chunks, [&](size_t c, size_t b, size_t e) {
+				auto& count = counts[c];
+				count.fill(0);
+				for (size_t i = b; i < e; ++i)
+					++count[(Key::get(src[i]) >> shift) & 0xff];
+			});
+
+		//  Turn counts into write offsets: digit-major, then chunk order.
+			size_t offset = 0;
+			bool trivial = false;
+			for (size_t d = 0; d < 256; ++d) {
+				const size_t start = offset;
+				for (size_t c = 0; c < chunks; ++c) {
+					const size_t count = counts[c][d];
+					counts[c][d] = offset;
+					offset += count;
+				}
+				trivial |= offset - start == n;
+			}
+			if (trivial)
+				continue;
+
+			detail::forChunks(pool, n, chunks, [&](size_t c, size_t b, size_t e) {
+				auto& next = counts[c];
+				for (size_t i = b; i < e; ++i)
+					dst[next[(Key::get(src[i]) >> shift) & 0xff]++] = src[i];
+			});
+			std::swap(src, dst);
+		}
+
+		if (src != first)
+			transform(src, src + n, first, [](T v) { return v; }, pool);
+	}
+}
@@ -0,0 +1,241 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include "Buffer.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//==============================================================
+//	Non-throwing, locale-free number parsing
+//==============================================================
+//	std::stoi is locale-dependent, throws on bad input and parses one value
+//	per call. Parse::fromChars follows the std::from_chars contract instead,
+//	consumes eight digits per step with SWAR arithmetic, and parseColumn
+//	decodes a whole delimited column into a Buffer<int64_t>.
+
+#if defined(__cpp_consteval)
+#define PARSE_CONSTEVAL consteval
+#else
+#define PARSE_CONSTEVAL constexpr
+#endif
+
+namespace Parse {
+
+	namespace detail {
+	//  Loads eight bytes as a little-endian word (x86, x64 and ARM64 targets).
+		inline uint64_t load8(const char* p)
+		{
+			uint64_t v;
+			std::memcpy(&v, p, 8);
+			return v;
+		}
+
+	//  One byte per character: 0x33 for an ASCII digit, something else otherwise.
+		inline uint64_t digitBytes(uint64_t v)
+		{
+			return (v & 0xF0F0F0F0F0F0F0F0) |
+				(((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4);
+		}
+
+		inline unsigned countTrailingZeros(uint64_t v)
+		{
+#if defined(_MSC_VER)
+			unsigned long i;
+			_BitScanForward64(&i, v);
+			return static_cast<unsigned>(i);
+#else
+			return static_cast<unsigned>(__builtin_ctzll(v));
+#endif
+		}
+
+	//  Combines eight ASCII digits pairwise: 8 x 1 -> 4 x 2 -> 2 x 4 -> 1 x 8.
+		inline uint32_t parseEightDigits(uint64_t v)
+		{
+			const uint64_t mask = 0x000000FF000000FF;
+			const uint64_t mul1 = 100 + (1000000ULL << 32);
+			const uint64_t mul2 = 1 + (10000ULL << 32);
+			v -= 0x3030303030303030;
+			v = (v * 10) + (v >> 8);
+			v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+			return static_cast<uint32_t>(v);
+		}
+
+		constexpr uint32_t pow10[9] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+
+		inline bool isDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+	//  Parses the digit run at p into value. Sets overflow if it does not fit in
+	//  64 bits; returns one past the last digit consumed.
+		inline const char* parseDigits(const char* p, const char* last, uint64_t& value, bool& overflow)
+		{
+			while (p != last && *p == '0')
+				++p;
+
+			uint64_t v = 0;
+			const char* start = p;
+
+		//  Up to 19 digits always fit. The first 16 go eight at a time; a word
+		//  holding the end of the number is left-padded with '0' and parsed whole.
+			while (last - p >= 8 && p - start <= 8) {
+				uint64_t word = load8(p);
+				const uint64_t nonDigits = digitBytes(word) ^ 0x3333333333333333;
+				if (nonDigits == 0) {
+					v = v * 100000000 + parseEightDigits(word);
+					p += 8;
+					continue;
+				}
+
+				const unsigned n = countTrailingZeros(nonDigits) / 8;
+				if (n > 0) {
+					word = (word << (8 - n) * 8) | (0x3030303030303030 >> n * 8);
+					v = v * pow10[n] + parseEightDigits(word);
+					p += n;
+				}
+				value = v;
+				overflow = false;
+				return p;
+			}
+			while (p != last && isDigit(*p) && p - start < 19) {
+				v = v * 10 + static_cast<unsigned>(*p - '0');
+				++p;
+			}
+
+			overflow = false;
+			if (p != last && isDigit(*p)) {
+				const unsigned digit = static_cast<unsigned>(*p - '0');
+				if (v > (UINT64_MAX - digit) / 10)
+					overflow = true;
+				else
+					v = v * 10 + digit;
+
+				for (++p; p != last && isDigit(*p); ++p)
+					overflow = true;
+			}
+
+			value = v;
+			return p;
+		}
+	}
+
+//  Integer parsing with the std::from_chars contract: no whitespace, no '+',
+//  a leading '-' only for signed types, value untouched on error.
+	template <typename T>
+	typename std::enable_if<std::is_integral<T>::value, std::from_chars_result>::type
+	fromChars(const char* first, const char* last, T& value)
+	{
+		const char* p = first;
+		const bool negative = std::is_signed<T>::value && p != last && *p == '-';
+		if (negative)
+			++p;
+
+		if (p == last || !detail::isDigit(*p))
+			return { first, std::errc::invalid_argument };
+
+		uint64_t magnitude;
+		bool overflow;
+		p = detail::parseDigits(p, last, magnitude, overflow);
+
+		using U = typename std::make_unsigned<T>::type;
+		const uint64_t limit = static_cast<uint64_t>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+		if (overflow || magnitude > limit)
+			return { p, std::errc::result_out_of_range };
+
+		value = negative ? static_cast<T>(U(0) - static_cast<U>(magnitude)) : static_cast<T>(magnitude);
+		return { p, std::errc() };
+	}
+
+//  Floating-point parsing. std::from_chars is locale-free and, in current
+//  libstdc++ and MSVC STL releases, uses the Eisel-Lemire fast path.
+	template <typename T>
+	typename std::enable_if<std::is_floating_point<T>::value, std::from_chars_result>::type
+	fromChars(const char* first, const char* last, T& value)
+	{
+#if defined(__cpp_lib_to_chars) || defined(_MSC_VER)
+		return std::from_chars(first, last, value);
+#else
+		char text[64];
+		const size_t n = std::min<size_t>(static_cast<size_t>(last - first), sizeof text - 1);
+		std::memcpy(text, first, n);
+		text[n] = '\0';
+
+		char* end;
+		const T parsed = static_cast<T>(std::strtod(text, &end));
+		if (end == text)
+			return { first, std::errc::invalid_argument };
+
+		value = parsed;
+		return { first + (end - text), std::errc() };
+#endif
+	}
+
+	struct ColumnResult
+	{
+		size_t      count; // values written to the output buffer
+		const char* ptr;   // where parsing stopped
+		std::errc   ec;    // errc() when the whole stream was consumed
+	};
+
+//  Parses a stream of integer fields separated by separator and/or line breaks
+//  ("\n" or "\r\n") into out, starting at index 0 and growing out as needed.
+	inline ColumnResult parseColumn(std::string_view stream, Buffer<int64_t>& out, char separator = ',')
+	{
+		const char* p = stream.data();
+		const char* last = p + stream.size();
+		size_t count = 0;
+
+		while (p != last) {
+			if (count == out.size())
+				out.resize(count < 16 ? 64 : count * 2);
+
+			const auto r = fromChars(p, last, out[count]);
+			if (r.ec != std::errc())
+				return { count, r.ptr, r.ec };
+
+			++count;
+			p = r.ptr;
+			if (p != last && (*p == separator || *p == '\r'))
+				++p;
+			if (p != last && *p == '\n' && separator != '\n')
+				++p;
+		}
+		return { count, p, std::errc() };
+	}
+
+//  Compile-time integer conversion for string user-defined literals.
+//  A malformed or out-of-range literal fails to compile under consteval.
+	constexpr int literalInt(const char* str, size_t len)
+	{
+		size_t i = 0;
+		const bool negative = len > 0 && str[0] == '-';
+		if (len > 0 && (str[0] == '-' || str[0] == '+'))
+			++i;
+		if (i == len)
+			throw std::invalid_argument("_int: no digits");
+
+		long long v = 0;
+		for (; i < len; ++i) {
+			if (str[i] < '0' || str[i] > '9')
+				throw std::invalid_argument("_int: not a number");
+
+			v = v * 10 + (str[i] - '0');
+			if (v > static_cast<long long>(std::numeric_limits<int>::max()) + 1)
+				throw std::out_of_range("_int: out of range");
+		}
+
+		if (negative)
+			v = -v;
+		if (v > std::numeric_limits<int>::max())
+			throw std::out_of_range("_int: out of range");
+		return static_cast<int>(v);
+	}
+}
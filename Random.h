@@ -0,0 +1,467 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include "Buffer.h"
+#include "ThreadPool.h"
+
+//==============================================================
+//	Fast random numbers in bulk
+//==============================================================
+//	std::mt19937 with std::uniform_real_distribution produces one value per
+//	call, through 2.5 KB of state that cannot be split between threads. Two
+//	small generators instead:
+//
+//	  Xoshiro256   xoshiro256**, 32 bytes of state; a UniformRandomBitGenerator
+//	               for the std:: distributions. jump() advances 2^128 values,
+//	               so stream(k) hands thread k a sequence no other thread meets.
+//	  Philox       Philox4x32-10, counter based: value i of a stream is a pure
+//	               function of (seed, stream, i), so any position is reached
+//	               in O(1) and any part of a stream can be generated anywhere.
+//
+//	fill() writes uniform, normal or exponential variates straight into a
+//	Buffer<float> or Buffer<double>, 64 at a time: the generator and the
+//	transforms (a branch-free log and sincos for Box-Muller) are plain loops
+//	the compiler vectorizes. With Philox, element i is always drawn from
+//	position i of the stream, so
+//
+//	  Random::fill(samples, Random::Normal{ 0, 1 }, Random::Philox(seed));
+//
+//	splits the buffer across ThreadPool::instance() and gives the same bits
+//	for any number of threads or chunk boundaries.
+//
+//	Uniforms have 52 (double) or 23 (float) random bits and lie in [a, b).
+//	Normal and exponential variates are computed in double precision.
+
+namespace Random {
+
+//  SplitMix64, for expanding one seed into generator state.
+	inline uint64_t splitmix64(uint64_t& state)
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	class Xoshiro256
+	{
+		uint64_t _s[4];
+
+		static constexpr uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+		void jump(const uint64_t (&polynomial)[4])
+		{
+			uint64_t s[4] = {};
+			for (uint64_t word : polynomial)
+				for (int b = 0; b < 64; ++b) {
+					if (word & (uint64_t(1) << b))
+						for (int k = 0; k < 4; ++k)
+							s[k] ^= _s[k];
+					(*this)();
+				}
+			std::memcpy(_s, s, sizeof s);
+		}
+
+	public:
+		using result_type = uint64_t;
+
+		explicit Xoshiro256(uint64_t seed = 0)
+		{
+			for (uint64_t& word : _s)
+				word = splitmix64(seed);
+		}
+
+		static constexpr result_type min() { return 0; }
+		static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+
+		uint64_t operator()()
+		{
+			const uint64_t result = rotl(_s[1] * 5, 7) * 9;
+			const uint64_t t = _s[1] << 17;
+			_s[2] ^= _s[0];
+			_s[3] ^= _s[1];
+			_s[1] ^= _s[2];
+			_s[0] ^= _s[3];
+			_s[2] ^= t;
+			_s[3] = rotl(_s[3], 45);
+			return result;
+		}
+
+//  Advances 2^128 values: 2^128 non-overlapping streams.
+		void jump() { jump({ 0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull, 0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull }); }
+
+//  Advances 2^192 values, for a second level of streams.
+		void longJump() { jump({ 0x76E15D3EFEFDCBBFull, 0xC5004E441C522FB3ull, 0x77710069854EE241ull, 0x39109BB02ACBE635ull }); }
+
+//  This generator jumped k times; stream(k) for thread k.
+		Xoshiro256 stream(unsigned k) const
+		{
+			Xoshiro256 copy = *this;
+			while (k-- > 0)
+				copy.jump();
+			return copy;
+		}
+
+		void generate(uint64_t* out, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+				out[i] = (*this)();
+		}
+
+		void discard(uint64_t n)
+		{
+			while (n-- > 0)
+				(*this)();
+		}
+
+		friend bool operator==(const Xoshiro256& a, const Xoshiro256& b) { return std::memcmp(a._s, b._s, sizeof a._s) == 0; }
+		friend bool operator!=(const Xoshiro256& a, const Xoshiro256& b) { return !(a == b); }
+	};
+
+	class Philox
+	{
+	public:
+		using Block = std::array<uint32_t, 4>;
+
+	private:
+		static constexpr uint32_t m0 = 0xD2511F53, m1 = 0xCD9E8D57;
+		static constexpr uint32_t w0 = 0x9E3779B9, w1 = 0xBB67AE85;
+
+		uint32_t _key[2];
+		uint32_t _stream[2];
+		uint64_t _block = 0;
+		Block _buffered = {};
+		unsigned _used = 4;
+
+	public:
+		using result_type = uint32_t;
+
+//  The 2^64 streams of a seed are independent; each is 2^66 values long.
+		explicit Philox(uint64_t seed = 0, uint64_t stream = 0) :
+			_key{ static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) },
+			_stream{ static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32) }
+		{
+		}
+
+		static constexpr result_type min() { return 0; }
+		static constexpr result_type max() { return std::numeric_limits<uint32_t>::max(); }
+
+//  Blocks first, first + 1, ... of the stream as four lanes x0..x3, for
+//  n <= 64 blocks. The rounds run across blocks, so they vectorize.
+		void blocks(uint64_t first, size_t n, uint32_t* x0, uint32_t* x1, uint32_t* x2, uint32_t* x3) const
+		{
+			for (size_t j = 0; j < n; ++j) {
+				x0[j] = static_cast<uint32_t>(first + j);
+				x1[j] = static_cast<uint32_t>((first + j) >> 32);
+				x2[j] = _stream[0];
+				x3[j] = _stream[1];
+			}
+			uint32_t k0 = _key[0], k1 = _key[1];
+			for (int round = 0; round < 10; ++round) {
+				for (size_t j = 0; j < n; ++j) {
+					const uint64_t p0 = uint64_t(m0) * x0[j];
+					const uint64_t p1 = uint64_t(m1) * x2[j];
+					const uint32_t y0 = static_cast<uint32_t>(p1 >> 32) ^ x1[j] ^ k0;
+					const uint32_t y2 = static_cast<uint32_t>(p0 >> 32) ^ x3[j] ^ k1;
+					x1[j] = static_cast<uint32_t>(p1);
+					x3[j] = static_cast<uint32_t>(p0);
+					x0[j] = y0;
+					x2[j] = y2;
+				}
+				k0 += w0;
+				k1 += w1;
+			}
+		}
+
+		Block block(uint64_t index) const
+		{
+			Block b;
+			blocks(index, 1, &b[0], &b[1], &b[2], &b[3]);
+			return b;
+		}
+
+//  One lane at a time, walking the stream from the current position.
+		uint32_t operator()()
+		{
+			if (_used == 4) {
+				_buffered = block(_block++);
+				_used = 0;
+			}
+			return _buffered[_used++];
+		}
+
+//  Jumps to 32-bit value position of the stream, in O(1).
+		void seek(uint64_t position)
+		{
+			_block = position / 4;
+			_used = 4;
+			if (position % 4 != 0) {
+				_buffered = block(_block++);
+				_used = static_cast<unsigned>(position % 4);
+			}
+		}
+
+		uint64_t position() const { return _block * 4 - (4 - _used); }
+		void discard(uint64_t n) { seek(position() + n); }
+	};
+
+//  Distributions for fill().
+	struct Uniform
+	{
+		double a = 0, b = 1;
+	};
+
+	struct Normal
+	{
+		double mean = 0, stddev = 1;
+	};
+
+	struct Exponential
+	{
+		double lambda = 1;
+	};
+
+	namespace detail {
+
+		constexpr size_t batch = 64;
+
+//  One generator word per element: 64 bits for double, 32 for float.
+		template <typename T>
+		using Word = std::conditional_t<sizeof(T) == 8, uint64_t, uint32_t>;
+
+		inline double bitsToDouble(uint64_t bits)
+		{
+			double d;
+			std::memcpy(&d, &bits, sizeof d);
+			return d;
+		}
+
+		inline uint64_t doubleToBits(double d)
+		{
+			uint64_t bits;
+			std::memcpy(&bits, &d, sizeof bits);
+			return bits;
+		}
+
+//  [0, 1) from the top mantissa bits: [1, 2) built by bits, minus 1.
+		inline double unit(uint64_t word) { return bitsToDouble(word >> 12 | 0x3FF0000000000000ull) - 1.0; }
+
+		inline float unit(uint32_t word)
+		{
+			const uint32_t bits = word >> 9 | 0x3F800000u;
+			float f;
+			std::memcpy(&f, &bits, sizeof f);
+			return f - 1.0f;
+		}
+
+//  log(x) for normal positive x, fdlibm's e_log.c kernel without the
+//  special cases and branches; the exponent becomes a double through
+//  the 2^52 bias trick, which needs no int64 conversion instruction.
+//  The sqrt(2) range split is integer arithmetic on the bits: GCC will
+//  not if-convert floating-point operations, which might trap, SSE2 has
+//  no 64-bit compare, and either stops vectorization.
+		inline double log(double x)
+		{
+			constexpr double ln2Hi = 6.93147180369123816490e-01, ln2Lo = 1.90821492927058770002e-10;
+			constexpr double lg1 = 6.666666666666735130e-01, lg2 = 3.999999999940941908e-01;
+			constexpr double lg3 = 2.857142874366239149e-01, lg4 = 2.222219843214978396e-01;
+			constexpr double lg5 = 1.818357216161805012e-01, lg6 = 1.531383769920937332e-01;
+			constexpr double lg7 = 1.479819860511658591e-01;
+
+			const uint64_t bits = doubleToBits(x);
+			const uint64_t mantissa = bits & 0x000FFFFFFFFFFFFFull;
+			const uint64_t high = (mantissa + (0x000FFFFFFFFFFFFFull - 0x6A09E667F3BCDull)) >> 52;  // above sqrt(2): halve
+			const double m = bitsToDouble(mantissa | (0x3FF0000000000000ull - (high << 52)));
+			const double k = bitsToDouble(((bits >> 52) + high) | 0x4330000000000000ull) - (4503599627370496.0 + 1023.0);
+
+			const double f = m - 1.0;
+			const double s = f / (2.0 + f);
+			const double z = s * s;
+			const double w = z * z;
+			const double r = w * (lg2 + w * (lg4 + w * lg6)) + z * (lg1 + w * (lg3 + w * (lg5 + w * lg7)));
+			const double hfsq = 0.5 * f * f;
+			return k * ln2Hi - ((hfsq - (s * (hfsq + r) + k * ln2Lo)) - f);
+		}
+
+//  sqrt(x) for x >= 0 by Newton steps on 1 / sqrt(x) from a bit-trick
+//  guess. std::sqrt may set errno, which keeps it out of vector loops
+//  unless the whole build uses -fno-math-errno.
+		inline double sqrt(double x)
+		{
+			double y = bitsToDouble(0x5FE6EB50C7B537A9ull - (doubleToBits(x) >> 1));
+			for (int step = 0; step < 4; ++step)
+				y *= 1.5 - 0.5 * x * y * y;
+			const double root = x * y;
+			return root + 0.5 * y * (x - root * root);
+		}
+
+//  sin and cos of 2 pi t for t in [-0.5, 0.5]. Reducing t by quarter
+//  turns is exact, leaving |y| <= pi / 4 for fdlibm's kernels.
+		inline void sincos2pi(double t, double& sine, double& cosine)
+		{
+			constexpr double s1 = -1.66666666666666324348e-01, s2 = 8.33333333332248946124e-03;
+			constexpr double s3 = -1.98412698298579493134e-04, s4 = 2.75573137070700676789e-06;
+			constexpr double s5 = -2.50507602534068634195e-08, s6 = 1.58969099521155010221e-10;
+			constexpr double c1 = 4.16666666666666019037e-02, c2 = -1.38888888888741095749e-03;
+			constexpr double c3 = 2.48015872894767294178e-05, c4 = -2.75573143513906633035e-07;
+			constexpr double c5 = 2.08757232129817482790e-09, c6 = -1.13596475577881948265e-11;
+			constexpr double round = 6755399441055744.0;  // 1.5 * 2^52
+
+			const double j = (4.0 * t + round) - round;
+			const double y = 6.283185307179586 * (t - 0.25 * j);
+			const double z = y * y;
+			const double sy = y + y * z * (s1 + z * (s2 + z * (s3 + z * (s4 + z * (s5 + z * s6)))));
+			const double cy = 1.0 - 0.5 * z + z * z * (c1 + z * (c2 + z * (c3 + z * (c4 + z * (c5 + z * c6)))));
+
+//  quarter turns j = -2..2
+			const bool odd = j == 1.0 || j == -1.0;
+			const double s = odd ? cy : sy;
+			const double c = odd ? sy : cy;
+			sine = s * ((j == 2.0 || j == -2.0 || j == -1.0) ? -1.0 : 1.0);
+			cosine = c * ((j == 2.0 || j == -2.0 || j == 1.0) ? -1.0 : 1.0);
+		}
+
+		template <typename T>
+		void transform(const Word<T>* words, T* out, const Uniform& d)
+		{
+			const T a = static_cast<T>(d.a), width = static_cast<T>(d.b - d.a);
+			for (size_t i = 0; i < batch; ++i)
+				out[i] = a + width * unit(words[i]);
+		}
+
+//  Box-Muller on pairs: element 2i from word 2i's radius and word 2i + 1's
+//  angle, element 2i + 1 the other coordinate.
+		template <typename T>
+		void transform(const Word<T>* words, T* out, const Normal& d)
+		{
+			for (size_t i = 0; i < batch; i += 2) {
+				const double u = static_cast<double>(unit(words[i]));
+				const double v = static_cast<double>(unit(words[i + 1]));
+				const double radius = detail::sqrt(-2.0 * log(1.0 - u));
+				double sine, cosine;
+				sincos2pi(v - 0.5, sine, cosine);
+				out[i] = static_cast<T>(d.mean + d.stddev * radius * cosine);
+				out[i + 1] = static_cast<T>(d.mean + d.stddev * radius * sine);
+			}
+		}
+
+		template <typename T>
+		void transform(const Word<T>* words, T* out, const Exponential& d)
+		{
+			const double scale = -1.0 / d.lambda;
+			for (size_t i = 0; i < batch; ++i)
+				out[i] = static_cast<T>(scale * log(1.0 - static_cast<double>(unit(words[i]))));
+		}
+
+//  Words first .. first + batch - 1 of a Philox stream (first a multiple
+//  of batch): block b holds words 2b, 2b + 1 as (x1:x0, x3:x2), or the
+//  four lanes of words 4b .. 4b + 3.
+		inline void words(const Philox& rng, uint64_t first, uint64_t* out)
+		{
+			uint32_t x[4][batch / 2];
+			rng.blocks(first / 2, batch / 2, x[0], x[1], x[2], x[3]);
+			for (size_t j = 0; j < batch / 2; ++j) {
+				out[2 * j] = uint64_t(x[1][j]) << 32 | x[0][j];
+				out[2 * j + 1] = uint64_t(x[3][j]) << 32 | x[2][j];
+			}
+		}
+
+		inline void words(const Philox& rng, uint64_t first, uint32_t* out)
+		{
+			uint32_t x[4][batch / 4];
+			rng.blocks(first / 4, batch / 4, x[0], x[1], x[2], x[3]);
+			for (size_t j = 0; j < batch / 4; ++j)
+				for (int lane = 0; lane < 4; ++lane)
+					out[4 * j + static_cast<size_t>(lane)] = x[lane][j];
+		}
+
+//  From Xoshiro256 the stream is consumed in order; a float takes half a
+//  word, low half first.
+		inline void words(Xoshiro256& rng, size_t count, uint64_t* out) { rng.generate(out, count); }
+
+		inline void words(Xoshiro256& rng, size_t count, uint32_t* out)
+		{
+			uint64_t wide[batch / 2];
+			rng.generate(wide, (count + 1) / 2);
+			for (size_t j = 0; j < (count + 1) / 2; ++j) {
+				out[2 * j] = static_cast<uint32_t>(wide[j]);
+				out[2 * j + 1] = static_cast<uint32_t>(wide[j] >> 32);
+			}
+		}
+	}
+
+//  Elements [first, first + n) of the Philox stream's variates into out.
+	template <typename T, typename D>
+	void fill(T* out, size_t n, const D& distribution, const Philox& rng, uint64_t first = 0)
+	{
+		static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value, "fill: float or double");
+		using namespace detail;
+		Word<T> words[batch];
+		T values[batch];
+		uint64_t index = first - first % batch;
+		for (size_t done = 0; done < n; index += batch) {
+			detail::words(rng, index, words);
+			const size_t skip = done == 0 ? static_cast<size_t>(first - index) : 0;
+			const size_t count = std::min(batch - skip, n - done);
+			if (skip == 0 && count == batch)
+				transform(words, out + done, distribution);
+			else {
+				transform(words, values, distribution);
+				std::copy(values + skip, values + skip + count, out + done);
+			}
+			done += count;
+		}
+	}
+
+//  The whole buffer, split across the pool. Element i is position i of the
+//  stream whatever the split, so results do not depend on the thread count.
+	template <typename T, typename D>
+	void fill(Buffer<T>& out, const D& distribution, const Philox& rng, ThreadPool& pool = ThreadPool::instance())
+	{
+		const size_t n = out.size();
+		const size_t chunks = std::max<size_t>(1, std::min<size_t>(size_t{ pool.size() } * 4, n / (1 << 14)));
+		if (chunks == 1) {
+			fill(out.data(), n, distribution, rng);
+			return;
+		}
+		auto chunk = [&out, &distribution, &rng, n, chunks](size_t c) {
+			const size_t begin = n * c / chunks / detail::batch * detail::batch;
+			const size_t end = c + 1 == chunks ? n : n * (c + 1) / chunks / detail::batch * detail::batch;
+			fill(out.data() + begin, end - begin, distribution, rng, begin);
+		};
+		TaskGroup group(pool);
+		for (size_t c = 1; c < chunks; ++c)
+			group.run([&chunk, c] { chunk(c); });
+		chunk(0);
+		group.wait();
+	}
+
+//  The next n variates of a single Xoshiro256 stream.
+	template <typename T, typename D>
+	void fill(T* out, size_t n, const D& distribution, Xoshiro256& rng)
+	{
+		static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value, "fill: float or double");
+		using namespace detail;
+		Word<T> words[batch] = {};
+		T values[batch];
+		for (size_t done = 0; done < n; done += batch) {
+			const size_t count = std::min(batch, n - done);
+			detail::words(rng, count + count % 2, words);
+			if (count == batch)
+				transform(words, out + done, distribution);
+			else {
+				transform(words, values, distribution);
+				std::copy(values, values + count, out + done);
+			}
+		}
+	}
+
+	template <typename T, typename D>
+	void fill(Buffer<T>& out, const D& distribution, Xoshiro256& rng) { fill(out.data(), out.size(), distribution, rng); }
+}
@@ -0,0 +1,278 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//==============================================================
+//	Read-copy-update: hot-swappable versions for wait-free readers
+//==============================================================
+//	Inline namespaces (Program::Version1 / Version2 in C++11Features.cpp)
+//	choose a version when compiling. An Rcu::Cell holds the version in use
+//	while running, and swaps it without stopping the threads that read it:
+//
+//	  Rcu::Cell<Config> config(loadConfig());
+//	  // readers, on any thread:
+//	  int limit = config.read([](const Config& c) { return c.limit; });
+//	  // a writer:
+//	  config.publish(loadConfig());                       // or update([](Config& c) { ... })
+//
+//	A reader announces the epoch it entered at, loads the pointer and uses
+//	the object; it never loops, locks or writes shared reference counts, so
+//	reads are wait-free and readers do not contend with one another. A
+//	writer swaps the pointer and retires the old object with the epoch of
+//	the swap. Retired objects are deleted once no reader is inside a read
+//	section entered at or before that epoch; such a reader is the only one
+//	that can still be holding them.
+//
+//	std::atomic<std::shared_ptr> gives the same guarantee, but each load
+//	bumps the shared reference count, one cache line for all readers, and
+//	libstdc++ guards it with a spin lock. A std::shared_mutex makes readers
+//	write its reader count, and a writer waits for all of them.
+//
+//	A pointer read from a Cell is valid only inside the ReadGuard it was
+//	read under; copy what outlives it. synchronize() must not be called
+//	inside a read section, which would wait for itself.
+
+namespace Rcu {
+
+	namespace detail {
+
+//  One per thread that has read; reused after the thread exits.
+		struct alignas(64) Reader
+		{
+			std::atomic<uint64_t> epoch{ 0 };  // epoch entered at, 0 outside read sections
+			std::atomic<bool> inUse{ false };
+			unsigned depth = 0;                // nested ReadGuards, owner thread only
+			Reader* next = nullptr;
+		};
+
+		struct Retired
+		{
+			uint64_t epoch;
+			void* object;
+			void (*destroy)(void*);
+		};
+
+		class Domain
+		{
+			std::atomic<uint64_t> _epoch{ 1 };
+			std::atomic<Reader*> _readers{ nullptr };
+			std::mutex _mutex;
+			std::vector<Retired> _retired;
+
+			Reader& acquire()
+			{
+				for (Reader* reader = _readers.load(std::memory_order_acquire); reader != nullptr; reader = reader->next) {
+					bool expected = false;
+					if (!reader->inUse.load(std::memory_order_relaxed) && reader->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+						return *reader;
+				}
+				Reader* reader = new Reader;
+				reader->inUse.store(true, std::memory_order_relaxed);
+				reader->next = _readers.load(std::memory_order_relaxed);
+				while (!_readers.compare_exchange_weak(reader->next, reader, std::memory_order_release, std::memory_order_relaxed))
+					;
+				return *reader;
+			}
+
+//  The lowest epoch a reader is inside a section at, or the maximum.
+			uint64_t oldestReader() const
+			{
+				uint64_t oldest = std::numeric_limits<uint64_t>::max();
+				for (const Reader* reader = _readers.load(std::memory_order_acquire); reader != nullptr; reader = reader->next) {
+					const uint64_t epoch = reader->epoch.load(std::memory_order_seq_cst);
+					if (epoch != 0 && epoch < oldest)
+						oldest = epoch;
+				}
+				return oldest;
+			}
+
+		public:
+			Domain() = default;
+			Domain(const Domain&) = delete;
+			Domain& operator=(const Domain&) = delete;
+
+//  At exit no reader is left; Reader records are not freed, since a
+//  thread still running may release its own afterwards.
+			~Domain()
+			{
+				for (const Retired& retired : _retired)
+					retired.destroy(retired.object);
+			}
+
+			static Domain& instance()
+			{
+				static Domain domain;
+				return domain;
+			}
+
+//  This thread's record, taken on first use and given back at thread exit.
+			Reader& reader()
+			{
+				thread_local Reader* reader = nullptr;
+				if (reader == nullptr) {
+					struct Release
+					{
+						Reader* reader;
+						~Release() { reader->inUse.store(false, std::memory_order_release); }
+					};
+					thread_local const Release release{ &acquire() };
+					reader = release.reader;
+				}
+				return *reader;
+			}
+
+//  The store is seq_cst so the pointer load after it cannot be reordered
+//  before it: either a writer scanning readers sees this epoch, or this
+//  reader sees the writer's new pointer.
+			void enter(Reader& reader)
+			{
+				if (reader.depth++ == 0)
+					reader.epoch.store(_epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+			}
+
+			void exit(Reader& reader)
+			{
+				if (--reader.depth == 0)
+					reader.epoch.store(0, std::memory_order_release);
+			}
+
+//  Hands over an object that is no longer reachable for new readers.
+			void retire(void* object, void (*destroy)(void*))
+			{
+				const uint64_t epoch = _epoch.fetch_add(1, std::memory_order_seq_cst);
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					_retired.push_back({ epoch, object, destroy });
+				}
+				reclaim();
+			}
+
+//  Deletes the retired objects no reader can hold; returns how many are
+//  left waiting for a reader.
+			size_t reclaim()
+			{
+				std::vector<Retired> ready;
+				size_t left;
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					const uint64_t oldest = oldestReader();
+					auto keep = _retired.begin();
+					for (const Retired& retired : _retired)
+						if (retired.epoch < oldest)
+							ready.push_back(retired);
+						else
+							*keep++ = retired;
+					_retired.erase(keep, _retired.end());
+					left = _retired.size();
+				}
+				for (const Retired& retired : ready)
+					retired.destroy(retired.object);
+				return left;
+			}
+
+//  Waits until every read section entered before the call has ended, then
+//  deletes what was retired before it.
+			void synchronize()
+			{
+				if (reader().depth != 0)
+					throw std::logic_error("Rcu: synchronize() inside a read section");
+				const uint64_t epoch = _epoch.fetch_add(1, std::memory_order_seq_cst);
+				while (oldestReader() <= epoch)
+					std::this_thread::yield();
+				reclaim();
+			}
+		};
+	}
+
+//  A read section: objects read from a Cell while it lives stay allocated.
+//  Nests, and costs one store on entry and one on exit.
+	class ReadGuard
+	{
+		detail::Reader& _reader;
+
+	public:
+		ReadGuard() : _reader(detail::Domain::instance().reader()) { detail::Domain::instance().enter(_reader); }
+		~ReadGuard() { detail::Domain::instance().exit(_reader); }
+		ReadGuard(const ReadGuard&) = delete;
+		ReadGuard& operator=(const ReadGuard&) = delete;
+	};
+
+//  The current version of a T, replaced as a whole by publish().
+	template <typename T>
+	class Cell
+	{
+		std::atomic<T*> _current;
+		std::mutex _writer;
+
+		static void destroy(void* object) { delete static_cast<T*>(object); }
+
+	public:
+		using value_type = T;
+
+		explicit Cell(std::unique_ptr<T> initial) : _current(initial.release())
+		{
+			if (_current.load(std::memory_order_relaxed) == nullptr)
+				throw std::invalid_argument("Rcu: null initial version");
+			detail::Domain::instance();  // outlives this Cell if static
+		}
+		explicit Cell(T initial = T()) : Cell(std::make_unique<T>(std::move(initial))) {}
+		Cell(const Cell&) = delete;
+		Cell& operator=(const Cell&) = delete;
+
+//  Retired rather than deleted, in case a reader is still inside.
+		~Cell() { detail::Domain::instance().retire(_current.load(std::memory_order_relaxed), &destroy); }
+
+//  The current version, valid until guard ends.
+		const T& get(const ReadGuard& guard) const
+		{
+			static_cast<void>(guard);
+			return *_current.load(std::memory_order_seq_cst);
+		}
+
+//  f(current version) inside a read section of its own.
+		template <typename F>
+		decltype(auto) read(F&& f) const
+		{
+			const ReadGuard guard;
+			return std::forward<F>(f)(get(guard));
+		}
+
+//  Makes next the version new readers see; the old one is deleted once
+//  the readers that may hold it are gone.
+		void publish(std::unique_ptr<T> next)
+		{
+			if (next == nullptr)
+				throw std::invalid_argument("Rcu: null version");
+			T* old = _current.exchange(next.release(), std::memory_order_seq_cst);
+			detail::Domain::instance().retire(old, &destroy);
+		}
+		void publish(T next) { publish(std::make_unique<T>(std::move(next))); }
+
+//  Copies the current version, applies f to the copy and publishes it.
+//  Updates are serialized with each other, so none is lost; reads go on
+//  meanwhile.
+		template <typename F>
+		void update(F&& f)
+		{
+			std::lock_guard<std::mutex> lock(_writer);
+			std::unique_ptr<T> next = read([](const T& current) { return std::make_unique<T>(current); });
+			std::forward<F>(f)(*next);
+			publish(std::move(next));
+		}
+	};
+
+//  Deletes what can be deleted now; returns how many retired versions
+//  still wait for a reader.
+	inline size_t reclaim() { return detail::Domain::instance().reclaim(); }
+
+//  Waits for the read sections in progress, then deletes every version
+//  retired before the call. Not inside a read section.
+	inline void synchronize() { detail::Domain::instance().synchronize(); }
+}
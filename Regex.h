@@ -0,0 +1,1055 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//==============================================================
+//	Regular expressions compiled to DFAs
+//==============================================================
+//	std::regex interprets a backtracking program, allocates while matching
+//	and takes microseconds to construct. Here a pattern becomes a Thompson
+//	NFA and then a DFA over byte classes, so matching costs one table lookup
+//	per input byte:
+//
+//	  static constexpr char timeout[] = "ERROR .*timed? ?out";
+//	  Regex::Compiled<timeout> re;           // DFA built by the compiler
+//	  Regex::Pattern filter(userPattern);    // DFA states built on demand
+//	  Regex::Match m;
+//	  if (Regex::search(line, m, re)) ... m.str, m.position
+//
+//	Compiled<P> runs the subset construction in constexpr and stores only
+//	the final table; patterns needing more than 256 DFA states fail to
+//	compile and belong in Pattern. Pattern adds DFA states the first time
+//	an input reaches them and starts over past 10000 states; it is not
+//	thread-safe, so give each thread its own copy.
+//
+//	When every match starts with the same literal, candidate positions come
+//	from a vector scan for its first and last bytes before the DFA runs.
+//
+//	Syntax: literals, ., [a-z] and [^...], \d \w \s \D \W \S, \t \n \r \f
+//	\v \xHH and escaped punctuation, (...) and (?:...) groups, |, * + ? and
+//	{m} {m,} {m,n} (lazy ? accepted), ^ at the start and $ at the end (of
+//	a pattern without a top-level |: ^(a|b) rather than ^a|b). No
+//	backreferences, lookaround or \b. Matches are leftmost-longest (POSIX)
+//	where ECMAScript std::regex is leftmost-first; whether a line matches
+//	is the same either way.
+
+namespace Regex {
+
+	struct Match
+	{
+		std::string_view str;
+		size_t position = 0;
+
+		size_t length() const { return str.size(); }
+	};
+
+	namespace detail {
+
+		struct ByteSet
+		{
+			uint64_t bits[4] = {};
+
+			constexpr void add(unsigned char c) { bits[c >> 6] |= uint64_t(1) << (c & 63); }
+			constexpr void addRange(unsigned char first, unsigned char last) { for (unsigned c = first; c <= last; ++c) add(static_cast<unsigned char>(c)); }
+			constexpr bool has(unsigned char c) const { return (bits[c >> 6] >> (c & 63)) & 1; }
+
+			constexpr void invert()
+			{
+				for (uint64_t& word : bits)
+					word = ~word;
+			}
+
+			constexpr void merge(const ByteSet& other)
+			{
+				for (int k = 0; k < 4; ++k)
+					bits[k] |= other.bits[k];
+			}
+
+			constexpr bool operator==(const ByteSet& other) const
+			{
+				return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2] && bits[3] == other.bits[3];
+			}
+
+//  the only byte in the set, or -1
+			constexpr int single() const
+			{
+				int found = -1;
+				for (unsigned c = 0; c < 256; ++c)
+					if (has(static_cast<unsigned char>(c))) {
+						if (found >= 0)
+							return -1;
+						found = static_cast<int>(c);
+					}
+				return found;
+			}
+		};
+
+		enum class Kind : uint8_t { Epsilon, Split, Set, Match };
+
+		constexpr uint16_t none = 0xFFFF;
+		constexpr size_t maxStates = 1024;
+		constexpr size_t maxSets = 256;
+		constexpr size_t maxPrefix = 32;
+
+		struct NfaState
+		{
+			Kind kind = Kind::Epsilon;
+			uint8_t set = 0;
+			uint16_t out1 = none;
+			uint16_t out2 = none;
+		};
+
+		struct Nfa
+		{
+			NfaState states[maxStates] = {};
+			ByteSet sets[maxSets] = {};
+			size_t count = 0;
+			size_t setCount = 0;
+			uint16_t start = 0;
+			uint16_t match = 0;
+			bool anchoredStart = false;
+			bool anchoredEnd = false;
+			char prefix[maxPrefix] = {};
+			size_t prefixLength = 0;
+		};
+
+//  Recursive descent over the pattern, building Thompson fragments: a
+//  start state and an Epsilon end state whose out1 is patched later.
+		class Parser
+		{
+			struct Frag
+			{
+				uint16_t start;
+				uint16_t end;
+			};
+
+			Nfa& _nfa;
+			const char* _p;
+			size_t _n;
+			size_t _depth = 0;          // open groups
+			bool _topLevelBar = false;  // a | outside every group
+
+			constexpr uint16_t add(Kind kind, uint16_t out1 = none, uint16_t out2 = none, uint8_t set = 0)
+			{
+				if (_nfa.count == maxStates)
+					throw std::length_error("Regex: pattern too large");
+				_nfa.states[_nfa.count] = NfaState{ kind, set, out1, out2 };
+				return static_cast<uint16_t>(_nfa.count++);
+			}
+
+			constexpr uint8_t addSet(const ByteSet& s)
+			{
+				for (size_t k = 0; k < _nfa.setCount; ++k)
+					if (_nfa.sets[k] == s)
+						return static_cast<uint8_t>(k);
+				if (_nfa.setCount == maxSets)
+					throw std::length_error("Regex: too many character classes");
+				_nfa.sets[_nfa.setCount] = s;
+				return static_cast<uint8_t>(_nfa.setCount++);
+			}
+
+			constexpr void patch(Frag f, uint16_t to) { _nfa.states[f.end].out1 = to; }
+
+			constexpr Frag empty()
+			{
+				const uint16_t e = add(Kind::Epsilon);
+				return { e, e };
+			}
+
+			constexpr Frag bytes(const ByteSet& s)
+			{
+				const uint16_t e = add(Kind::Epsilon);
+				return { add(Kind::Set, e, none, addSet(s)), e };
+			}
+
+			constexpr Frag concat(Frag a, Frag b)
+			{
+				patch(a, b.start);
+				return { a.start, b.end };
+			}
+
+			constexpr Frag alternate(Frag a, Frag b)
+			{
+				const uint16_t e = add(Kind::Epsilon);
+				patch(a, e);
+				patch(b, e);
+				return { add(Kind::Split, a.start, b.start), e };
+			}
+
+			constexpr Frag star(Frag a)
+			{
+				const uint16_t e = add(Kind::Epsilon);
+				const uint16_t s = add(Kind::Split, a.start, e);
+				patch(a, s);
+				return { s, e };
+			}
+
+			constexpr Frag plus(Frag a)
+			{
+				const uint16_t e = add(Kind::Epsilon);
+				const uint16_t s = add(Kind::Split, a.start, e);
+				patch(a, s);
+				return { a.start, e };
+			}
+
+			constexpr Frag optional(Frag a)
+			{
+				const uint16_t e = add(Kind::Epsilon);
+				patch(a, e);
+				return { add(Kind::Split, a.start, e), e };
+			}
+
+			constexpr bool more() const { return i < _n; }
+			constexpr char peek() const { return _p[i]; }
+
+			constexpr void expect(char c, const char* error)
+			{
+				if (!more() || _p[i] != c)
+					throw std::invalid_argument(error);
+				++i;
+			}
+
+			static constexpr int hex(char c)
+			{
+				return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+			}
+
+//  After a backslash: a class (\d), or a single byte returned in single.
+			constexpr ByteSet escape(int& single)
+			{
+				if (!more())
+					throw std::invalid_argument("Regex: trailing backslash");
+				const char c = _p[i++];
+				ByteSet s;
+				single = -1;
+				switch (c) {
+				case 'd': case 'D':
+					s.addRange('0', '9');
+					break;
+				case 'w': case 'W':
+					s.addRange('a', 'z');
+					s.addRange('A', 'Z');
+					s.addRange('0', '9');
+					s.add('_');
+					break;
+				case 's': case 'S':
+					for (char w : { ' ', '\t', '\n', '\r', '\f', '\v' })
+						s.add(static_cast<unsigned char>(w));
+					break;
+				case 't': single = '\t'; break;
+				case 'n': single = '\n'; break;
+				case 'r': single = '\r'; break;
+				case 'f': single = '\f'; break;
+				case 'v': single = '\v'; break;
+				case '0': single = 0; break;
+				case 'x': {
+					const int hi = i < _n ? hex(_p[i]) : -1;
+					const int lo = i + 1 < _n ? hex(_p[i + 1]) : -1;
+					if (hi < 0 || lo < 0)
+						throw std::invalid_argument("Regex: \\x needs two hex digits");
+					i += 2;
+					single = hi * 16 + lo;
+					break;
+				}
+				case 'b': case 'B':
+					throw std::invalid_argument("Regex: word boundaries are not supported");
+				default:
+					if ((c >= '1' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+						throw std::invalid_argument("Regex: unsupported escape");
+					single = static_cast<unsigned char>(c);
+				}
+				if (c == 'D' || c == 'W' || c == 'S')
+					s.invert();
+				if (single >= 0)
+					s.add(static_cast<unsigned char>(single));
+				return s;
+			}
+
+			constexpr ByteSet bracket()
+			{
+				ByteSet s;
+				const bool negate = more() && peek() == '^';
+				if (negate)
+					++i;
+				while (more() && peek() != ']') {
+					int low = -1;
+					ByteSet item;
+					if (peek() == '\\') {
+						++i;
+						item = escape(low);
+					}
+					else
+						low = static_cast<unsigned char>(_p[i++]);
+
+					if (low >= 0 && i + 1 < _n && peek() == '-' && _p[i + 1] != ']') {
+						++i;
+						int high = -1;
+						if (peek() == '\\') {
+							++i;
+							escape(high);
+							if (high < 0)
+								throw std::invalid_argument("Regex: class in a range");
+						}
+						else
+							high = static_cast<unsigned char>(_p[i++]);
+						if (high < low)
+							throw std::invalid_argument("Regex: range out of order");
+						s.addRange(static_cast<unsigned char>(low), static_cast<unsigned char>(high));
+					}
+					else if (low >= 0)
+						s.add(static_cast<unsigned char>(low));
+					else
+						s.merge(item);
+				}
+				expect(']', "Regex: missing ]");
+				if (negate)
+					s.invert();
+				return s;
+			}
+
+			constexpr Frag atom()
+			{
+				const char c = _p[i++];
+				switch (c) {
+				case '(': {
+					if (more() && peek() == '?') {
+						if (i + 1 < _n && _p[i + 1] == ':')
+							i += 2;
+						else
+							throw std::invalid_argument("Regex: lookaround is not supported");
+					}
+					++_depth;
+					const Frag f = alternation();
+					expect(')', "Regex: missing )");
+					--_depth;
+					return f;
+				}
+				case '[':
+					return bytes(bracket());
+				case '.': {
+					ByteSet s;
+					s.invert();
+					s.bits[0] &= ~((uint64_t(1) << '\n') | (uint64_t(1) << '\r'));
+					return bytes(s);
+				}
+				case '\\': {
+					int single = 0;
+					return bytes(escape(single));
+				}
+				case '^':
+					if (i != 1)
+						throw std::invalid_argument("Regex: ^ only at the start");
+					_nfa.anchoredStart = true;
+					return empty();
+				case '$':
+					if (i != _n)
+						throw std::invalid_argument("Regex: $ only at the end");
+					_nfa.anchoredEnd = true;
+					return empty();
+				case '*': case '+': case '?':
+					throw std::invalid_argument("Regex: nothing to repeat");
+				default: {
+					ByteSet s;
+					s.add(static_cast<unsigned char>(c));
+					return bytes(s);
+				}
+				}
+			}
+
+			constexpr bool counted() const
+			{
+				size_t k = i + 1;
+				bool digits = false;
+				while (k < _n && _p[k] >= '0' && _p[k] <= '9') {
+					++k;
+					digits = true;
+				}
+				if (!digits)
+					return false;
+				if (k < _n && _p[k] == ',')
+					++k;
+				while (k < _n && _p[k] >= '0' && _p[k] <= '9')
+					++k;
+				return k < _n && _p[k] == '}';
+			}
+
+			constexpr size_t number()
+			{
+				size_t value = 0;
+				while (more() && peek() >= '0' && peek() <= '9') {
+					value = value * 10 + static_cast<size_t>(peek() - '0');
+					if (value > 1000)
+						throw std::length_error("Regex: repetition count above 1000");
+					++i;
+				}
+				return value;
+			}
+
+//  x{m,n}: m copies of x, then n - m optional ones, parsing x again
+//  from atomStart for every copy after the first.
+			constexpr Frag repeat(Frag first, size_t atomStart)
+			{
+				++i;
+				const size_t low = number();
+				bool unbounded = false;
+				size_t high = low;
+				if (peek() == ',') {
+					++i;
+					unbounded = !(more() && peek() >= '0' && peek() <= '9');
+					high = unbounded ? low : number();
+				}
+				expect('}', "Regex: missing }");
+				if (high < low)
+					throw std::invalid_argument("Regex: {m,n} with n < m");
+				const size_t resume = i;
+
+				size_t copies = 0;
+				auto copy = [&]() {
+					if (copies++ == 0)
+						return first;
+					i = atomStart;
+					return atom();
+				};
+				Frag result = empty();
+				for (size_t k = 0; k < low; ++k)
+					result = concat(result, copy());
+				if (unbounded)
+					result = concat(result, star(copy()));
+				for (size_t k = low; k < high; ++k)
+					result = concat(result, optional(copy()));
+				i = resume;
+				return result;
+			}
+
+			constexpr Frag repetition()
+			{
+				const size_t atomStart = i;
+				Frag f = atom();
+				bool repeated = false;
+				while (more()) {
+					const char c = peek();
+					if (c == '*' || c == '+' || c == '?') {
+						++i;
+						f = c == '*' ? star(f) : c == '+' ? plus(f) : optional(f);
+					}
+					else if (c == '{' && counted()) {
+						if (repeated)
+							throw std::invalid_argument("Regex: {m,n} after another quantifier");
+						f = repeat(f, atomStart);
+					}
+					else
+						break;
+					repeated = true;
+					if (more() && peek() == '?')
+						++i;
+				}
+				return f;
+			}
+
+			constexpr Frag concatenation()
+			{
+				Frag f = empty();
+				while (more() && peek() != '|' && peek() != ')')
+					f = concat(f, repetition());
+				return f;
+			}
+
+		public:
+			size_t i = 0;
+
+			constexpr Parser(Nfa& nfa, const char* p, size_t n) : _nfa(nfa), _p(p), _n(n) {}
+
+			constexpr Frag alternation()
+			{
+				Frag f = concatenation();
+				while (more() && peek() == '|') {
+					++i;
+					_topLevelBar = _topLevelBar || _depth == 0;
+					f = alternate(f, concatenation());
+				}
+				return f;
+			}
+
+			constexpr void finish(Frag f)
+			{
+				if (i != _n)
+					throw std::invalid_argument("Regex: unbalanced )");
+//  The anchors are flags of the whole pattern, so in ^a|b they would
+//  anchor b too; ECMAScript anchors only the first alternative.
+				if (_topLevelBar && (_nfa.anchoredStart || _nfa.anchoredEnd))
+					throw std::invalid_argument("Regex: ^ or $ with a top-level |, group the alternatives as in ^(a|b)$");
+				_nfa.match = add(Kind::Match);
+				patch(f, _nfa.match);
+				_nfa.start = f.start;
+			}
+		};
+
+//  The literal every match starts with: single-byte sets along the
+//  chain of states with one way out.
+		constexpr void findPrefix(Nfa& nfa)
+		{
+			uint16_t s = nfa.start;
+			while (nfa.prefixLength < maxPrefix && s != none) {
+				const NfaState& state = nfa.states[s];
+				if (state.kind == Kind::Epsilon)
+					s = state.out1;
+				else if (state.kind == Kind::Set && nfa.sets[state.set].single() >= 0) {
+					nfa.prefix[nfa.prefixLength++] = static_cast<char>(nfa.sets[state.set].single());
+					s = state.out1;
+				}
+				else
+					break;
+			}
+		}
+
+		constexpr void parse(const char* pattern, size_t length, Nfa& nfa)
+		{
+			Parser parser(nfa, pattern, length);
+			parser.finish(parser.alternation());
+			findPrefix(nfa);
+		}
+
+		constexpr Nfa parse(const char* pattern, size_t length)
+		{
+			Nfa nfa;
+			parse(pattern, length, nfa);
+			return nfa;
+		}
+
+//  Bytes no set tells apart share a class; DFA rows have one column per
+//  class.
+		struct ByteClasses
+		{
+			uint8_t of[256] = {};
+			uint8_t representative[256] = {};
+			size_t count = 1;
+		};
+
+//  Refines the byte ranges between set boundaries rather than single bytes:
+//  bytes in one range agree on every set.
+		constexpr ByteClasses byteClasses(const Nfa& nfa)
+		{
+			ByteSet boundaries;
+			boundaries.add(0);
+			for (size_t k = 0; k < nfa.setCount; ++k)
+				for (int w = 0; w < 4; ++w) {
+					const uint64_t bits = nfa.sets[k].bits[w];
+					const uint64_t carry = w > 0 ? nfa.sets[k].bits[w - 1] >> 63 : 0;
+					boundaries.bits[w] |= bits ^ (bits << 1 | carry);
+				}
+			uint8_t firsts[256] = {};
+			uint8_t classOf[256] = {};
+			size_t ranges = 0;
+			for (unsigned c = 0; c < 256; ++c)
+				if (boundaries.has(static_cast<unsigned char>(c)))
+					firsts[ranges++] = static_cast<uint8_t>(c);
+
+			ByteClasses classes;
+			uint16_t renamed[256][2] = {};
+			for (size_t k = 0; k < nfa.setCount; ++k) {
+				size_t count = 0;
+				for (size_t r = 0; r < ranges; ++r) {
+					uint16_t& id = renamed[classOf[r]][nfa.sets[k].has(firsts[r])];
+					if (id == 0)
+						id = static_cast<uint16_t>(++count);
+					classOf[r] = static_cast<uint8_t>(id - 1);
+				}
+				for (size_t j = 0; j < classes.count; ++j)
+					renamed[j][0] = renamed[j][1] = 0;
+				classes.count = count;
+			}
+			for (size_t r = 0, c = 0; r < ranges; ++r)
+				for (const unsigned end = r + 1 < ranges ? firsts[r + 1] : 256; c < end; ++c)
+					classes.of[c] = classOf[r];
+			for (unsigned c = 256; c-- > 0;)
+				classes.representative[classes.of[c]] = static_cast<uint8_t>(c);
+			return classes;
+		}
+
+//  Subset construction on bitsets of NFA states. Bit nfa.count marks an
+//  unanchored state, which restarts the pattern at every byte.
+		constexpr bool test(const uint64_t* set, size_t k) { return (set[k >> 6] >> (k & 63)) & 1; }
+		constexpr void mark(uint64_t* set, size_t k) { set[k >> 6] |= uint64_t(1) << (k & 63); }
+
+		constexpr void closure(const Nfa& nfa, uint16_t from, uint64_t* set, uint16_t* stack)
+		{
+			if (from == none || test(set, from))
+				return;
+			size_t top = 0;
+			mark(set, from);
+			stack[top++] = from;
+			while (top > 0) {
+				const NfaState& state = nfa.states[stack[--top]];
+				if (state.kind != Kind::Epsilon && state.kind != Kind::Split)
+					continue;
+				for (uint16_t next : { state.out1, state.kind == Kind::Split ? state.out2 : none })
+					if (next != none && !test(set, next)) {
+						mark(set, next);
+						stack[top++] = next;
+					}
+			}
+		}
+
+//  Only Set and Match states tell DFA states apart.
+		constexpr void prune(const Nfa& nfa, uint64_t* set)
+		{
+			for (size_t k = 0; k < nfa.count; ++k)
+				if (nfa.states[k].kind == Kind::Epsilon || nfa.states[k].kind == Kind::Split)
+					set[k >> 6] &= ~(uint64_t(1) << (k & 63));
+		}
+
+//  Bytes that can begin a match: the sets of the Set states reachable from
+//  the start without input.
+		constexpr ByteSet firstBytes(const Nfa& nfa)
+		{
+			uint64_t set[maxStates / 64] = {};
+			uint16_t stack[maxStates] = {};
+			closure(nfa, nfa.start, set, stack);
+			ByteSet bytes;
+			for (size_t k = 0; k < nfa.count; ++k)
+				if (test(set, k) && nfa.states[k].kind == Kind::Set)
+					bytes.merge(nfa.sets[nfa.states[k].set]);
+			return bytes;
+		}
+
+		constexpr void startSet(const Nfa& nfa, bool anchored, uint64_t* set, size_t words, uint16_t* stack)
+		{
+			for (size_t k = 0; k < words; ++k)
+				set[k] = 0;
+			closure(nfa, nfa.start, set, stack);
+			if (!anchored)
+				mark(set, nfa.count);
+			prune(nfa, set);
+		}
+
+		constexpr void step(const Nfa& nfa, const uint64_t* from, unsigned char byte, uint64_t* to, size_t words, uint16_t* stack)
+		{
+			for (size_t k = 0; k < words; ++k)
+				to[k] = 0;
+			for (size_t k = 0; k < nfa.count; ++k)
+				if (test(from, k) && nfa.states[k].kind == Kind::Set && nfa.sets[nfa.states[k].set].has(byte))
+					closure(nfa, nfa.states[k].out1, to, stack);
+			if (test(from, nfa.count)) {
+				closure(nfa, nfa.start, to, stack);
+				mark(to, nfa.count);
+			}
+			prune(nfa, to);
+		}
+
+		template <size_t Words, size_t Classes, size_t MaxStates>
+		struct DfaBuild
+		{
+			uint64_t sets[MaxStates][Words] = {};
+			uint16_t next[MaxStates][Classes] = {};
+			size_t count = 1;   // state 0 is the dead state, the empty set
+			uint16_t anchored = 0;
+			uint16_t unanchored = 0;
+		};
+
+		template <size_t Words, size_t Classes, size_t MaxStates>
+		constexpr DfaBuild<Words, Classes, MaxStates> buildDfa(const Nfa& nfa, const ByteClasses& classes)
+		{
+			DfaBuild<Words, Classes, MaxStates> dfa;
+			uint16_t stack[maxStates] = {};
+			uint64_t scratch[Words] = {};
+
+			auto find = [&]() {
+				for (size_t s = 0; s < dfa.count; ++s) {
+					bool equal = true;
+					for (size_t k = 0; k < Words; ++k)
+						equal = equal && dfa.sets[s][k] == scratch[k];
+					if (equal)
+						return static_cast<uint16_t>(s);
+				}
+				if (dfa.count == MaxStates)
+					throw std::length_error("Regex: more than 256 DFA states; use Regex::Pattern");
+				for (size_t k = 0; k < Words; ++k)
+					dfa.sets[dfa.count][k] = scratch[k];
+				return static_cast<uint16_t>(dfa.count++);
+			};
+
+			startSet(nfa, true, scratch, Words, stack);
+			dfa.anchored = find();
+			startSet(nfa, false, scratch, Words, stack);
+			dfa.unanchored = find();
+			for (size_t s = 1; s < dfa.count; ++s)
+				for (size_t c = 0; c < Classes; ++c) {
+					step(nfa, dfa.sets[s], classes.representative[c], scratch, Words, stack);
+					dfa.next[s][c] = find();
+				}
+			return dfa;
+		}
+
+//  What a compiled pattern keeps at run time.
+		template <size_t States, size_t Classes>
+		struct Table
+		{
+			uint16_t next[States][Classes] = {};
+			bool accept[States] = {};
+			uint8_t classOf[256] = {};
+			uint16_t anchored = 0;
+			uint16_t unanchored = 0;
+			ByteSet firstBytes;
+			char prefix[maxPrefix] = {};
+			size_t prefixLength = 0;
+			bool anchoredStart = false;
+			bool anchoredEnd = false;
+		};
+
+		template <size_t States, size_t Classes, typename Build>
+		constexpr Table<States, Classes> shrink(const Build& dfa, const Nfa& nfa, const ByteClasses& classes)
+		{
+			Table<States, Classes> table;
+			for (size_t s = 0; s < States; ++s) {
+				for (size_t c = 0; c < Classes; ++c)
+					table.next[s][c] = dfa.next[s][c];
+				table.accept[s] = test(dfa.sets[s], nfa.match);
+			}
+			for (unsigned c = 0; c < 256; ++c)
+				table.classOf[c] = classes.of[c];
+			table.firstBytes = firstBytes(nfa);
+			table.anchored = dfa.anchored;
+			table.unanchored = dfa.unanchored;
+			for (size_t k = 0; k < nfa.prefixLength; ++k)
+				table.prefix[k] = nfa.prefix[k];
+			table.prefixLength = nfa.prefixLength;
+			table.anchoredStart = nfa.anchoredStart;
+			table.anchoredEnd = nfa.anchoredEnd;
+			return table;
+		}
+
+#if defined(__GNUC__) || defined(__clang__)
+#if defined(__AVX2__)
+		constexpr size_t regexVecBytes = 32;
+#else
+		constexpr size_t regexVecBytes = 16;
+#endif
+		typedef char RegexVec __attribute__((vector_size(regexVecBytes)));
+#endif
+
+//  First occurrence of the m-byte literal in [p, end): vectors of
+//  candidate positions whose first and last bytes both match, then
+//  memcmp for the middle.
+		inline const char* findLiteral(const char* p, const char* end, const char* literal, size_t m)
+		{
+			if (static_cast<size_t>(end - p) < m)
+				return nullptr;
+			const char* last = end - m;
+#if defined(__GNUC__) || defined(__clang__)
+			RegexVec first, final;
+			for (size_t k = 0; k < regexVecBytes; ++k) {
+				first[k] = literal[0];
+				final[k] = literal[m - 1];
+			}
+			for (; p + regexVecBytes <= last + 1; p += regexVecBytes) {
+				RegexVec a, b;
+				std::memcpy(&a, p, sizeof a);
+				std::memcpy(&b, p + m - 1, sizeof b);
+				const auto hit = (a == first) & (b == final);
+				uint64_t words[regexVecBytes / 8];
+				std::memcpy(words, &hit, sizeof words);
+				uint64_t any = 0;
+				for (uint64_t word : words)
+					any |= word;
+				if (any == 0)
+					continue;
+				for (size_t k = 0; k < regexVecBytes; ++k)
+					if (hit[k] && std::memcmp(p + k + 1, literal + 1, m - 1) == 0)
+						return p + k;
+			}
+#endif
+			while (p <= last) {
+				p = static_cast<const char*>(std::memchr(p, literal[0], static_cast<size_t>(last - p) + 1));
+				if (p == nullptr)
+					return nullptr;
+				if (std::memcmp(p + 1, literal + 1, m - 1) == 0)
+					return p;
+				++p;
+			}
+			return nullptr;
+		}
+
+//  Matching on any engine with start(anchored), next(state, byte) and
+//  accepting(state); state 0 is dead.
+		template <typename Engine>
+		const char* longest(Engine& e, const char* p, const char* end, size_t& scanned)
+		{
+			auto s = e.start(true);
+			const char* last = nullptr;
+			if (e.accepting(s) && (!e.anchoredEnd() || p == end))
+				last = p;
+			const char* const from = p;
+			while (p != end) {
+				s = e.next(s, static_cast<unsigned char>(*p++));
+				if (s == 0)
+					break;
+				if (e.accepting(s) && (!e.anchoredEnd() || p == end))
+					last = p;
+			}
+			scanned += static_cast<size_t>(p - from);
+			return last;
+		}
+
+		template <typename Engine>
+		bool any(Engine& e, const char* p, const char* end)
+		{
+			auto s = e.start(false);
+			if (!e.anchoredEnd()) {
+				if (e.accepting(s))
+					return true;
+				while (p != end) {
+					s = e.next(s, static_cast<unsigned char>(*p++));
+					if (e.accepting(s))
+						return true;
+				}
+				return false;
+			}
+			while (p != end)
+				s = e.next(s, static_cast<unsigned char>(*p++));
+			return e.accepting(s);
+		}
+
+		template <typename Engine>
+		bool whole(Engine& e, std::string_view text)
+		{
+			auto s = e.start(true);
+			for (char c : text) {
+				s = e.next(s, static_cast<unsigned char>(c));
+				if (s == 0)
+					return false;
+			}
+			return e.accepting(s);
+		}
+
+//  Leftmost-longest: the first candidate start with any match, extended
+//  as far as it goes. Candidates that keep failing late would make this
+//  quadratic, so past a budget one unanchored pass first checks that
+//  some match is left at all.
+		template <typename Engine>
+		bool find(Engine& e, std::string_view text, Match* match)
+		{
+			const char* const begin = text.data();
+			const char* const end = begin + text.size();
+			const std::string_view prefix = e.prefix();
+			const bool nullable = e.accepting(e.start(true));
+			size_t budget = 4 * text.size() + 4096;
+			size_t scanned = 0;
+
+			for (const char* p = begin;; ++p) {
+				if (e.anchoredStart() && p != begin)
+					return false;
+				if (!nullable && !e.anchoredStart()) {
+					if (!prefix.empty())
+						p = findLiteral(p, end, prefix.data(), prefix.size());
+					else
+						while (p != end && !e.firstBytes().has(static_cast<unsigned char>(*p)))
+							++p;
+					if (p == nullptr || p == end)
+						return false;
+				}
+				if (const char* last = longest(e, p, end, scanned)) {
+					if (match)
+						*match = Match{ std::string_view(p, static_cast<size_t>(last - p)), static_cast<size_t>(p - begin) };
+					return true;
+				}
+				if (p == end)
+					return false;
+				if (scanned > budget) {
+					if (!any(e, p + 1, end))
+						return false;
+					budget = SIZE_MAX;
+				}
+			}
+		}
+
+		template <typename Engine>
+		bool contains(Engine& e, std::string_view text)
+		{
+			if (e.prefix().empty() && !e.anchoredStart())
+				return any(e, text.data(), text.data() + text.size());
+			return find(e, text, nullptr);
+		}
+	}
+
+//  A pattern known at compile time, given as a char array with static
+//  storage: static constexpr char p[] = "..."; Regex::Compiled<p>.
+	template <const char* Pattern>
+	class Compiled
+	{
+		static constexpr size_t length = std::char_traits<char>::length(Pattern);
+		static constexpr detail::Nfa nfa = detail::parse(Pattern, length);
+		static constexpr detail::ByteClasses classes = detail::byteClasses(nfa);
+		static constexpr size_t words = (nfa.count + 1 + 63) / 64;
+		static constexpr auto dfa = detail::buildDfa<words, classes.count, 256>(nfa, classes);
+		static constexpr auto table = detail::shrink<dfa.count, classes.count>(dfa, nfa, classes);
+
+		struct Engine
+		{
+			static uint16_t start(bool anchored) { return anchored ? table.anchored : table.unanchored; }
+			static uint16_t next(uint16_t s, unsigned char byte) { return table.next[s][table.classOf[byte]]; }
+			static bool accepting(uint16_t s) { return table.accept[s]; }
+			static bool anchoredStart() { return table.anchoredStart; }
+			static bool anchoredEnd() { return table.anchoredEnd; }
+			static std::string_view prefix() { return { table.prefix, table.prefixLength }; }
+			static const detail::ByteSet& firstBytes() { return table.firstBytes; }
+		};
+
+	public:
+		static constexpr size_t states() { return dfa.count; }
+
+		static bool search(std::string_view text)
+		{
+			Engine e;
+			return detail::contains(e, text);
+		}
+
+		static bool search(std::string_view text, Match& match)
+		{
+			Engine e;
+			return detail::find(e, text, &match);
+		}
+
+		static bool match(std::string_view text)
+		{
+			Engine e;
+			return detail::whole(e, text);
+		}
+	};
+
+//  A pattern known at run time. Throws std::invalid_argument for syntax
+//  errors and std::length_error for patterns beyond the NFA limits.
+	class Pattern
+	{
+		static constexpr size_t maxCachedStates = 10000;
+
+		std::unique_ptr<detail::Nfa> _nfa;
+		detail::ByteClasses _classes;
+		detail::ByteSet _firstBytes;
+		size_t _words = 0;
+
+		std::vector<uint64_t> _sets;      // words per state
+		std::vector<int32_t> _next;       // _classes.count per state, -1 until built
+		std::vector<uint8_t> _accept;
+		std::unordered_map<std::string, int32_t> _index;
+		int32_t _starts[2] = { -1, -1 };
+		std::vector<uint64_t> _scratch;
+		std::vector<uint16_t> _stack;
+
+		int32_t intern()
+		{
+			std::string key(reinterpret_cast<const char*>(_scratch.data()), _words * sizeof(uint64_t));
+			const auto found = _index.find(key);
+			if (found != _index.end())
+				return found->second;
+			const int32_t s = static_cast<int32_t>(_accept.size());
+			_sets.insert(_sets.end(), _scratch.begin(), _scratch.end());
+			_next.resize(_next.size() + _classes.count, -1);
+			_accept.push_back(detail::test(_scratch.data(), _nfa->match));
+			_index.emplace(std::move(key), s);
+			return s;
+		}
+
+		void reset()
+		{
+			_sets.clear();
+			_next.clear();
+			_accept.clear();
+			_index.clear();
+			_starts[0] = _starts[1] = -1;
+			std::fill(_scratch.begin(), _scratch.end(), 0);
+			intern();
+		}
+
+		int32_t build(int32_t s, unsigned cls)
+		{
+			std::vector<uint64_t> from(_sets.begin() + static_cast<std::ptrdiff_t>(s * _words), _sets.begin() + static_cast<std::ptrdiff_t>((s + 1) * _words));
+			detail::step(*_nfa, from.data(), _classes.representative[cls], _scratch.data(), _words, _stack.data());
+			if (_accept.size() >= maxCachedStates) {
+				const std::vector<uint64_t> target = _scratch;
+				reset();
+				_scratch = target;
+				return intern();
+			}
+			const int32_t t = intern();
+			_next[static_cast<size_t>(s) * _classes.count + cls] = t;
+			return t;
+		}
+
+	public:
+		explicit Pattern(std::string_view pattern) :
+			_nfa(std::make_unique<detail::Nfa>())
+		{
+			detail::parse(pattern.data(), pattern.size(), *_nfa);
+			_classes = detail::byteClasses(*_nfa);
+			_firstBytes = detail::firstBytes(*_nfa);
+			_words = (_nfa->count + 1 + 63) / 64;
+			_scratch.resize(_words);
+			_stack.resize(detail::maxStates);
+			reset();
+		}
+
+		Pattern(const Pattern& other) :
+			_nfa(std::make_unique<detail::Nfa>(*other._nfa)),
+			_classes(other._classes),
+			_firstBytes(other._firstBytes),
+			_words(other._words),
+			_sets(other._sets),
+			_next(other._next),
+			_accept(other._accept),
+			_index(other._index),
+			_starts{ other._starts[0], other._starts[1] },
+			_scratch(other._scratch),
+			_stack(other._stack)
+		{}
+
+		Pattern(Pattern&&) = default;
+
+//  DFA states built so far.
+		size_t states() const { return _accept.size(); }
+
+		int32_t start(bool anchored)
+		{
+			int32_t& s = _starts[anchored];
+			if (s < 0) {
+				detail::startSet(*_nfa, anchored, _scratch.data(), _words, _stack.data());
+				s = intern();
+			}
+			return s;
+		}
+
+		int32_t next(int32_t s, unsigned char byte)
+		{
+			const unsigned cls = _classes.of[byte];
+			const int32_t t = _next[static_cast<size_t>(s) * _classes.count + cls];
+			return t >= 0 ? t : build(s, cls);
+		}
+
+		bool accepting(int32_t s) const { return _accept[static_cast<size_t>(s)] != 0; }
+		bool anchoredStart() const { return _nfa->anchoredStart; }
+		bool anchoredEnd() const { return _nfa->anchoredEnd; }
+		std::string_view prefix() const { return { _nfa->prefix, _nfa->prefixLength }; }
+		const detail::ByteSet& firstBytes() const { return _firstBytes; }
+
+		bool search(std::string_view text) { return detail::contains(*this, text); }
+		bool search(std::string_view text, Match& match) { return detail::find(*this, text, &match); }
+		bool match(std::string_view text) { return detail::whole(*this, text); }
+	};
+
+//  std::regex_search and std::regex_match counterparts.
+	template <typename Re>
+	bool search(std::string_view text, Re& re) { return re.search(text); }
+
+	template <typename Re>
+	bool search(std::string_view text, Match& match, Re& re) { return re.search(text, match); }
+
+	template <typename Re>
+	bool match(std::string_view text, Re& re) { return re.match(text); }
+}
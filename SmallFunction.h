@@ -0,0 +1,277 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//==============================================================
+//	Non-allocating function wrappers
+//==============================================================
+//	std::function may heap-allocate its target and cannot be inlined through.
+//	small_function<Sig, N> stores the callable in N bytes of inline storage
+//	and never allocates: a callable that does not fit is a compile error.
+//	small_move_function<Sig, N> also accepts move-only callables and is itself
+//	move-only. function_ref<Sig> is a non-owning two-pointer view for
+//	parameters, like std::string_view for callables.
+//
+//	Trivially copyable callables (lambdas capturing ints and pointers) copy
+//	and destroy with no indirect call at all.
+
+namespace SmallFunction {
+
+	namespace detail {
+
+		enum class FunctionOp { Move, Copy, Destroy };
+
+		template <size_t N, typename R, typename... Args>
+		class FunctionStorage
+		{
+		protected:
+			using Invoker = R (*)(void*, Args&&...);
+			using Manager = void (*)(FunctionOp, void* self, void* other);
+
+			alignas(std::max_align_t) mutable unsigned char _storage[N];
+			Invoker _invoke = nullptr;
+			Manager _manage = nullptr; // null when the target is trivially copyable
+
+			template <typename F>
+			static R invoke(void* target, Args&&... args)
+			{
+				if constexpr (std::is_void<R>::value)
+					std::invoke(*static_cast<F*>(target), std::forward<Args>(args)...);
+				else
+					return std::invoke(*static_cast<F*>(target), std::forward<Args>(args)...);
+			}
+
+			template <typename F>
+			static void manage(FunctionOp op, void* self, void* other)
+			{
+				switch (op) {
+				case FunctionOp::Move:
+					::new (self) F(std::move(*static_cast<F*>(other)));
+					static_cast<F*>(other)->~F();
+					break;
+				case FunctionOp::Copy:
+					if constexpr (std::is_copy_constructible<F>::value)
+						::new (self) F(*static_cast<const F*>(other));
+					break;
+				case FunctionOp::Destroy:
+					static_cast<F*>(self)->~F();
+					break;
+				}
+			}
+
+			template <typename F>
+			static bool isNull(const F& f)
+			{
+				if constexpr (std::is_pointer<F>::value || std::is_member_pointer<F>::value)
+					return f == nullptr;
+				else
+					return false;
+			}
+
+			template <typename F>
+			void emplace(F&& f)
+			{
+				using D = typename std::decay<F>::type;
+				static_assert(sizeof(D) <= N, "callable does not fit in the inline storage: raise N");
+				static_assert(alignof(D) <= alignof(std::max_align_t), "over-aligned callable");
+				static_assert(std::is_nothrow_move_constructible<D>::value, "callable must be nothrow move constructible");
+
+				if (isNull(f))
+					return;
+
+				::new (static_cast<void*>(_storage)) D(std::forward<F>(f));
+				_invoke = &invoke<D>;
+				if constexpr (!(std::is_trivially_copyable<D>::value && std::is_trivially_destructible<D>::value))
+					_manage = &manage<D>;
+			}
+
+			void reset() noexcept
+			{
+				if (_manage)
+					_manage(FunctionOp::Destroy, _storage, nullptr);
+				_invoke = nullptr;
+				_manage = nullptr;
+			}
+
+			void moveFrom(FunctionStorage& other) noexcept
+			{
+				if (other._manage)
+					other._manage(FunctionOp::Move, _storage, other._storage);
+				else if (other._invoke)
+					std::memcpy(_storage, other._storage, N);
+
+				_invoke = other._invoke;
+				_manage = other._manage;
+				other._invoke = nullptr;
+				other._manage = nullptr;
+			}
+
+			void copyFrom(const FunctionStorage& other)
+			{
+				if (other._manage)
+					other._manage(FunctionOp::Copy, _storage, other._storage);
+				else if (other._invoke)
+					std::memcpy(_storage, other._storage, N);
+
+				_invoke = other._invoke;
+				_manage = other._manage;
+			}
+
+			FunctionStorage() = default;
+			FunctionStorage(const FunctionStorage& other) { copyFrom(other); }
+			FunctionStorage(FunctionStorage&& other) noexcept { moveFrom(other); }
+			FunctionStorage& operator=(const FunctionStorage& other)
+			{
+				if (this != &other) {
+					reset();
+					copyFrom(other);
+				}
+				return *this;
+			}
+			FunctionStorage& operator=(FunctionStorage&& other) noexcept
+			{
+				if (this != &other) {
+					reset();
+					moveFrom(other);
+				}
+				return *this;
+			}
+			~FunctionStorage() { reset(); }
+		};
+
+		struct CopyableFunction {};
+
+		struct MoveOnlyFunction
+		{
+			MoveOnlyFunction() = default;
+			MoveOnlyFunction(const MoveOnlyFunction&) = delete;
+			MoveOnlyFunction(MoveOnlyFunction&&) = default;
+			MoveOnlyFunction& operator=(const MoveOnlyFunction&) = delete;
+			MoveOnlyFunction& operator=(MoveOnlyFunction&&) = default;
+		};
+	}
+}
+
+template <typename Sig, size_t N, bool Copyable>
+class basic_small_function;
+
+template <typename R, typename... Args, size_t N, bool Copyable>
+class basic_small_function<R(Args...), N, Copyable> :
+	private SmallFunction::detail::FunctionStorage<N, R, Args...>,
+	private std::conditional<Copyable, SmallFunction::detail::CopyableFunction, SmallFunction::detail::MoveOnlyFunction>::type
+{
+	using Storage = SmallFunction::detail::FunctionStorage<N, R, Args...>;
+
+	template <typename F>
+	using Accepts = typename std::enable_if<
+		!std::is_same<typename std::decay<F>::type, basic_small_function>::value &&
+		std::is_invocable_r<R, typename std::decay<F>::type&, Args...>::value &&
+		(!Copyable || std::is_copy_constructible<typename std::decay<F>::type>::value)>::type;
+
+public:
+	basic_small_function() noexcept = default;
+	basic_small_function(std::nullptr_t) noexcept {}
+
+	template <typename F, typename = Accepts<F>>
+	basic_small_function(F&& f) { this->emplace(std::forward<F>(f)); }
+
+	template <typename F, typename = Accepts<F>>
+	basic_small_function& operator=(F&& f)
+	{
+		this->reset();
+		this->emplace(std::forward<F>(f));
+		return *this;
+	}
+
+	basic_small_function& operator=(std::nullptr_t) noexcept
+	{
+		this->reset();
+		return *this;
+	}
+
+	basic_small_function(const basic_small_function&) = default;
+	basic_small_function(basic_small_function&&) = default;
+	basic_small_function& operator=(const basic_small_function&) = default;
+	basic_small_function& operator=(basic_small_function&&) = default;
+
+	explicit operator bool() const noexcept { return this->_invoke != nullptr; }
+
+	R operator()(Args... args) const
+	{
+		if (!this->_invoke)
+			throw std::bad_function_call();
+		return this->_invoke(this->_storage, std::forward<Args>(args)...);
+	}
+};
+
+//  Default capacity holds four pointers' worth of captures.
+template <typename Sig, size_t N = 4 * sizeof(void*)>
+using small_function = basic_small_function<Sig, N, true>;
+
+template <typename Sig, size_t N = 4 * sizeof(void*)>
+using small_move_function = basic_small_function<Sig, N, false>;
+
+
+template <typename Sig>
+class function_ref;
+
+template <typename R, typename... Args>
+class function_ref<R(Args...)>
+{
+	union Target
+	{
+		void* object;
+		void (*function)();
+	};
+
+	Target _target;
+	R (*_invoke)(Target, Args&&...);
+
+	template <typename F>
+	static R invokeObject(Target t, Args&&... args)
+	{
+		if constexpr (std::is_void<R>::value)
+			std::invoke(*static_cast<F*>(t.object), std::forward<Args>(args)...);
+		else
+			return std::invoke(*static_cast<F*>(t.object), std::forward<Args>(args)...);
+	}
+
+	template <typename F>
+	static R invokeFunction(Target t, Args&&... args)
+	{
+		if constexpr (std::is_void<R>::value)
+			reinterpret_cast<F*>(t.function)(std::forward<Args>(args)...);
+		else
+			return reinterpret_cast<F*>(t.function)(std::forward<Args>(args)...);
+	}
+
+public:
+//  Refers to f; f must outlive every call through this function_ref.
+	template <typename F, typename = typename std::enable_if<
+		!std::is_same<typename std::decay<F>::type, function_ref>::value &&
+		std::is_invocable_r<R, F&, Args...>::value>::type>
+	function_ref(F&& f) noexcept
+	{
+		using T = typename std::remove_reference<F>::type;
+		if constexpr (std::is_function<T>::value) {
+			_target.function = reinterpret_cast<void (*)()>(&f);
+			_invoke = &invokeFunction<T>;
+		}
+		else if constexpr (std::is_pointer<T>::value && std::is_function<typename std::remove_pointer<T>::type>::value) {
+//  The pointer itself may be a temporary: keep its value.
+			_target.function = reinterpret_cast<void (*)()>(f);
+			_invoke = &invokeFunction<typename std::remove_pointer<T>::type>;
+		}
+		else {
+			_target.object = const_cast<void*>(static_cast<const void*>(std::addressof(f)));
+			_invoke = &invokeObject<T>;
+		}
+	}
+
+	R operator()(Args... args) const { return _invoke(_target, std::forward<Args>(args)...); }
+};
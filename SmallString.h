@@ -0,0 +1,290 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+//==============================================================
+//	Compact string with a large inline capacity
+//==============================================================
+//	using String = std::string; spends 32 bytes per string on libstdc++ and
+//	allocates beyond 15 characters. small_string is also 32 bytes but keeps
+//	up to 31 characters inline: the last byte holds the unused inline room,
+//	which is 0 - the terminating NUL - when all 31 are used, and a flag
+//	when the characters live on the heap instead.
+//
+//	  small_string team = "NYI";            // no allocation
+//	  std::string_view v = team;            // implicit, like std::string
+//	  if (team == "NYI") ...
+//
+//	basic_small_string<Bytes> picks another footprint (24 to 128 bytes). At
+//	exactly three words the flag byte would overlap a heap capacity field,
+//	so that size keeps the capacity in front of the heap characters. It
+//	has no self-pointer, so it opts in to Traits::is_trivially_relocatable
+//	and Buffer<small_string> grows with realloc.
+
+template <size_t Bytes>
+class basic_small_string
+{
+	static_assert(Bytes >= 3 * sizeof(size_t) && Bytes <= 128, "inline room must fit in the last byte's low 7 bits");
+
+	static constexpr unsigned char heapFlag = 0x80;
+	static constexpr size_t inlineCapacity = Bytes - 1;
+	static constexpr bool capacityField = Bytes > 3 * sizeof(size_t);
+
+//  Inline: the characters, then inlineCapacity - size in the last byte.
+//  Heap: pointer, size and (if capacityField) capacity at the front,
+//  heapFlag in the last byte; without capacityField the capacity is the
+//  size_t just before the characters.
+	char _bytes[Bytes];
+
+	bool onHeap() const { return static_cast<unsigned char>(_bytes[Bytes - 1]) == heapFlag; }
+
+	template <typename T>
+	T field(size_t slot) const
+	{
+		T value;
+		std::memcpy(&value, _bytes + slot * sizeof(size_t), sizeof value);
+		return value;
+	}
+
+	template <typename T>
+	void setField(size_t slot, T value) { std::memcpy(_bytes + slot * sizeof(size_t), &value, sizeof value); }
+
+	char* heapData() const { return field<char*>(0); }
+
+	void setInlineSize(size_t n)
+	{
+		_bytes[Bytes - 1] = static_cast<char>(inlineCapacity - n);
+		_bytes[n] = '\0';
+	}
+
+	void setHeap(char* data, size_t size, size_t capacity)
+	{
+		setField(0, data);
+		setField(1, size);
+		if constexpr (capacityField)
+			setField(2, capacity);
+		_bytes[Bytes - 1] = static_cast<char>(heapFlag);
+	}
+
+//  Room for capacity characters and the NUL.
+	static char* allocate(size_t capacity)
+	{
+		if constexpr (capacityField)
+			return new char[capacity + 1];
+		char* block = new char[sizeof(size_t) + capacity + 1];
+		std::memcpy(block, &capacity, sizeof capacity);
+		return block + sizeof(size_t);
+	}
+
+	static void deallocate(char* data) { delete[] (capacityField ? data : data - sizeof(size_t)); }
+
+	size_t heapCapacity() const
+	{
+		if constexpr (capacityField)
+			return field<size_t>(2);
+		size_t capacity;
+		std::memcpy(&capacity, heapData() - sizeof(size_t), sizeof capacity);
+		return capacity;
+	}
+
+	void assign(const char* s, size_t n)
+	{
+		if (n <= inlineCapacity) {
+			std::memmove(_bytes, s, n);
+			setInlineSize(n);
+			return;
+		}
+		char* data = allocate(n);
+		std::memcpy(data, s, n);
+		data[n] = '\0';
+		setHeap(data, n, n);
+	}
+
+	void release()
+	{
+		if (onHeap())
+			deallocate(heapData());
+	}
+
+//  Strings, views and literals; templates so they win over converting to
+//  basic_small_string first.
+	template <typename S>
+	using EnableView = std::enable_if_t<std::is_convertible<const S&, std::string_view>::value && !std::is_same<S, basic_small_string>::value>;
+
+public:
+	using value_type = char;
+	using size_type = size_t;
+	using iterator = char*;
+	using const_iterator = const char*;
+	using trivially_relocatable = std::true_type;
+
+	static constexpr size_t npos = std::string_view::npos;
+
+	basic_small_string() { setInlineSize(0); }
+	basic_small_string(const char* s) { assign(s, std::strlen(s)); }
+	basic_small_string(const char* s, size_t n) { assign(s, n); }
+	basic_small_string(std::string_view s) { assign(s.data(), s.size()); }
+	basic_small_string(const std::string& s) { assign(s.data(), s.size()); }
+
+	basic_small_string(const basic_small_string& other)
+	{
+		if (other.onHeap())
+			assign(other.data(), other.size());
+		else
+			std::memcpy(_bytes, other._bytes, Bytes);
+	}
+
+	basic_small_string(basic_small_string&& other) noexcept
+	{
+		std::memcpy(_bytes, other._bytes, Bytes);
+		other.setInlineSize(0);
+	}
+
+	basic_small_string& operator=(const basic_small_string& other)
+	{
+		if (this != &other)
+			*this = std::string_view(other);
+		return *this;
+	}
+
+	basic_small_string& operator=(basic_small_string&& other) noexcept
+	{
+		if (this != &other) {
+			release();
+			std::memcpy(_bytes, other._bytes, Bytes);
+			other.setInlineSize(0);
+		}
+		return *this;
+	}
+
+//  Reuses heap storage that is large enough.
+	template <typename S, typename = EnableView<S>>
+	basic_small_string& operator=(const S& text)
+	{
+		const std::string_view s(text);
+		if (onHeap() && s.size() <= capacity() && s.size() > inlineCapacity) {
+			std::memmove(heapData(), s.data(), s.size());
+			heapData()[s.size()] = '\0';
+			setField(1, s.size());
+			return *this;
+		}
+		basic_small_string copy(s);
+		return *this = std::move(copy);
+	}
+
+	~basic_small_string() { release(); }
+
+	const char* data() const { return onHeap() ? heapData() : _bytes; }
+	char*       data()       { return onHeap() ? heapData() : _bytes; }
+	const char* c_str() const { return data(); }
+	size_t size() const { return onHeap() ? field<size_t>(1) : inlineCapacity - static_cast<unsigned char>(_bytes[Bytes - 1]); }
+	size_t length() const { return size(); }
+	bool empty() const { return size() == 0; }
+	size_t capacity() const { return onHeap() ? heapCapacity() : inlineCapacity; }
+	static constexpr size_t inline_capacity() { return inlineCapacity; }
+
+	char&       operator[](size_t i)       { return data()[i]; }
+	const char& operator[](size_t i) const { return data()[i]; }
+
+	char& at(size_t i)
+	{
+		if (i >= size())
+			throw std::out_of_range("small_string: index out of range");
+		return data()[i];
+	}
+
+	const char& at(size_t i) const { return const_cast<basic_small_string&>(*this).at(i); }
+
+	iterator       begin()       { return data(); }
+	iterator       end()         { return data() + size(); }
+	const_iterator begin() const { return data(); }
+	const_iterator end()   const { return data() + size(); }
+
+	operator std::string_view() const { return { data(), size() }; }
+	std::string str() const { return std::string(data(), size()); }
+
+	void reserve(size_t n)
+	{
+		if (n <= capacity())
+			return;
+		const size_t size = this->size();
+		char* grown = allocate(n);
+		std::memcpy(grown, data(), size + 1);
+		release();
+		setHeap(grown, size, n);
+	}
+
+	basic_small_string& append(std::string_view s)
+	{
+		const size_t size = this->size();
+		if (size + s.size() > capacity()) {
+			if (s.data() >= data() && s.data() <= data() + size) {
+				const basic_small_string copy(s);
+				return append(copy);
+			}
+			reserve(std::max(size + s.size(), 2 * capacity()));
+		}
+		char* d = data();
+		std::memmove(d + size, s.data(), s.size());
+		if (onHeap()) {
+			d[size + s.size()] = '\0';
+			setField(1, size + s.size());
+		}
+		else
+			setInlineSize(size + s.size());
+		return *this;
+	}
+
+	basic_small_string& operator+=(std::string_view s) { return append(s); }
+	basic_small_string& operator+=(char c) { return append(std::string_view(&c, 1)); }
+	void push_back(char c) { append(std::string_view(&c, 1)); }
+
+	void clear()
+	{
+		if (onHeap()) {
+			heapData()[0] = '\0';
+			setField(1, size_t(0));
+		}
+		else
+			setInlineSize(0);
+	}
+
+	size_t find(std::string_view s, size_t pos = 0) const { return std::string_view(*this).find(s, pos); }
+	int compare(std::string_view s) const { return std::string_view(*this).compare(s); }
+
+	friend bool operator==(const basic_small_string& a, const basic_small_string& b) { return std::string_view(a) == std::string_view(b); }
+	friend bool operator!=(const basic_small_string& a, const basic_small_string& b) { return !(a == b); }
+	friend bool operator<(const basic_small_string& a, const basic_small_string& b) { return std::string_view(a) < std::string_view(b); }
+
+	template <typename S, typename = EnableView<S>>
+	friend bool operator==(const basic_small_string& a, const S& b) { return std::string_view(a) == std::string_view(b); }
+	template <typename S, typename = EnableView<S>>
+	friend bool operator!=(const basic_small_string& a, const S& b) { return std::string_view(a) != std::string_view(b); }
+	template <typename S, typename = EnableView<S>>
+	friend bool operator==(const S& a, const basic_small_string& b) { return std::string_view(a) == std::string_view(b); }
+	template <typename S, typename = EnableView<S>>
+	friend bool operator!=(const S& a, const basic_small_string& b) { return std::string_view(a) != std::string_view(b); }
+
+	friend std::ostream& operator<<(std::ostream& out, const basic_small_string& s) { return out << std::string_view(s); }
+};
+
+using small_string = basic_small_string<32>;
+
+//  Hashes like std::string and std::string_view, so heterogeneous lookup
+//  agrees.
+namespace std {
+	template <size_t Bytes>
+	struct hash<basic_small_string<Bytes>>
+	{
+		size_t operator()(const basic_small_string<Bytes>& s) const { return hash<string_view>()(s); }
+	};
+}
+
+static_assert(sizeof(small_string) == 32, "same footprint as libstdc++'s std::string");
@@ -0,0 +1,69 @@
+#pragma once
+
+//==============================================================
+//	Standard library includes for the feature demo
+//==============================================================
+//	The build chooses how the demo sees the standard library (see
+//	CPP11_STD_INCLUDES in CMakeLists.txt):
+//
+//	  default               stdc++.h, the whole library, textually or from
+//	                        the precompiled header
+//	  CPP11_SLIM_INCLUDES   only the feature sets below
+//	  CPP11_HEADER_UNITS    stdc++.h imported as a C++20 header unit
+//
+//	A translation unit that needs fewer sets defines CPP11_SLIM_NO_<SET>
+//	before including this file.
+
+#if defined(CPP11_SLIM_INCLUDES)
+
+//  Core language: move semantics, lambdas, initializer lists, type traits
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+//  Containers and algorithms
+#if !defined(CPP11_SLIM_NO_CONTAINERS)
+#include <algorithm>
+#include <array>
+#include <list>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <tuple>
+#include <vector>
+#endif
+
+//  Threads, futures and clocks
+#if !defined(CPP11_SLIM_NO_CONCURRENCY)
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#endif
+
+using namespace std;
+#if !defined(CPP11_SLIM_NO_CONCURRENCY)
+using namespace std::chrono;
+#endif
+
+#elif defined(CPP11_HEADER_UNITS)
+
+//  GCC 12 only finds std::initializer_list for `auto x = { ... }` when
+//  <initializer_list> is included textually, and using-directives are not
+//  exported from a header unit, so both are repeated here.
+#include <initializer_list>
+#include "stdc++.h"
+using namespace std;
+using namespace std::chrono;
+
+#else
+#include "stdc++.h"
+#endif
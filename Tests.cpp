@@ -0,0 +1,921 @@
+//==============================================================
+// Tests for the performance extensions
+//==============================================================
+//	Usage: Tests [filter]
+//	Runs every test whose name contains filter (all by default) and exits
+//	with 1 if any check failed. CTest runs each test separately.
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <random>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "BTree.h"
+#include "Buffer.h"
+#include "Complex.h"
+#include "EnumMap.h"
+#include "Expr.h"
+#include "Fft.h"
+#include "FlatMap.h"
+#include "Incremental.h"
+#include "Intern.h"
+#include "Kernels.h"
+#include "Log.h"
+#include "Metrics.h"
+#include "Parallel.h"
+#include "Parse.h"
+#include "Random.h"
+#include "Rcu.h"
+#include "Regex.h"
+#include "SmallFunction.h"
+#include "SmallString.h"
+#include "ThreadPool.h"
+#include "ToChars.h"
+#include "Units.h"
+
+static int failures = 0;
+
+//  Records a failed check; the test goes on so one run shows every failure.
+static void check(bool ok, const char* what)
+{
+	if (!ok) {
+		++failures;
+		std::printf("  FAIL: %s\n", what);
+	}
+}
+
+
+//==============================================================
+//	1. Kernels: every level the CPU supports agrees with SSE2
+//==============================================================
+
+void testKernels()
+{
+	std::mt19937_64 rng(13);
+	const size_t n = 4099;
+	std::vector<double> doubles(n);
+	std::vector<int64_t> ints(n);
+	for (size_t i = 0; i < n; ++i) {
+		doubles[i] = static_cast<double>(rng() >> 11) * 0x1p-53 - 0.5;
+		ints[i] = static_cast<int64_t>(rng());
+	}
+	std::vector<unsigned char> copied(n * sizeof(double));
+
+	std::printf("  detected level: %s\n", Kernels::name(Kernels::supportedLevel()));
+	for (Kernels::Level level : { Kernels::Level::Sse2, Kernels::Level::Avx2, Kernels::Level::Avx512 }) {
+		if (!Kernels::force(level))
+			continue;
+	//  every length up to a few vectors, for the tails
+		for (size_t count : { size_t{ 0 }, size_t{ 1 }, size_t{ 7 }, size_t{ 31 }, size_t{ 33 }, size_t{ 127 }, size_t{ 129 }, n }) {
+			const size_t bytes = count * sizeof(double);
+			std::fill(copied.begin(), copied.end(), 0);
+			Kernels::copy(copied.data(), doubles.data(), bytes);
+			char what[96];
+			std::snprintf(what, sizeof what, "%s kernels agree with sse2 on %zu items", Kernels::name(level), count);
+			check(Kernels::sum(doubles.data(), count) == Kernels::Isa::v_sse2::sum(doubles.data(), count) &&
+				Kernels::sum(ints.data(), count) == Kernels::Isa::v_sse2::sum(ints.data(), count) &&
+				Kernels::hash(doubles.data(), bytes, 1) == Kernels::Isa::v_sse2::hash(doubles.data(), bytes, 1) &&
+				std::memcmp(copied.data(), doubles.data(), bytes) == 0, what);
+		}
+	}
+	Kernels::reset();
+
+	std::unordered_set<int64_t, Kernels::BitwiseHash<int64_t>, Kernels::BitwiseEqual<int64_t>> keys(ints.begin(), ints.end());
+	check(keys.size() == std::set<int64_t>(ints.begin(), ints.end()).size() && keys.count(ints[17]) == 1, "BitwiseHash and BitwiseEqual key an unordered_set");
+}
+
+
+//==============================================================
+//	2. FFT: against the naive DFT, and round trips
+//==============================================================
+
+void testFft()
+{
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<double> uniform(-1, 1);
+
+	for (size_t size = 2; size <= (size_t{ 1 } << 16); size *= 2) {
+		Buffer<Complex> input("input", size);
+		for (auto& c : input)
+			c = Complex(uniform(rng), uniform(rng));
+
+		for (Fft::Kernel kernel : { Fft::Kernel::Scalar, Fft::Kernel::Avx2 }) {
+			if (kernel == Fft::Kernel::Avx2 && !Fft::detail::hasAvx2())
+				continue;
+			char what[96];
+			Buffer<Complex> work("work", size);
+			work = input;
+			Fft::forward(work, kernel);
+			double error = 0;
+			if (size <= 4096) {
+				Buffer<Complex> reference("reference", size);
+				Fft::naiveDft(input.data(), reference.data(), size);
+				for (size_t i = 0; i < size; ++i)
+					error = std::max(error, std::sqrt((work[i] - reference[i]).norm()));
+				std::snprintf(what, sizeof what, "FFT of %zu matches the DFT (error %.3g)", size, error);
+				check(error < 1e-11, what);
+			}
+			Fft::inverse(work, kernel);
+			error = 0;
+			for (size_t i = 0; i < size; ++i)
+				error = std::max(error, std::sqrt((work[i] - input[i]).norm()));
+			std::snprintf(what, sizeof what, "inverse(forward(x)) of %zu is x (error %.3g)", size, error);
+			check(error < 1e-12, what);
+		}
+	}
+}
+
+
+//==============================================================
+//	3. Random: moments, and reproducibility across thread counts
+//==============================================================
+
+template <typename T>
+void checkMoments(const char* name, const Buffer<T>& values, double mean, double variance, double fourthMoment)
+{
+	const double count = static_cast<double>(values.size());
+	double sum = 0, squares = 0;
+	for (T x : values)
+		sum += static_cast<double>(x);
+	const double m = sum / count;
+	for (T x : values)
+		squares += (static_cast<double>(x) - m) * (static_cast<double>(x) - m);
+	const double v = squares / count;
+	check(std::fabs(m - mean) < 6 * std::sqrt(variance / count) &&
+		std::fabs(v - variance) < 6 * std::sqrt((fourthMoment - variance * variance) / count), name);
+}
+
+void testRandom()
+{
+	const size_t n = 1 << 20;
+	Buffer<double> doubles("doubles", n);
+	Buffer<float> floats("floats", n);
+	Random::Xoshiro256 xoshiro(17);
+	const Random::Philox philox(17);
+
+	Random::fill(doubles, Random::Uniform{ -1, 3 }, philox);
+	checkMoments("uniform [-1, 3) double moments", doubles, 1, 16.0 / 12, 256.0 / 80);
+	Random::fill(floats, Random::Uniform{ -1, 3 }, philox);
+	checkMoments("uniform [-1, 3) float moments", floats, 1, 16.0 / 12, 256.0 / 80);
+	Random::fill(doubles, Random::Normal{ 2, 3 }, philox);
+	checkMoments("normal (2, 3) double moments", doubles, 2, 9, 3 * 81);
+	Random::fill(floats, Random::Normal{ 2, 3 }, philox);
+	checkMoments("normal (2, 3) float moments", floats, 2, 9, 3 * 81);
+	Random::fill(doubles, Random::Exponential{ 0.5 }, xoshiro);
+	checkMoments("exponential (0.5) double moments", doubles, 2, 4, 9 * 16 - 16);
+
+	Buffer<double> threads("threads", n);
+	Buffer<double> single("single", n);
+	for (unsigned count : { 1u, 2u, 3u, 8u }) {
+		ThreadPool pool(count);
+		Random::fill(threads, Random::Normal{}, philox, pool);
+		if (count == 1)
+			single = threads;
+		check(single == threads, "Philox fill identical on 1, 2, 3 and 8 threads");
+	}
+
+	Random::Xoshiro256 a(99), b(99);
+	a.discard(1000);
+	for (int i = 0; i < 1000; ++i)
+		b();
+	check(a == b, "Xoshiro256 discard(n) equals n calls");
+}
+
+
+//==============================================================
+//	4. Log: records wrapping with every possible space left
+//==============================================================
+//	A record is a 32-byte header plus its arguments, 8 bytes per int64_t.
+//	Runs of seven 32-, 40-, 48- and 56-byte records through a 256-byte
+//	ring make it wrap with 8, 16, ... 48 bytes left before the end. Run
+//	under ASan to catch writes past the end.
+
+void testLog()
+{
+	const std::string path = "tests-log.txt";
+	std::remove(path.c_str());
+	Log::Options options;
+	options.path = path;
+	options.ringBytes = 256;
+	options.timestamps = false;
+	Log::configure(options);
+
+	std::string expected;
+	for (int64_t i = 0; i < 400; ++i) {
+		const std::string n = std::to_string(i);
+		switch (i / 7 % 4) {
+		case 0:
+			Log::print("none");
+			expected += "none\n";
+			break;
+		case 1:
+			Log::print("one {}", i);
+			expected += "one " + n + "\n";
+			break;
+		case 2:
+			Log::print("two {} {}", i, i);
+			expected += "two " + n + " " + n + "\n";
+			break;
+		default:
+			Log::print("three {} {} {}", i, i, i);
+			expected += "three " + n + " " + n + " " + n + "\n";
+		}
+		Log::flush();
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	const std::string written((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	check(written == expected, "every record written once, in order, across wraps");
+	file.close();
+	std::remove(path.c_str());
+}
+
+
+//==============================================================
+//	5. Regex: against std::regex, and anchors with alternation
+//==============================================================
+
+void testRegex()
+{
+	const char* patterns[] = {
+		"abc", "a|b", "^ab", "ab$", "^(a|b)", "(a|b)$", "^(ab|c)$", "a*b", "(ab)+c?", "[a-c]{2,3}",
+		"x(a|b)|c", "^a.*b$", "[^ab]+", "a{0,2}b{1,}", "(a|ab)(c|bcd)", "\\d+-\\w", "^$",
+	};
+	const char* texts[] = { "", "a", "b", "c", "ab", "ba", "cb", "ac", "abc", "xab", "aab", "abcd", "bcbc", "xbx", "12-a", "zzz" };
+	for (const char* p : patterns) {
+		Regex::Pattern pattern(p);
+		const std::regex reference(p);
+		for (const char* t : texts) {
+			char what[96];
+			std::snprintf(what, sizeof what, "search(\"%s\", \"%s\") agrees with std::regex_search", t, p);
+			check(Regex::search(t, pattern) == std::regex_search(t, reference), what);
+		}
+	}
+
+	static constexpr char grouped[] = "^(ERROR|WARN) ";
+	check(Regex::Compiled<grouped>::search("WARN disk") && !Regex::Compiled<grouped>::search("x WARN disk"), "Compiled ^(a|b) anchors both alternatives");
+
+//  ^ and $ are whole-pattern flags, so a top-level | next to them is rejected
+	for (const char* p : { "^a|b", "a|b$", "x|^a" }) {
+		bool threw = false;
+		try {
+			Regex::Pattern pattern(p);
+		}
+		catch (const std::invalid_argument&) {
+			threw = true;
+		}
+		char what[64];
+		std::snprintf(what, sizeof what, "Pattern(\"%s\") is rejected", p);
+		check(threw, what);
+	}
+}
+
+
+//==============================================================
+//	6. Wrappers: function_ref and Buffer::emplaceWith
+//==============================================================
+
+static int square(int x) { return x * x; }
+
+//  T() may throw, so emplaceWith builds into a temporary first
+struct Throwing
+{
+	std::string text;
+	Throwing() noexcept(false) {}
+	explicit Throwing(std::string value) : text(std::move(value)) {}
+};
+
+void testWrappers()
+{
+//  the pointer &square is a temporary: function_ref must keep its value
+	function_ref<int(int)> fromPointer = &square;
+	function_ref<int(int)> fromFunction = square;
+	int (*const named)(int) = &square;
+	function_ref<int(int)> fromNamed = named;
+	check(fromPointer(7) == 49 && fromFunction(3) == 9 && fromNamed(4) == 16, "function_ref to a function pointer");
+
+	small_function<int(int)> copyable = [k = 3](int x) { return x + k; };
+	small_function<int(int)> copy = copyable;
+	check(copy(1) == 4, "small_function copy");
+
+	Buffer<std::string> strings("strings", 4);
+	strings.emplace(1, "kept");
+	bool threw = false;
+	try {
+		strings.emplaceWith(1, []() -> std::string { throw std::runtime_error("make"); });
+	}
+	catch (const std::runtime_error&) {
+		threw = true;
+	}
+	check(threw && strings[1].empty(), "emplaceWith leaves a default T when make() throws");
+	strings.emplace(1, "again");
+	check(strings[1] == "again", "emplace after a failed emplaceWith");
+
+	Buffer<Throwing> throwing("throwing", 2);
+	throwing.emplace(0, "kept");
+	threw = false;
+	try {
+		throwing.emplaceWith(0, []() -> Throwing { throw std::runtime_error("make"); });
+	}
+	catch (const std::runtime_error&) {
+		threw = true;
+	}
+	check(threw && throwing[0].text == "kept", "emplaceWith keeps the element when make() throws and T() may throw");
+	check(throwing.emplace(0, "again").text == "again", "emplace of a T whose T() may throw");
+}
+
+
+//==============================================================
+//	7. Metrics, Incremental and Rcu
+//==============================================================
+
+void testMetrics()
+{
+	Metrics::Registry registry;
+	Metrics::Counter& served = registry.counter("tests_served_total", "Served");
+	Metrics::Histogram& latency = registry.histogram("tests_latency_ns", "Latency");
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+		threads.emplace_back([&] {
+			for (int i = 0; i < 10000; ++i) {
+				served.add();
+				latency.record(static_cast<uint64_t>(i));
+			}
+		});
+	for (std::thread& thread : threads)
+		thread.join();
+	check(served.value() == 40000 && latency.snapshot().count == 40000, "sharded counts add up");
+
+	const std::string path = "tests-metrics.prom";
+	registry.writeFile(path);
+	std::ifstream file(path);
+	const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	check(text.find("tests_served_total 40000") != std::string::npos, "writeFile exports the counter");
+	check(!std::ifstream(path + ".tmp").good(), "writeFile leaves no temporary");
+	file.close();
+	std::remove(path.c_str());
+}
+
+void testIncremental()
+{
+	Incremental::Graph graph;
+	auto price = graph.input("price", 10.0);
+	auto count = graph.input("count", 3);
+	auto total = graph.node("total", [](double p, int n) { return p * n; }, price, count);
+	auto positive = graph.node("positive", [](double t) { return t > 0; }, total);
+	auto label = graph.node("label", [](bool p) { return p ? 1 : -1; }, positive);
+
+	check(label.get() == 1 && graph.computations() == 3, "first get() computes every node");
+	price.set(11.0);
+	check(label.get() == 1 && graph.computations() == 5, "early cutoff: label not recomputed");
+	count.set(3);
+	check(!total.stale(), "setting an equal value invalidates nothing");
+	price.set(-1.0);
+	graph.evaluate();
+	check(!label.stale() && label.get() == -1 && total.get() == -3.0, "evaluate() refreshes every stale node");
+}
+
+void testRcu()
+{
+	struct Version
+	{
+		int values[8] = {};
+	};
+	Rcu::Cell<Version> cell;
+	std::atomic<bool> done{ false };
+	std::atomic<int> torn{ 0 };
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 3; ++t)
+		readers.emplace_back([&] {
+			while (!done.load(std::memory_order_relaxed))
+				cell.read([&](const Version& v) {
+					for (int x : v.values)
+						if (x != v.values[0])
+							torn.fetch_add(1);
+				});
+		});
+	for (int i = 1; i <= 5000; ++i) {
+		if (i % 2 != 0) {
+			Version next;
+			std::fill(std::begin(next.values), std::end(next.values), i);
+			cell.publish(next);
+		}
+		else
+			cell.update([i](Version& v) { std::fill(std::begin(v.values), std::end(v.values), i); });
+	}
+	done.store(true);
+	for (std::thread& reader : readers)
+		reader.join();
+	check(torn.load() == 0, "readers see whole versions only");
+	check(cell.read([](const Version& v) { return v.values[7]; }) == 5000, "the last version published is current");
+	Rcu::synchronize();
+	check(Rcu::reclaim() == 0, "synchronize() reclaims every retired version");
+}
+
+
+//==============================================================
+//	8. small_string and SymbolTable against std::string
+//==============================================================
+
+//  Random assignments, appends and clears, checking every step against a
+//  std::string. Lengths cross the inline capacity both ways.
+template <size_t Bytes>
+void checkSmallString(const char* name)
+{
+	std::mt19937 rng(43);
+	basic_small_string<Bytes> s;
+	std::string reference;
+	bool same = true;
+	for (int step = 0; step < 20000 && same; ++step) {
+		const std::string text(rng() % 3 == 0 ? rng() % 300 : rng() % 40, static_cast<char>('a' + rng() % 26));
+		switch (rng() % 6) {
+		case 0:
+			s = text;
+			reference = text;
+			break;
+		case 1:
+		case 2:
+			s += text;
+			reference += text;
+			break;
+		case 3:
+			s.push_back('x');
+			reference.push_back('x');
+			break;
+		case 4: {
+			basic_small_string<Bytes> copy(s);
+			s = std::move(copy);
+			break;
+		}
+		default:
+			if (rng() % 4 == 0) {
+				s.clear();
+				reference.clear();
+			}
+		}
+		same = std::string_view(s) == reference && s.size() == reference.size() && s.c_str()[s.size()] == '\0' && s.capacity() >= s.size();
+	}
+	check(same, name);
+}
+
+void testSmallString()
+{
+	checkSmallString<3 * sizeof(size_t)>("basic_small_string of three words matches std::string");
+	checkSmallString<32>("small_string matches std::string");
+	checkSmallString<64>("basic_small_string<64> matches std::string");
+
+//  three words: the heap flag byte used to overwrite the capacity
+	basic_small_string<3 * sizeof(size_t)> compact(std::string(30, 'a'));
+	compact = std::string(200, 'b');
+	compact.append(std::string(100, 'c'));
+	check(compact.size() == 300 && compact.capacity() >= 300 && compact[299] == 'c', "three-word string reallocates past its capacity");
+
+	std::vector<std::string> words;
+	std::vector<Symbol> symbols;
+	for (int i = 0; i < 5000; ++i) {
+		words.push_back("word" + std::to_string(i % 1500));
+		symbols.push_back(Symbol(words.back()));
+	}
+	bool consistent = true;
+	for (size_t i = 0; i < words.size(); ++i)
+		consistent = consistent && symbols[i].view() == words[i] && (symbols[i] == symbols[i % 1500]) && SymbolTable::instance().find(words[i]) == symbols[i];
+	check(consistent, "Symbol interns equal text to one id and keeps the text");
+}
+
+
+//==============================================================
+//	9. btree_map against std::map
+//==============================================================
+
+//  Random inserts, erases and searches, checking every result and then the
+//  whole contents against a std::map.
+template <typename K, size_t NodeBytes>
+void checkBTree(const char* name, const std::vector<K>& keys)
+{
+	std::mt19937 rng(40);
+	btree_map<K, int, std::less<K>, NodeBytes> tree;
+	std::map<K, int> reference;
+	bool same = true;
+	for (int step = 0; step < 40000 && same; ++step) {
+		const K key = keys[rng() % keys.size()];
+		switch (rng() % 4) {
+		case 0:
+		case 1:
+			same = tree.insert(key, step).second == reference.insert({ key, step }).second;
+			break;
+		case 2:
+			same = tree.erase(key) == reference.erase(key);
+			break;
+		default: {
+			const auto it = tree.lower_bound(key);
+			const auto expected = reference.lower_bound(key);
+			same = expected == reference.end() ? it == tree.end() : it != tree.end() && it->first == expected->first && it->second == expected->second;
+			same = same && (tree.find(key) != tree.end()) == (reference.count(key) == 1);
+		}
+		}
+	}
+	same = same && tree.size() == reference.size() && std::equal(reference.begin(), reference.end(), tree.begin(), tree.end(), [](const auto& a, const auto& b) { return a.first == b.first && a.second == b.second; });
+	check(same, name);
+}
+
+void testBTree()
+{
+	std::vector<int> ints;
+	for (int i = -3000; i < 3000; ++i)
+		ints.push_back(i * 7);
+	ints.push_back(std::numeric_limits<int>::min());
+	ints.push_back(std::numeric_limits<int>::max());
+	checkBTree<int, 512>("btree_map<int> matches std::map", ints);
+	checkBTree<int, 4096>("btree_map<int> with page nodes matches std::map", ints);
+
+	std::vector<double> doubles;
+	for (int i = -3000; i < 3000; ++i)
+		doubles.push_back(i * 0.25);
+	doubles.push_back(std::numeric_limits<double>::max());
+	doubles.push_back(std::numeric_limits<double>::infinity());
+	doubles.push_back(-std::numeric_limits<double>::infinity());
+	checkBTree<double, 512>("btree_map<double> with infinite keys matches std::map", doubles);
+
+	std::vector<std::string> strings;
+	for (int i = 0; i < 3000; ++i)
+		strings.push_back(std::to_string(i * 13));
+	checkBTree<std::string, 512>("btree_map<std::string> matches std::map", strings);
+
+//  a node of one key: the padding must not hide an infinite key
+	btree_map<float, int> sparse;
+	sparse.insert(std::numeric_limits<float>::infinity(), 1);
+	sparse.insert(1.0f, 2);
+	check(sparse.find(std::numeric_limits<float>::infinity()) != sparse.end() && sparse.lower_bound(2.0f)->second == 1, "btree_map<float> finds an infinite key");
+
+	bool rejected = false;
+	try {
+		sparse.insert(std::numeric_limits<float>::quiet_NaN(), 3);
+	}
+	catch (const std::invalid_argument&) {
+		rejected = true;
+	}
+	check(rejected && sparse.size() == 2 && sparse.find(std::numeric_limits<float>::quiet_NaN()) == sparse.end(), "btree_map<float> rejects NaN keys");
+}
+
+
+//==============================================================
+//	10. flat_map against std::map
+//==============================================================
+
+void testFlatMap()
+{
+	using Key = std::tuple<int, int, int>;
+	std::mt19937 rng(39);
+	std::vector<std::pair<Key, int>> entries;
+	for (int i = 0; i < 3000; ++i)
+		entries.push_back({ Key(rng() % 20, rng() % 20, rng() % 20), i });
+	flat_map<Key, int> map(entries);
+	std::map<Key, int> reference;
+	for (const auto& entry : entries)
+		reference[entry.first] = entry.second;  // the last entry wins, as in the bulk build
+
+	bool same = true;
+	for (int step = 0; step < 20000 && same; ++step) {
+		const Key key(rng() % 22, rng() % 22, rng() % 22);
+		switch (rng() % 4) {
+		case 0:
+			same = map.insert(key, step).second == reference.insert({ key, step }).second;
+			break;
+		case 1:
+			same = map.erase(key) == (reference.erase(key) == 1);
+			break;
+		case 2: {
+			const auto it = map.lower_bound(key);
+			const auto expected = reference.lower_bound(key);
+			same = expected == reference.end() ? it == map.end() : it != map.end() && it.key() == expected->first && it.value() == expected->second;
+			break;
+		}
+		default: {
+			const int a = std::get<0>(key), b = std::get<1>(key);
+			const auto run = map.prefix(a, b);
+			const auto expected = std::distance(reference.lower_bound(Key(a, b, std::numeric_limits<int>::min())), reference.upper_bound(Key(a, b, std::numeric_limits<int>::max())));
+			same = static_cast<std::ptrdiff_t>(run.size()) == expected && std::all_of(run.begin(), run.end(), [&](const auto& entry) { return std::get<0>(entry.first) == a && std::get<1>(entry.first) == b; });
+			same = same && map.prefix(a).size() == static_cast<size_t>(std::distance(reference.lower_bound(Key(a, std::numeric_limits<int>::min(), 0)), reference.lower_bound(Key(a + 1, std::numeric_limits<int>::min(), 0))));
+		}
+		}
+	}
+	same = same && map.size() == reference.size() && std::equal(reference.begin(), reference.end(), map.begin(), map.end(), [](const auto& a, const auto& b) { return a.first == b.first && a.second == b.second; });
+	check(same, "flat_map with tuple keys matches std::map, prefixes included");
+
+	flat_map<int, int, std::greater<int>> descending({ { 1, 10 }, { 3, 30 }, { 2, 20 } });
+	check(descending.keys() == std::vector<int>{ 3, 2, 1 } && descending.at(2) == 20 && descending.find(4) == descending.end(), "flat_map follows its Compare");
+}
+
+
+//==============================================================
+//	11. Parallel algorithms against the serial std:: ones
+//==============================================================
+
+//  Sizes on both sides of serialCutoff, odd so chunks are uneven.
+void testParallel()
+{
+	std::mt19937_64 rng(32);
+	for (unsigned threads : { 1u, 2u, 3u, 8u }) {
+		ThreadPool pool(threads);
+		for (size_t n : { size_t{ 0 }, size_t{ 1 }, size_t{ 1000 }, Parallel::serialCutoff + 1, size_t{ 200003 } }) {
+			std::vector<int64_t> ints(n);
+			std::vector<double> doubles(n);
+			std::vector<uint32_t> small(n);
+			for (size_t i = 0; i < n; ++i) {
+				ints[i] = static_cast<int64_t>(rng());
+				doubles[i] = static_cast<double>(static_cast<int64_t>(rng() >> 20) - (int64_t{ 1 } << 43)) * 0.125;
+				small[i] = static_cast<uint32_t>(rng() % 1000);  // many equal keys and shared high bytes
+			}
+			char what[96];
+
+			std::vector<int64_t> sorted = ints, expected = ints;
+			Parallel::sort(sorted.begin(), sorted.end(), std::less<>(), pool);
+			std::sort(expected.begin(), expected.end());
+			std::snprintf(what, sizeof what, "sort of %zu on %u threads", n, threads);
+			check(sorted == expected, what);
+
+			std::vector<int64_t> radixInts = ints;
+			Parallel::radixSort(radixInts.data(), radixInts.data() + n, pool);
+			std::vector<double> radixDoubles = doubles, expectedDoubles = doubles;
+			Parallel::radixSort(radixDoubles.data(), radixDoubles.data() + n, pool);
+			std::sort(expectedDoubles.begin(), expectedDoubles.end());
+			std::vector<uint32_t> radixSmall = small, expectedSmall = small;
+			Parallel::radixSort(radixSmall.data(), radixSmall.data() + n, pool);
+			std::sort(expectedSmall.begin(), expectedSmall.end());
+			std::snprintf(what, sizeof what, "radixSort of %zu on %u threads", n, threads);
+			check(radixInts == expected && radixDoubles == expectedDoubles && radixSmall == expectedSmall, what);
+
+			std::vector<int64_t> transformed(n), expectedTransformed(n);
+			const auto twice = [](int64_t x) { return x / 3 * 2; };
+			Parallel::transform(ints.begin(), ints.end(), transformed.begin(), twice, pool);
+			std::transform(ints.begin(), ints.end(), expectedTransformed.begin(), twice);
+			std::snprintf(what, sizeof what, "transform of %zu on %u threads", n, threads);
+			check(transformed == expectedTransformed, what);
+
+			std::vector<uint32_t> scanned(n), expectedScanned(n);
+			Parallel::inclusiveScan(small.begin(), small.end(), scanned.begin(), std::plus<>(), pool);
+			std::inclusive_scan(small.begin(), small.end(), expectedScanned.begin());
+			std::snprintf(what, sizeof what, "inclusiveScan of %zu on %u threads", n, threads);
+			check(scanned == expectedScanned, what);
+		}
+	}
+}
+
+
+//==============================================================
+//	12. enum_map and enum_set against std::map and std::set
+//==============================================================
+
+//  dense, found by reflection
+enum class Channel : int { Low = -3, Mid, High, Max };
+//  sparse: a perfect hash over the listed values
+enum class Mask : uint32_t { Red = 0xff0000, Green = 0xff00, Blue = 0xff, Alpha = 0xff000000 };
+using MaskValues = Enums::values<Mask::Red, Mask::Green, Mask::Blue, Mask::Alpha>;
+
+template <typename E, typename Traits>
+void checkEnumMap(const char* name, const std::vector<E>& keys)
+{
+	std::mt19937 rng(37);
+	enum_map<E, int, Traits> map;
+	enum_set<E, Traits> set;
+	std::map<E, int> reference;
+	std::set<E> referenceSet;
+	for (E key : keys)
+		reference[key] = 0;
+	bool same = map.size() == keys.size();
+	for (int step = 0; step < 2000 && same; ++step) {
+		const E key = keys[rng() % keys.size()];
+		map[key] += step;
+		reference[key] += step;
+		if (rng() % 2) {
+			set.insert(key);
+			referenceSet.insert(key);
+		}
+		else {
+			set.erase(key);
+			referenceSet.erase(key);
+		}
+		same = map.at(key) == reference[key] && set.contains(key) == (referenceSet.count(key) == 1) && set.size() == referenceSet.size();
+	}
+	same = same && std::equal(reference.begin(), reference.end(), map.begin(), map.end(), [](const auto& a, const auto& b) { return a.first == b.first && a.second == b.second; });
+	same = same && std::equal(referenceSet.begin(), referenceSet.end(), set.begin(), set.end());
+	check(same, name);
+}
+
+void testEnumMap()
+{
+	checkEnumMap<Channel, enum_traits<Channel>>("enum_map of a reflected enum matches std::map", { Channel::Low, Channel::Mid, Channel::High, Channel::Max });
+	checkEnumMap<Mask, MaskValues>("enum_map of a sparse enum matches std::map", { Mask::Red, Mask::Green, Mask::Blue, Mask::Alpha });
+
+	bool threw = false;
+	try {
+		enum_map<Mask, int, MaskValues>().at(static_cast<Mask>(0x1234));
+	}
+	catch (const std::out_of_range&) {
+		threw = true;
+	}
+	check(threw && !enum_set<Mask, MaskValues>::all().contains(static_cast<Mask>(0x1234)), "values outside the enumerators are rejected");
+}
+
+
+//==============================================================
+//	13. Expression templates against element-wise loops
+//==============================================================
+
+void testExpr()
+{
+	using namespace Expr::Operators;
+	std::mt19937_64 rng(36);
+	bool same = true, summed = true;
+	for (size_t n : { size_t{ 0 }, size_t{ 1 }, size_t{ 7 }, size_t{ 8 }, size_t{ 1001 } }) {
+		std::vector<int64_t> a(n), b(n), c(n);
+		for (size_t i = 0; i < n; ++i) {
+			a[i] = static_cast<int64_t>(rng() % 2001) - 1000;
+			b[i] = static_cast<int64_t>(rng() % 2001) - 1000;
+			c[i] = static_cast<int64_t>(rng() % 2001) - 1000;
+		}
+		std::vector<int64_t> expected(n);
+		for (size_t i = 0; i < n; ++i)
+			expected[i] = a[i] + b[i] * c[i] - 3 * a[i];
+
+		const std::vector<int64_t> r = a + b * c - 3 * a;
+		same = same && r == expected;
+
+	//  in place: r = r * 2 + a reads element i before writing it
+		std::vector<int64_t> inPlace = expected;
+		Expr::assign(inPlace, inPlace * 2 + a);
+		for (size_t i = 0; i < n; ++i)
+			expected[i] = expected[i] * 2 + a[i];
+		same = same && inPlace == expected;
+
+	//  shifted: the destination overlaps the operand one element off
+		if (n > 1) {
+			std::vector<int64_t> shifted = a;
+			Expr::assign(shifted, Expr::view(shifted.data() + 1, n - 1) + 1);
+			std::vector<int64_t> expectedShifted(a.begin() + 1, a.end());
+			for (int64_t& x : expectedShifted)
+				x += 1;
+			same = same && shifted == expectedShifted;
+		}
+
+		summed = summed && Expr::sum(a * b) == std::inner_product(a.begin(), a.end(), b.begin(), int64_t{ 0 });
+	}
+	check(same, "expressions match element-wise loops, in place and overlapping");
+	check(summed, "Expr::sum matches std::inner_product");
+}
+
+
+//==============================================================
+//	14. Units: column conversion against the arithmetic
+//==============================================================
+
+void testUnits()
+{
+	std::mt19937_64 rng(38);
+	const size_t n = 1003;
+	std::vector<double> celsius(n), fahrenheit(n), kilometers(n), meters(n);
+	std::vector<int64_t> kibibytes(n), bytes(n);
+	for (size_t i = 0; i < n; ++i) {
+		celsius[i] = static_cast<double>(rng() % 4001) * 0.1 - 200;
+		kilometers[i] = static_cast<double>(rng() % 100000) * 0.01;
+		kibibytes[i] = static_cast<int64_t>(rng() % 1000000);
+	}
+	Units::convertColumn<Units::Fahrenheit, Units::Celsius>(celsius.data(), fahrenheit.data(), n);
+	Units::convertColumn<Units::Meters, Units::Kilometers>(kilometers.data(), meters.data(), n);
+	Units::convertColumn<Units::Bytes, Units::Kibibytes>(kibibytes.data(), bytes.data(), n);
+
+	bool close = true, exact = true;
+	for (size_t i = 0; i < n; ++i) {
+		close = close && std::fabs(fahrenheit[i] - (celsius[i] * 9 / 5 + 32)) < 1e-9 && std::fabs(meters[i] - kilometers[i] * 1000) < 1e-9;
+		close = close && fahrenheit[i] == Units::quantityCast<Units::Fahrenheit>(Units::Celsius(celsius[i])).count();
+		exact = exact && bytes[i] == kibibytes[i] * 1024;
+	}
+	check(close, "convertColumn matches the conversion formulas and quantityCast");
+	check(exact, "integer convertColumn is exact");
+}
+
+
+//==============================================================
+//	15. Parse and Format against std::from_chars and std::to_chars
+//==============================================================
+
+template <typename T>
+bool roundTrips(T value)
+{
+	char ours[Format::maxChars], theirs[Format::maxChars];
+	char* end = Format::toChars(ours, value);
+	const std::string_view text(ours, static_cast<size_t>(end - ours));
+	if (text != std::string_view(theirs, static_cast<size_t>(std::to_chars(theirs, theirs + sizeof theirs, value).ptr - theirs)))
+		return false;
+
+	T parsed{}, expected{};
+	const auto r = Parse::fromChars(text.data(), text.data() + text.size(), parsed);
+	const auto e = std::from_chars(text.data(), text.data() + text.size(), expected);
+	return r.ec == e.ec && r.ptr == e.ptr && parsed == expected && parsed == value;
+}
+
+//  Malformed and out-of-range text gives the same result and end as std.
+template <typename T>
+bool parsesLikeStd(const std::string& text)
+{
+	T parsed = 7, expected = 7;
+	const auto r = Parse::fromChars(text.data(), text.data() + text.size(), parsed);
+	const auto e = std::from_chars(text.data(), text.data() + text.size(), expected);
+	return r.ec == e.ec && r.ptr == e.ptr && parsed == expected;
+}
+
+void testParse()
+{
+	std::mt19937_64 rng(42);
+	bool integers = true, floats = true;
+	for (int i = 0; i < 20000; ++i) {
+		const uint64_t bits = rng();
+		const int shift = static_cast<int>(rng() % 64);
+		integers = integers && roundTrips(static_cast<int64_t>(bits) >> shift) && roundTrips(bits >> shift) &&
+			roundTrips(static_cast<int32_t>(bits >> shift)) && roundTrips(static_cast<uint16_t>(bits));
+		double d;
+		std::memcpy(&d, &bits, sizeof d);
+		if (std::isfinite(d))
+			floats = floats && roundTrips(d) && roundTrips(static_cast<float>(d * 1e-300));
+	}
+	for (int64_t edge : { std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(), int64_t{ 0 }, int64_t{ -1 } })
+		integers = integers && roundTrips(edge);
+	check(integers, "integer toChars and fromChars match std::to_chars and std::from_chars");
+	check(floats, "floating-point toChars and fromChars round-trip like std");
+
+	bool errors = true;
+	for (const char* text : { "", "-", "+1", " 1", "x", "12x", "-0", "0000000000000000000000012", "9223372036854775807", "9223372036854775808",
+		"-9223372036854775808", "-9223372036854775809", "18446744073709551616", "123456789012345678901234567890", "1234567_" })
+		errors = errors && parsesLikeStd<int64_t>(text) && parsesLikeStd<uint64_t>(text) && parsesLikeStd<int8_t>(text) && parsesLikeStd<uint32_t>(text);
+	check(errors, "malformed and out-of-range integers are reported like std::from_chars");
+
+	Buffer<int64_t> column("column", 0);
+	const auto parsed = Parse::parseColumn("1,-22\r\n333\n4444,55555", column);
+	check(parsed.ec == std::errc() && parsed.count == 5 && column[0] == 1 && column[1] == -22 && column[4] == 55555, "parseColumn splits on separators and line breaks");
+}
+
+
+//==============================================================
+//	Driver
+//==============================================================
+
+struct TestEntry
+{
+	const char* name;
+	void (*run)();
+};
+
+const TestEntry tests[] = {
+	{ "kernels", testKernels },
+	{ "fft", testFft },
+	{ "random", testRandom },
+	{ "log", testLog },
+	{ "regex", testRegex },
+	{ "wrappers", testWrappers },
+	{ "metrics", testMetrics },
+	{ "incremental", testIncremental },
+	{ "rcu", testRcu },
+	{ "smallstring", testSmallString },
+	{ "btree", testBTree },
+	{ "flatmap", testFlatMap },
+	{ "parallel", testParallel },
+	{ "enummap", testEnumMap },
+	{ "expr", testExpr },
+	{ "units", testUnits },
+	{ "parse", testParse },
+};
+
+int main(int argc, char* argv[])
+{
+	const char* filter = argc > 1 ? argv[1] : "";
+
+	for (const auto& t : tests) {
+		if (std::strstr(t.name, filter) == nullptr)
+			continue;
+
+		const int before = failures;
+		std::printf("[%s]\n", t.name);
+		t.run();
+		std::printf("  %s\n", failures == before ? "ok" : "FAILED");
+	}
+	return failures == 0 ? 0 : 1;
+}
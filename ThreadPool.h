@@ -0,0 +1,153 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "SmallFunction.h"
+
+//==============================================================
+//	Fork-join task scheduler
+//==============================================================
+//	A fixed set of worker threads (see std::thread in
+//	C++11LibraryFeatures.cpp) draining one task queue. A thread waiting on a
+//	TaskGroup runs queued tasks itself instead of blocking, so nested
+//	parallelism (a parallel sort inside a parallel task) cannot deadlock.
+
+class ThreadPool
+{
+public:
+	using Task = small_move_function<void(), 6 * sizeof(void*)>;
+
+//  threads counts the caller too: ThreadPool(1) runs everything inline.
+	explicit ThreadPool(unsigned threads = std::max(1u, std::thread::hardware_concurrency()))
+	{
+		for (unsigned i = 1; i < threads; ++i)
+			_workers.emplace_back([this] { workerLoop(); });
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			_stopping = true;
+		}
+		_wake.notify_all();
+		for (auto& worker : _workers)
+			worker.join();
+	}
+
+	unsigned size() const { return static_cast<unsigned>(_workers.size()) + 1; }
+
+	void submit(Task task)
+	{
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			_tasks.push_back(std::move(task));
+		}
+		_wake.notify_one();
+	}
+
+//  Runs one queued task on the calling thread; false if the queue was empty.
+	bool runOne()
+	{
+		Task task;
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			if (_tasks.empty())
+				return false;
+			task = std::move(_tasks.back());
+			_tasks.pop_back();
+		}
+		task();
+		return true;
+	}
+
+//  Process-wide pool sized to the hardware.
+	static ThreadPool& instance()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+
+private:
+	void workerLoop()
+	{
+		for (;;) {
+			Task task;
+			{
+				std::unique_lock<std::mutex> guard(_lock);
+				_wake.wait(guard, [this] { return _stopping || !_tasks.empty(); });
+				if (_tasks.empty())
+					return;
+				task = std::move(_tasks.front());
+				_tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	std::mutex               _lock;
+	std::condition_variable  _wake;
+	std::deque<Task>         _tasks;
+	std::vector<std::thread> _workers;
+	bool                     _stopping = false;
+};
+
+//  Tasks forked from one scope. wait() helps run queued work and rethrows
+//  the first exception any task threw.
+class TaskGroup
+{
+public:
+	explicit TaskGroup(ThreadPool& pool = ThreadPool::instance()) : _pool(pool) {}
+
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+
+	~TaskGroup()
+	{
+		while (_pending.load(std::memory_order_acquire) != 0)
+			if (!_pool.runOne())
+				std::this_thread::yield();
+	}
+
+	template <typename F>
+	void run(F f)
+	{
+		_pending.fetch_add(1, std::memory_order_relaxed);
+		_pool.submit([this, f = std::move(f)]() mutable {
+			try {
+				f();
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> guard(_errorLock);
+				if (!_error)
+					_error = std::current_exception();
+			}
+			_pending.fetch_sub(1, std::memory_order_release);
+		});
+	}
+
+	void wait()
+	{
+		while (_pending.load(std::memory_order_acquire) != 0)
+			if (!_pool.runOne())
+				std::this_thread::yield();
+
+		if (_error)
+			std::rethrow_exception(std::exchange(_error, nullptr));
+	}
+
+private:
+	ThreadPool&         _pool;
+	std::atomic<size_t> _pending{ 0 };
+	std::mutex          _errorLock;
+	std::exception_ptr  _error;
+};
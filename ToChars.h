@@ -0,0 +1,148 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include "Buffer.h"
+
+//==============================================================
+//	Allocation-free number formatting
+//==============================================================
+//	std::to_string allocates a std::string per call and goes through the
+//	locale-aware printf machinery. These functions write straight into a
+//	caller-provided buffer or a Buffer<char> and never allocate.
+
+namespace Format {
+
+//  Room for any 64-bit integer or shortest round-trip double, sign included.
+	constexpr size_t maxChars = 32;
+
+	namespace detail {
+		constexpr char digitPairs[201] =
+			"00010203040506070809"
+			"10111213141516171819"
+			"20212223242526272829"
+			"30313233343536373839"
+			"40414243444546474849"
+			"50515253545556575859"
+			"60616263646566676869"
+			"70717273747576777879"
+			"80818283848586878889"
+			"90919293949596979899";
+
+		inline unsigned countDigits(uint64_t v)
+		{
+			for (unsigned n = 1;; n += 4) {
+				if (v < 10) return n;
+				if (v < 100) return n + 1;
+				if (v < 1000) return n + 2;
+				if (v < 10000) return n + 3;
+				v /= 10000;
+			}
+		}
+
+	//  Writes v backwards so that its last digit lands at end[-1].
+		inline void writeDigits(char* end, uint64_t v)
+		{
+			while (v >= 100) {
+				const size_t i = static_cast<size_t>(v % 100) * 2;
+				v /= 100;
+				end -= 2;
+				std::memcpy(end, digitPairs + i, 2);
+			}
+
+			if (v >= 10) {
+				end -= 2;
+				std::memcpy(end, digitPairs + v * 2, 2);
+			}
+			else {
+				*--end = static_cast<char>('0' + v);
+			}
+		}
+
+		template <typename T>
+		char* toCharsFloat(char* first, T value)
+		{
+#if defined(__cpp_lib_to_chars) || defined(_MSC_VER)
+		//  Both libstdc++ and the MSVC STL implement shortest round-trip with Ryu.
+			return std::to_chars(first, first + maxChars, value).ptr;
+#else
+		//  Fallback: smallest precision that reads back to the same value.
+			constexpr int maxDigits = std::is_same<T, float>::value ? 9 : 17;
+			int n = 0;
+			for (int precision = 1; precision <= maxDigits; ++precision) {
+				n = std::snprintf(first, maxChars, "%.*g", precision, static_cast<double>(value));
+				if (static_cast<T>(std::strtod(first, nullptr)) == value)
+					break;
+			}
+			return first + n;
+#endif
+		}
+	}
+
+//  Writes value at first and returns one past the last character written.
+//  The caller guarantees maxChars bytes of room; nothing is null-terminated.
+	template <typename T>
+	typename std::enable_if<std::is_integral<T>::value, char*>::type
+	toChars(char* first, T value)
+	{
+		using U = typename std::make_unsigned<T>::type;
+		uint64_t u = static_cast<U>(value);
+		if (value < 0) {
+			*first++ = '-';
+			u = 0 - static_cast<uint64_t>(static_cast<int64_t>(value));
+		}
+
+		char* last = first + detail::countDigits(u);
+		detail::writeDigits(last, u);
+		return last;
+	}
+
+	inline char* toChars(char* first, double value) { return detail::toCharsFloat(first, value); }
+	inline char* toChars(char* first, float value) { return detail::toCharsFloat(first, value); }
+
+//  Bounds-checked form with the std::to_chars contract.
+	template <typename T>
+	std::to_chars_result toChars(char* first, char* last, T value)
+	{
+		char scratch[maxChars];
+		char* end = toChars(scratch, value);
+		const size_t n = static_cast<size_t>(end - scratch);
+		if (static_cast<size_t>(last - first) < n)
+			return { last, std::errc::value_too_large };
+
+		std::memcpy(first, scratch, n);
+		return { first + n, std::errc() };
+	}
+
+//  Appends value to out at offset pos, growing out if needed.
+//  Returns the offset one past the written text.
+	template <typename T>
+	size_t toChars(Buffer<char>& out, size_t pos, T value)
+	{
+		if (out.size() < pos + maxChars)
+			out.resize((pos + maxChars) * 2);
+
+		return static_cast<size_t>(toChars(out.data() + pos, value) - out.data());
+	}
+
+//  Formats count values into one contiguous run, each followed by separator.
+//  Sizes out once up front; returns the number of bytes written.
+	template <typename T>
+	size_t toCharsBatch(const T* values, size_t count, Buffer<char>& out, char separator = '\n')
+	{
+		const size_t bound = count * (maxChars + 1);
+		if (out.size() < bound)
+			out.resize(bound);
+
+		char* first = out.data();
+		char* p = first;
+		for (size_t i = 0; i < count; ++i) {
+			p = toChars(p, values[i]);
+			*p++ = separator;
+		}
+		return static_cast<size_t>(p - first);
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//==============================================================
+//	Performance type traits
+//==============================================================
+//	Properties the standard traits cannot see, used by Buffer<T> to choose
+//	bulk byte operations over per-element loops:
+//
+//	  is_trivially_relocatable  moving a T and destroying the source equals
+//	                            copying its bytes (memcpy / realloc growth)
+//	  is_bitwise_comparable     equal values have equal bytes (memcmp, byte
+//	                            hashing); by default only integral, enum and
+//	                            pointer types, since a class may define an
+//	                            operator== that ignores some of its bytes
+//	  is_bitwise_zeroable       all-zero bytes are a valid default T (calloc)
+//
+//	User types opt in with a member alias, which also works for local
+//	classes:
+//
+//	  using trivially_relocatable = std::true_type;
+//	  using bitwise_comparable = std::true_type;
+//	  using bitwise_zeroable = std::true_type;
+//
+//	or by specializing the trait in namespace Traits. An opt-in that is not
+//	true of the type is undefined behavior, exactly like a wrong memcpy.
+
+namespace Traits {
+
+	namespace detail {
+		template <typename T, typename = void>
+		struct RelocatableTag : std::false_type {};
+		template <typename T>
+		struct RelocatableTag<T, std::void_t<typename T::trivially_relocatable>> : T::trivially_relocatable {};
+
+		template <typename T, typename = void>
+		struct ComparableTag : std::false_type {};
+		template <typename T>
+		struct ComparableTag<T, std::void_t<typename T::bitwise_comparable>> : T::bitwise_comparable {};
+
+		template <typename T, typename = void>
+		struct ZeroableTag : std::false_type {};
+		template <typename T>
+		struct ZeroableTag<T, std::void_t<typename T::bitwise_zeroable>> : T::bitwise_zeroable {};
+	}
+
+	template <typename T>
+	struct is_trivially_relocatable : std::bool_constant<detail::RelocatableTag<T>::value ||
+		(std::is_trivially_move_constructible<T>::value && std::is_trivially_destructible<T>::value)> {};
+
+//  Scalars with unique object representations: not floating point, whose
+//  +0.0 and -0.0 compare equal. Classes opt in.
+	template <typename T>
+	struct is_bitwise_comparable : std::bool_constant<detail::ComparableTag<T>::value ||
+		(std::is_scalar<T>::value && std::has_unique_object_representations<T>::value)> {};
+
+//  Null pointers to data members are not all zero bits on the Itanium ABI,
+//  so only arithmetic, enum and object pointer types qualify by default.
+	template <typename T>
+	struct is_bitwise_zeroable : std::bool_constant<detail::ZeroableTag<T>::value ||
+		std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value || std::is_null_pointer<T>::value> {};
+
+	template <typename T, size_t N>
+	struct is_bitwise_comparable<T[N]> : is_bitwise_comparable<T> {};
+
+	template <typename T, size_t N>
+	struct is_bitwise_zeroable<T[N]> : is_bitwise_zeroable<T> {};
+
+	template <typename T>
+	inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+	template <typename T>
+	inline constexpr bool is_bitwise_comparable_v = is_bitwise_comparable<T>::value;
+	template <typename T>
+	inline constexpr bool is_bitwise_zeroable_v = is_bitwise_zeroable<T>::value;
+
+//  Moves [first, first + n) into uninitialized dest and ends the lifetime of
+//  the source elements.
+	template <typename T>
+	void relocate(T* first, size_t n, T* dest)
+	{
+		if constexpr (is_trivially_relocatable_v<T>) {
+			if (n > 0)
+				std::memmove(static_cast<void*>(dest), static_cast<const void*>(first), n * sizeof(T));
+		}
+		else {
+			std::uninitialized_move(first, first + n, dest);
+			std::destroy(first, first + n);
+		}
+	}
+
+	template <typename T>
+	bool equal(const T* a, const T* b, size_t n)
+	{
+		if constexpr (is_bitwise_comparable_v<T>)
+			return n == 0 || std::memcmp(a, b, n * sizeof(T)) == 0;
+		else
+			return std::equal(a, a + n, b);
+	}
+
+	static_assert(is_trivially_relocatable_v<int> && is_trivially_relocatable_v<int*>, "trivial types relocate");
+	static_assert(!is_trivially_relocatable_v<std::unique_ptr<int>>, "opt-in only: the standard does not promise it");
+	static_assert(is_bitwise_comparable_v<long long> && !is_bitwise_comparable_v<double>, "+0.0 == -0.0 with different bytes");
+	static_assert(!is_bitwise_comparable_v<std::pair<int, int>>, "a class's operator== decides, unless it opts in");
+	static_assert(is_bitwise_zeroable_v<double[4]> && !is_bitwise_zeroable_v<int std::pair<int, int>::*>, "zero bits");
+}
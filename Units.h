@@ -0,0 +1,277 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ratio>
+#include <type_traits>
+#include "Buffer.h"
+
+//==============================================================
+//	Strongly typed units, in the style of std::chrono::duration
+//==============================================================
+//	A Quantity stores a single count. Its dimension (length, mass, ...) and its
+//	unit (a std::ratio scale plus an offset for temperatures) live in the type,
+//	so every conversion factor is folded at compile time and mixing dimensions
+//	fails to compile:
+//
+//		base value = (count + Offset) * Ratio
+
+namespace Units {
+
+//  Dimensions
+	struct Length {};
+	struct Mass {};
+	struct DataSize {};
+	struct Temperature {};
+	template <typename Dim> struct Rate {};   // Dim per second
+
+	template <typename Dim, typename Rep, typename Ratio = std::ratio<1>, typename Offset = std::ratio<0>>
+	class Quantity;
+
+	namespace detail {
+		template <typename T> struct isQuantity : std::false_type {};
+		template <typename D, typename R, typename Ra, typename O>
+		struct isQuantity<Quantity<D, R, Ra, O>> : std::true_type {};
+
+	//  to = from * Factor + Offset, both exact ratios.
+		template <typename From, typename To>
+		struct Conversion
+		{
+			using factor = std::ratio_divide<typename From::ratio, typename To::ratio>;
+			using offset = std::ratio_subtract<
+				std::ratio_multiply<typename From::offset, factor>, typename To::offset>;
+		};
+
+		template <typename From, typename To>
+		struct ComputeRep
+		{
+			using type = typename std::conditional<
+				std::is_floating_point<typename From::rep>::value || std::is_floating_point<typename To::rep>::value,
+				typename std::common_type<typename From::rep, typename To::rep, double>::type,
+				typename std::common_type<typename From::rep, typename To::rep, std::intmax_t>::type>::type;
+		};
+
+		template <typename From, typename To>
+		constexpr typename To::rep convertCount(typename From::rep count)
+		{
+			using C = Conversion<From, To>;
+			using CR = typename ComputeRep<From, To>::type;
+
+			if constexpr (std::is_floating_point<CR>::value) {
+				constexpr CR factor = static_cast<CR>(C::factor::num) / static_cast<CR>(C::factor::den);
+				constexpr CR offset = static_cast<CR>(C::offset::num) / static_cast<CR>(C::offset::den);
+				if constexpr (C::offset::num == 0)
+					return static_cast<typename To::rep>(static_cast<CR>(count) * factor);
+				else
+					return static_cast<typename To::rep>(static_cast<CR>(count) * factor + offset);
+			}
+			else {
+				static_assert(C::offset::den == 1, "fractional offset: use a floating-point rep");
+				CR v = static_cast<CR>(count);
+				if constexpr (C::factor::num != 1)
+					v *= static_cast<CR>(C::factor::num);
+				if constexpr (C::factor::den != 1)
+					v /= static_cast<CR>(C::factor::den);
+				if constexpr (C::offset::num != 0)
+					v += static_cast<CR>(C::offset::num);
+				return static_cast<typename To::rep>(v);
+			}
+		}
+	}
+
+	template <typename Dim, typename Rep, typename Ratio, typename Offset>
+	class Quantity
+	{
+		Rep _count;
+
+	public:
+		using dimension = Dim;
+		using rep = Rep;
+		using ratio = typename Ratio::type;
+		using offset = typename Offset::type;
+
+		constexpr Quantity() : _count() {}
+		constexpr explicit Quantity(Rep count) : _count(count) {}
+
+	//  Conversion between units of the same dimension is explicit and exact up
+	//  to Rep; other dimensions do not take part in overload resolution.
+		template <typename Rep2, typename Ratio2, typename Offset2>
+		constexpr explicit Quantity(const Quantity<Dim, Rep2, Ratio2, Offset2>& other) :
+			_count(detail::convertCount<Quantity<Dim, Rep2, Ratio2, Offset2>, Quantity>(other.count()))
+		{}
+
+		constexpr Rep count() const { return _count; }
+
+		constexpr Quantity operator+() const { return *this; }
+		constexpr Quantity operator-() const { return Quantity(-_count); }
+
+		constexpr Quantity& operator+=(Quantity q) { _count += q._count; return *this; }
+		constexpr Quantity& operator-=(Quantity q) { _count -= q._count; return *this; }
+		constexpr Quantity& operator*=(Rep s) { _count *= s; return *this; }
+		constexpr Quantity& operator/=(Rep s) { _count /= s; return *this; }
+
+		friend constexpr Quantity operator+(Quantity a, Quantity b) { return Quantity(a._count + b._count); }
+		friend constexpr Quantity operator-(Quantity a, Quantity b) { return Quantity(a._count - b._count); }
+		friend constexpr Quantity operator*(Quantity a, Rep s) { return Quantity(a._count * s); }
+		friend constexpr Quantity operator*(Rep s, Quantity a) { return Quantity(s * a._count); }
+		friend constexpr Quantity operator/(Quantity a, Rep s) { return Quantity(a._count / s); }
+		friend constexpr Rep operator/(Quantity a, Quantity b) { return a._count / b._count; }
+
+		friend constexpr bool operator==(Quantity a, Quantity b) { return a._count == b._count; }
+		friend constexpr bool operator!=(Quantity a, Quantity b) { return a._count != b._count; }
+		friend constexpr bool operator<(Quantity a, Quantity b) { return a._count < b._count; }
+		friend constexpr bool operator>(Quantity a, Quantity b) { return a._count > b._count; }
+		friend constexpr bool operator<=(Quantity a, Quantity b) { return a._count <= b._count; }
+		friend constexpr bool operator>=(Quantity a, Quantity b) { return a._count >= b._count; }
+	};
+
+//  Like std::chrono::duration_cast.
+	template <typename To, typename Dim, typename Rep, typename Ratio, typename Offset>
+	constexpr To quantityCast(const Quantity<Dim, Rep, Ratio, Offset>& q)
+	{
+		static_assert(detail::isQuantity<To>::value, "quantityCast target must be a Quantity");
+		static_assert(std::is_same<typename To::dimension, Dim>::value, "quantityCast: mismatched dimensions");
+		return To(detail::convertCount<Quantity<Dim, Rep, Ratio, Offset>, To>(q.count()));
+	}
+
+//  Converts to To's unit and rounds half away from zero to an integer count.
+	template <typename Int, typename To, typename Dim, typename Rep, typename Ratio, typename Offset>
+	constexpr Int roundCount(const Quantity<Dim, Rep, Ratio, Offset>& q)
+	{
+		const double v = quantityCast<Quantity<Dim, double, typename To::ratio, typename To::offset>>(q).count();
+		return static_cast<Int>(v < 0 ? v - 0.5 : v + 0.5);
+	}
+
+//  Rates: quantity per std::chrono::duration, and back.
+	template <typename Dim, typename Rep, typename Ratio, typename Rep2, typename Period>
+	constexpr auto operator/(const Quantity<Dim, Rep, Ratio>& q, const std::chrono::duration<Rep2, Period>& d)
+	{
+		using CR = typename std::common_type<Rep, Rep2>::type;
+		return Quantity<Rate<Dim>, CR, std::ratio_divide<Ratio, Period>>(
+			static_cast<CR>(q.count()) / static_cast<CR>(d.count()));
+	}
+
+	template <typename Dim, typename Rep, typename Ratio, typename Rep2, typename Period>
+	constexpr auto operator*(const Quantity<Rate<Dim>, Rep, Ratio>& r, const std::chrono::duration<Rep2, Period>& d)
+	{
+		using CR = typename std::common_type<Rep, Rep2>::type;
+		return Quantity<Dim, CR, std::ratio_multiply<Ratio, Period>>(
+			static_cast<CR>(r.count()) * static_cast<CR>(d.count()));
+	}
+
+//  Length
+	using Millimeters = Quantity<Length, double, std::milli>;
+	using Meters      = Quantity<Length, double>;
+	using Kilometers  = Quantity<Length, double, std::kilo>;
+	using Inches      = Quantity<Length, double, std::ratio<254, 10000>>;
+	using Feet        = Quantity<Length, double, std::ratio<3048, 10000>>;
+	using Miles       = Quantity<Length, double, std::ratio<1609344, 1000>>;
+
+//  Mass
+	using Grams      = Quantity<Mass, double>;
+	using Kilograms  = Quantity<Mass, double, std::kilo>;
+	using Pounds     = Quantity<Mass, double, std::ratio<45359237, 100000>>;
+
+//  Data size
+	using Bits      = Quantity<DataSize, std::int64_t, std::ratio<1, 8>>;
+	using Bytes     = Quantity<DataSize, std::int64_t>;
+	using Kilobytes = Quantity<DataSize, std::int64_t, std::kilo>;
+	using Megabytes = Quantity<DataSize, std::int64_t, std::mega>;
+	using Gigabytes = Quantity<DataSize, std::int64_t, std::giga>;
+	using Kibibytes = Quantity<DataSize, std::int64_t, std::ratio<1024>>;
+	using Mebibytes = Quantity<DataSize, std::int64_t, std::ratio<1024 * 1024>>;
+	using Gibibytes = Quantity<DataSize, std::int64_t, std::ratio<1024 * 1024 * 1024>>;
+
+//  Temperature (base unit kelvin)
+	using Kelvin     = Quantity<Temperature, double>;
+	using Celsius    = Quantity<Temperature, double, std::ratio<1>, std::ratio<27315, 100>>;
+	using Fahrenheit = Quantity<Temperature, double, std::ratio<5, 9>, std::ratio<45967, 100>>;
+
+//  Rates
+	using MetersPerSecond     = Quantity<Rate<Length>, double>;
+	using KilometersPerHour   = Quantity<Rate<Length>, double, std::ratio<1000, 3600>>;
+	using MilesPerHour        = Quantity<Rate<Length>, double, std::ratio<1609344, 3600000>>;
+	using BytesPerSecond      = Quantity<Rate<DataSize>, double>;
+	using MegabytesPerSecond  = Quantity<Rate<DataSize>, double, std::mega>;
+	using GigabitsPerSecond   = Quantity<Rate<DataSize>, double, std::ratio<1000000000, 8>>;
+
+	namespace literals {
+		constexpr Millimeters operator "" _mm(long double v) { return Millimeters(static_cast<double>(v)); }
+		constexpr Millimeters operator "" _mm(unsigned long long v) { return Millimeters(static_cast<double>(v)); }
+		constexpr Meters operator "" _m(long double v) { return Meters(static_cast<double>(v)); }
+		constexpr Meters operator "" _m(unsigned long long v) { return Meters(static_cast<double>(v)); }
+		constexpr Kilometers operator "" _km(long double v) { return Kilometers(static_cast<double>(v)); }
+		constexpr Kilometers operator "" _km(unsigned long long v) { return Kilometers(static_cast<double>(v)); }
+		constexpr Miles operator "" _mi(long double v) { return Miles(static_cast<double>(v)); }
+		constexpr Miles operator "" _mi(unsigned long long v) { return Miles(static_cast<double>(v)); }
+
+		constexpr Grams operator "" _g(long double v) { return Grams(static_cast<double>(v)); }
+		constexpr Grams operator "" _g(unsigned long long v) { return Grams(static_cast<double>(v)); }
+		constexpr Kilograms operator "" _kg(long double v) { return Kilograms(static_cast<double>(v)); }
+		constexpr Kilograms operator "" _kg(unsigned long long v) { return Kilograms(static_cast<double>(v)); }
+		constexpr Pounds operator "" _lb(long double v) { return Pounds(static_cast<double>(v)); }
+		constexpr Pounds operator "" _lb(unsigned long long v) { return Pounds(static_cast<double>(v)); }
+
+		constexpr Bytes operator "" _B(unsigned long long v) { return Bytes(static_cast<std::int64_t>(v)); }
+		constexpr Kilobytes operator "" _KB(unsigned long long v) { return Kilobytes(static_cast<std::int64_t>(v)); }
+		constexpr Megabytes operator "" _MB(unsigned long long v) { return Megabytes(static_cast<std::int64_t>(v)); }
+		constexpr Gigabytes operator "" _GB(unsigned long long v) { return Gigabytes(static_cast<std::int64_t>(v)); }
+		constexpr Kibibytes operator "" _KiB(unsigned long long v) { return Kibibytes(static_cast<std::int64_t>(v)); }
+		constexpr Mebibytes operator "" _MiB(unsigned long long v) { return Mebibytes(static_cast<std::int64_t>(v)); }
+		constexpr Gibibytes operator "" _GiB(unsigned long long v) { return Gibibytes(static_cast<std::int64_t>(v)); }
+
+		constexpr Kelvin operator "" _K(long double v) { return Kelvin(static_cast<double>(v)); }
+		constexpr Kelvin operator "" _K(unsigned long long v) { return Kelvin(static_cast<double>(v)); }
+		constexpr Celsius operator "" _degC(long double v) { return Celsius(static_cast<double>(v)); }
+		constexpr Celsius operator "" _degC(unsigned long long v) { return Celsius(static_cast<double>(v)); }
+		constexpr Fahrenheit operator "" _degF(long double v) { return Fahrenheit(static_cast<double>(v)); }
+		constexpr Fahrenheit operator "" _degF(unsigned long long v) { return Fahrenheit(static_cast<double>(v)); }
+	}
+
+//  Converts a column of counts from unit From to unit To. The factor and
+//  offset are compile-time constants, so the loop is a single multiply-add
+//  per element that the optimizer vectorizes.
+	template <typename To, typename From>
+	void convertColumn(const typename From::rep* in, typename To::rep* out, size_t count)
+	{
+		static_assert(std::is_same<typename To::dimension, typename From::dimension>::value,
+			"convertColumn: mismatched dimensions");
+
+		for (size_t i = 0; i < count; ++i)
+			out[i] = detail::convertCount<From, To>(in[i]);
+	}
+
+	template <typename To, typename From>
+	void convertColumn(const Buffer<typename From::rep>& in, Buffer<typename To::rep>& out)
+	{
+		if (out.size() != in.size())
+			out.resize(in.size());
+
+		convertColumn<To, From>(in.data(), out.data(), in.size());
+	}
+
+//  Compile-time checks
+	namespace detail {
+		using namespace literals;
+
+		static_assert(quantityCast<Fahrenheit>(100.0_degC).count() == 212.0, "boiling point");
+		static_assert(quantityCast<Celsius>(32.0_degF).count() == 0.0, "freezing point");
+		static_assert(quantityCast<Kelvin>(0.0_degC).count() == 273.15, "absolute zero offset");
+		static_assert(roundCount<long long, Fahrenheit>(24_degC) == 75, "the _celsius example");
+		static_assert(quantityCast<Meters>(3_km).count() == 3000.0, "km -> m");
+		static_assert(quantityCast<Meters>(1_mi).count() == 1609.344, "mile -> m");
+		static_assert(quantityCast<Grams>(2_kg).count() == 2000.0, "kg -> g");
+		static_assert(quantityCast<Bytes>(1_KiB).count() == 1024, "KiB -> B");
+		static_assert(quantityCast<Kibibytes>(1_MiB).count() == 1024, "MiB -> KiB");
+		static_assert(quantityCast<Bytes>(Bits(64)).count() == 8, "bits -> bytes");
+		static_assert(quantityCast<Kilobytes>(1_GB).count() == 1000000, "GB -> KB");
+		static_assert(quantityCast<BytesPerSecond>(Mebibytes(100) / std::chrono::seconds(2)).count() == 52428800.0, "MiB/s -> B/s");
+		static_assert(quantityCast<Meters>(KilometersPerHour(36.0) * std::chrono::seconds(10)).count() == 100.0, "rate * time");
+		static_assert(3_m + 2_m == 5_m && 2_m < 3_m && 6_m / 2.0 == 3_m, "arithmetic");
+
+		static_assert(std::is_constructible<Meters, Kilometers>::value, "same dimension converts");
+		static_assert(!std::is_convertible<Kilometers, Meters>::value, "but only explicitly");
+		static_assert(!std::is_constructible<Meters, Grams>::value, "length is not mass");
+		static_assert(!std::is_constructible<Bytes, Celsius>::value, "data size is not temperature");
+	}
+}
@@ -0,0 +1,36 @@
+#!/bin/sh
+# Verifies that the compile-time tables in Lut.h are emitted into read-only
+# data (.rodata) rather than initialized at startup (.data/.bss + init code).
+#
+# Usage: scripts/check-rodata.sh [compiler]
+
+set -eu
+CXX=${1:-${CXX:-c++}}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+cat > "$TMP/tables.cpp" <<'CPP'
+#include "Lut.h"
+extern "C" const void* const lutTables[] = {
+	&Lut::squares, &Lut::popcount8, &Lut::crc32Table, &Lut::crc32cTable,
+	&Lut::reciprocal16, &Lut::sine1024, &Lut::twiddles<1024>,
+};
+CPP
+
+"$CXX" -std=c++17 -O2 -c -I"$ROOT" "$TMP/tables.cpp" -o "$TMP/tables.o"
+
+status=0
+for table in squares popcount8 crc32Table crc32cTable reciprocal16 sine1024 twiddles; do
+	section=$(objdump -t "$TMP/tables.o" | grep "Lut.*$table" | awk '{ print $4 }' | head -n 1)
+	case "$section" in
+	.rodata*) echo "ok      Lut::$table in $section" ;;
+	*)        echo "FAILED  Lut::$table in '${section:-<missing>}'"; status=1 ;;
+	esac
+done
+
+if objdump -h "$TMP/tables.o" | grep -q init_array; then
+	echo "FAILED  dynamic initialization emitted"
+	status=1
+fi
+exit $status
@@ -0,0 +1,55 @@
+#!/bin/sh
+# Compile time and peak memory of every translation unit of the feature demo,
+# once per CPP11_STD_INCLUDES configuration (see CMakeLists.txt). One-time
+# costs, the precompiled header and the header unit, are listed separately.
+#
+# Usage: scripts/compile-time.sh [build-dir] [configuration...]
+#        configurations default to: stdc++ pch slim header-units
+
+set -eu
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+
+# Compiler launcher mode: run the compiler, append "seconds peak-KiB output".
+if [ "${1:-}" = "--measure" ]; then
+	log=$2
+	shift 2
+	exec python3 -c '
+import resource, subprocess, sys, time
+log, cmd = sys.argv[1], sys.argv[2:]
+start = time.monotonic()
+status = subprocess.call(cmd)
+seconds = time.monotonic() - start
+peak = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+output = cmd[cmd.index("-o") + 1] if "-o" in cmd else cmd[-1]
+with open(log, "a") as f:
+    f.write("%.2f %d %s\n" % (seconds, peak, output))
+sys.exit(status)
+' "$log" "$@"
+fi
+
+BUILD=${1:-$ROOT/_compile_time}
+[ $# -gt 0 ] && shift
+[ $# -gt 0 ] || set -- stdc++ pch slim header-units
+
+printf '%-13s %-34s %8s %10s\n' configuration "translation unit" seconds "peak MiB"
+for config in "$@"; do
+	dir=$BUILD/$config
+	log=$dir/compile-time.log
+	cmake -S "$ROOT" -B "$dir" -DCPP11_STD_INCLUDES="$config" \
+		-DCMAKE_CXX_COMPILER_LAUNCHER="$ROOT/scripts/compile-time.sh;--measure;$log" > /dev/null
+	cmake --build "$dir" --target clean > /dev/null
+	rm -f "$log" "$dir"/gcm.cache/*.gcm
+	cmake --build "$dir" --target cpp11features -j 1 > /dev/null 2>&1 ||
+		{ echo "$config: build failed, see cmake --build $dir"; exit 1; }
+
+	# Linking is also launched; only compiles are reported. A header unit is
+	# logged under its header, which is the last argument.
+	awk -v config="$config" '
+		$3 ~ /\.(o|obj|gch|pch|h)$/ {
+			n = split($3, part, "/")
+			unit = part[n]
+			sub(/\.(o|obj)$/, "", unit)
+			if ($3 ~ /\.(gch|pch|h)$/) unit = unit " (once)"
+			printf "%-13s %-34s %8.2f %10.1f\n", config, unit, $1, $2 / 1024
+		}' "$log"
+done
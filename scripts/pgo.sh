@@ -0,0 +1,29 @@
+#!/bin/sh
+# Profile-guided build: instrument, train on the feature demo and the
+# benchmarks, then rebuild the same build directory with the profile.
+#
+# Usage: scripts/pgo.sh [build-dir] [benchmark items]
+
+set -eu
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BUILD=${1:-$ROOT/_pgo_build}
+ITEMS=${2:-200000}
+DATA=$BUILD/pgo-data
+
+rm -rf "$DATA"
+cmake -S "$ROOT" -B "$BUILD" -DCMAKE_BUILD_TYPE=Release -DCPP11_PGO=generate -DCPP11_PGO_DIR="$DATA"
+cmake --build "$BUILD" --clean-first
+
+echo "== training"
+"$BUILD/cpp11features" > /dev/null
+"$BUILD/benchmarks" "" "$ITEMS"
+
+# Clang writes raw profiles that have to be merged first.
+if ls "$DATA"/*.profraw > /dev/null 2>&1; then
+	PROFDATA=$(command -v llvm-profdata || xcrun -f llvm-profdata)
+	"$PROFDATA" merge -o "$DATA/default.profdata" "$DATA"/*.profraw
+fi
+
+cmake -S "$ROOT" -B "$BUILD" -DCPP11_PGO=use
+cmake --build "$BUILD" --clean-first
+echo "== profile-optimized binaries in $BUILD"